@@ -1,5 +1,5 @@
 // MQTTDebugOverlay.qml
-// Debug overlay showing MQTT connection status and recent messages
+// Debug overlay showing MQTT connection status, pipeline stats and recent messages
 
 import QtQuick 2.15
 
@@ -16,17 +16,65 @@ Item {
     property string mqttHost: ""
     property int mqttPort: 1883
     property string mqttTopic: ""
-    property int reconnectInterval: 30
     
     // Statistics
     property int messagesReceived: 0
+    property int messagesDropped: 0
+    property int messagesCoalesced: -1   // -1 = coalescing off
+    property int messagesOversized: 0
     property int activeColumns: 0
     property int totalColumns: 0
-    property real fadeStrength: 0.05
     property string renderMode: "Mixed"
+    property bool renderIdle: false
+    // FrameGovernor level name, "" when not reported
+    property string qualityLevel: ""
     
-    // Message history
-    property var messageHistory: []
+    // Topic filter rules: [{rule, list, hits}, ...] from MQTTClient.filterHits
+    property var filterHits: []
+    // Home Assistant entities known to discovery, -1 when discovery is off
+    property int discoveredEntities: -1
+    
+    // Message history: a MessageRing, index 0 newest
+    property var messageHistory: null
+    
+    // RainStats: frame-step percentiles, ingest rates, CONNACK latency
+    property var stats: null
+    
+    function fixed(v, digits) { return (v !== undefined && v !== null) ? v.toFixed(digits) : "-" }
+    
+    function byteRate(bps) {
+        if (bps >= 1048576) return (bps / 1048576).toFixed(1) + " MB/s"
+        if (bps >= 1024)    return (bps / 1024).toFixed(1) + " KB/s"
+        return bps.toFixed(0) + " B/s"
+    }
+    
+    function mib(bytes) {
+        return (bytes / 1048576).toFixed(bytes >= 10485760 ? 0 : 1) + " MiB"
+    }
+    
+    // "fade 0.02/0.05/0.09" for the given steps of stats.frameSteps
+    function stepSummary(names) {
+        var steps = stats ? stats.frameSteps : []
+        var parts = []
+        for (var i = 0; i < steps.length; i++) {
+            if (names.indexOf(steps[i].step) < 0) continue
+            parts.push(steps[i].step + " " + fixed(steps[i].p50, 2) + "/" + fixed(steps[i].p95, 2)
+                       + "/" + fixed(steps[i].p99, 2))
+        }
+        return parts.length > 0 ? parts.join("  ") : "(no frames yet)"
+    }
+    
+    // "rule ×hits" for the busiest filter rules
+    function filterSummary(maxRules) {
+        if (!filterHits || filterHits.length === 0) return "(none)"
+        var rules = filterHits.slice().sort(function(a, b) { return b.hits - a.hits })
+        var parts = []
+        for (var i = 0; i < Math.min(rules.length, maxRules); i++) {
+            parts.push((rules[i].list === "white" ? "+" : "-") + rules[i].rule + " \u00D7" + rules[i].hits)
+        }
+        if (rules.length > maxRules) parts.push("\u2026")
+        return parts.join("  |  ")
+    }
     
     Canvas {
         id: debugCanvas
@@ -34,7 +82,7 @@ Item {
         
         onPaint: {
             var ctx = getContext("2d")
-            var BOX_X = 8, BOX_Y = 8, BOX_W = 780, BOX_H = 254
+            var BOX_X = 8, BOX_Y = 8, BOX_W = 780, BOX_H = 330
             var TX = 14, LINE = 16
             
             // Semi-transparent background
@@ -49,7 +97,9 @@ Item {
             // Connection status
             ctx.font = "12px monospace"
             ctx.fillStyle = mqttConnected ? "#00ff00" : "#ff4444"
-            ctx.fillText("MQTT:   " + (mqttConnected ? "✅ CONNECTED" : "❌ DISCONNECTED"), TX, 46)
+            ctx.fillText("MQTT:   " + (mqttConnected ? "✅ CONNECTED" : "❌ DISCONNECTED")
+                         + (stats && stats.connackLatency >= 0 ? "  |  CONNACK " + stats.connackLatency + " ms" : "")
+                         + (stats ? "  |  Reconnects: " + stats.reconnects : ""), TX, 46)
             
             // Broker info
             ctx.fillStyle = "#00ccff"
@@ -59,37 +109,61 @@ Item {
             // Statistics line 1
             ctx.fillStyle = "#aaaaaa"
             ctx.fillText("Msgs:   " + messagesReceived
+                         + " (dropped " + messagesDropped
+                         + (messagesCoalesced >= 0 ? ", coalesced " + messagesCoalesced : "")
+                         + (messagesOversized > 0 ? ", oversized " + messagesOversized : "") + ")"
                          + "  |  Active cols: " + activeColumns
-                         + "  |  Total cols: " + totalColumns
-                         + "  |  Fade: " + fadeStrength.toFixed(2), TX, 94)
+                         + "  |  Total cols: " + totalColumns, TX, 94)
+            
+            // Ingest rates over the last stats interval
+            ctx.fillStyle = "#66ccff"
+            ctx.fillText("Rates:  " + (stats
+                             ? fixed(stats.receivedPerSecond, 1) + " msg/s in, "
+                               + fixed(stats.filteredPerSecond, 1) + " filtered, "
+                               + fixed(stats.droppedPerSecond, 1) + " dropped"
+                               + "  |  " + byteRate(stats.bytesPerSecond)
+                               + "  |  Tokenise: " + fixed(stats.tokenizeMicros, 1) + " \u00B5s"
+                             : "(stats unavailable)"), TX, 110)
             
             // Statistics line 2
             ctx.fillStyle = "#ffaa00"
-            ctx.fillText("🔄 Reconnect: " + reconnectInterval + "s"
-                         + "  |  Mode: " + renderMode, TX, 110)
+            ctx.fillText("Mode:   " + renderMode + (renderIdle ? " (idle)" : "")
+                         + (qualityLevel !== "" ? "  |  Quality: " + qualityLevel : "")
+                         + (discoveredEntities >= 0 ? "  |  HA entities: " + discoveredEntities : ""), TX, 126)
+            
+            // Filter rule hits
+            ctx.fillStyle = "#ff6666"
+            var filters = "\uD83D\uDEAB Filters: " + filterSummary(4)
+            if (filters.length > 100) filters = filters.substring(0, 97) + "\u2026"
+            ctx.fillText(filters, TX, 142)
+            
+            // Frame-step percentiles (ms). An idle surface records no ticks.
+            ctx.fillStyle = "#cc99ff"
+            ctx.fillText("\u23F1 Frame ms p50/p95/p99: " + stepSummary(["fade", "columns", "inline"]), TX, 158)
+            ctx.fillText("                          " + stepSummary(["tick", "upload"])
+                         + (stats ? "  |  \uD83E\uDDE0 Mem: " + mib(stats.memoryBytes) + " (peak " + mib(stats.memoryPeak)
+                                    + (stats.memoryCap > 0 ? ", cap " + mib(stats.memoryCap) : "") + ")" : ""), TX, 174)
             
             // Separator
             ctx.fillStyle = "#555555"
-            ctx.fillRect(TX, 119, BOX_W - 20, 1)
+            ctx.fillRect(TX, 183, BOX_W - 20, 1)
             
             // Recent messages header
             ctx.fillStyle = "#888888"
-            ctx.fillText("Recent messages (newest first):", TX, 132)
+            ctx.fillText("Recent messages (newest first):", TX, 196)
             
             // Message list
             var alphas = ["#ffff00", "#cccc00", "#999900", "#666600", "#444400"]
             var hist = messageHistory
-            var baseY = 148
+            var baseY = 212
             
-            if (hist.length === 0) {
+            if (!hist || hist.count === 0) {
                 ctx.fillStyle = "#555555"
                 ctx.fillText("(waiting for messages...)", TX, baseY)
             } else {
-                for (var m = 0; m < Math.min(hist.length, 5); m++) {
-                    var hEntry = hist[m]
-                    if (!hEntry) continue
-                    
-                    var line = (hEntry.topic || "") + ": " + (hEntry.payload || "")
+                for (var m = 0; m < Math.min(hist.count, 5); m++) {
+                    var hPayload = hist.payload(m)
+                    var line = hist.topic(m) + ": " + (hPayload ? hPayload.toString() : "")
                     if (line.length > 100) {
                         line = line.substring(0, 97) + "…"
                     }
@@ -107,7 +181,26 @@ Item {
         function onMessageHistoryChanged() { debugCanvas.requestPaint() }
         function onMqttConnectedChanged() { debugCanvas.requestPaint() }
         function onMessagesReceivedChanged() { debugCanvas.requestPaint() }
+        function onMessagesDroppedChanged() { debugCanvas.requestPaint() }
+        function onMessagesCoalescedChanged() { debugCanvas.requestPaint() }
+        function onMessagesOversizedChanged() { debugCanvas.requestPaint() }
+        function onFilterHitsChanged() { debugCanvas.requestPaint() }
+        function onDiscoveredEntitiesChanged() { debugCanvas.requestPaint() }
         function onActiveColumnsChanged() { debugCanvas.requestPaint() }
         function onRenderModeChanged() { debugCanvas.requestPaint() }
+        function onRenderIdleChanged() { debugCanvas.requestPaint() }
+        function onQualityLevelChanged() { debugCanvas.requestPaint() }
+    }
+    
+    Connections {
+        target: overlay.messageHistory
+        ignoreUnknownSignals: true
+        function onUpdated() { debugCanvas.requestPaint() }
+    }
+    
+    Connections {
+        target: overlay.stats
+        ignoreUnknownSignals: true
+        function onUpdated() { debugCanvas.requestPaint() }
     }
 }
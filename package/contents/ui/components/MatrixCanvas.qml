@@ -1,15 +1,21 @@
 // MatrixCanvas.qml
 //
-// Base canvas component for Matrix rain rendering.
+// Base rain surface for Matrix rain rendering.
 // Renderer-agnostic: all visual decisions are delegated to activeRenderer.
 //
+// Backed by the native MatrixRainItem (C++ plugin): drop state, the frame
+// timer and the column loop live in C++, glyphs are drawn through the
+// scene graph from a glyph atlas instead of a software 2D context.
+//
 // ─────────────────────────────────────────────────────────────────
-// RENDERING PIPELINE (executed every timer tick)
+// RENDERING PIPELINE (executed every timer tick, in MatrixRainItem)
 //
 //   Step 1 – Fade
-//     Fill the whole canvas with a low-alpha black rectangle.
-//     Creates the trailing-light / fade effect of the rain.
-//     Alpha = fadeStrength (configurable, typically 0.03–0.10).
+//     gpuFade (default): the previous frame lives in a persistent trail
+//     texture and is multiplied by (1 - fadeStrength) in trail.frag,
+//     together with a per-cell fadeMask for accelerated fades.
+//     Otherwise every trail cell's intensity is scaled on the CPU.
+//     Same trailing-light effect as the former full-canvas fillRect.
 //
 //   Step 2 – Rain drop loop
 //     For each column i:
@@ -26,124 +32,139 @@
 // RENDERER INTERFACE  (methods activeRenderer must implement)
 //
 //   initializeColumns(numColumns)            – reset for new column count
-//   renderColumnContent(ctx, i, x, y, drops) – draw one char at drop head
+//   renderColumnContent(ctx, i, x, y, drops, rand, charIndex) – draw one char at drop head
 //   onColumnWrap(columnIndex)                – drop wrapped; update state
 //   renderInlineChars(ctx)           [opt.]  – second draw pass per frame
 //
+//   drops (Float32Array), rand (Float32Array) and charIndex (Int32Array)
+//   are per-tick snapshots; rand[i] is a uniform [0,1) value for column i
+//   from the native xoshiro generator — use it instead of Math.random()
+//   (glitch rolls). charIndex[i] is (floor(drops[i]) + i) % length of the
+//   column's columnState chars, 0 for free columns.
+//
+//   `ctx` is a Canvas-compatible subset: fillStyle, fillText(ch, x, y)
+//   and fillRect(x, y, w, h) (fills only darken, by the style's alpha).
+//   Hot path: ctx.glyph(code, column, shade, x, y) and
+//   ctx.randomGlyph(column, shade, x, y) take a UTF-16 code and a
+//   RainPainter.Base/Value/Glitch shade of the column's `colors` entry;
+//   no string or colour is built per glyph.
+//
 //   Properties read/set by MatrixCanvas on the renderer (if they exist):
 //     jitter       – extra random drop-speed variance (0–100)
 //     canvasWidth  – canvas pixel width (set before initializeColumns)
 //     canvasHeight – canvas pixel height (set before initializeColumns)
 //     fadeStrength – same value used in step 1 (available for renderer use)
+//
+//   Read once when the renderer is bound (optional):
+//     columnState          – ColumnState with the renderer's column slots;
+//                            any change wakes an idle surface
+//     drawsInactiveColumns – false: skip renderColumnContent/onColumnWrap
+//                            for free columns (they would draw nothing)
+//
+// IDLE: when a tick stamps no glyph and the trail has faded to black,
+// MatrixRainItem stops its frame timer (rain.idle). A columnState change
+// or requestPaint() (called by main.qml per MQTT batch) resumes it.
+//
+// PAUSE: running=false (wallpaper hidden) stops the frame timer outright.
+// rebuild() starts over from a blank frame: drops are re-seeded, the
+// renderer re-initialised and the GPU trail cleared on the next capture,
+// so nothing stale is shown when the wallpaper comes back.
 // ─────────────────────────────────────────────────────────────────
 
 import QtQuick 2.15
+import ObsidianReq.MQTTRain 1.0
 
-Canvas {
+Item {
     id: canvas
     anchors.fill: parent
 
     // ── Visual configuration (bound from main.qml) ───────────────────
-    property int  fontSize:     16
-    property int  speed:        50
-    property real fadeStrength: 0.05
-    property bool mqttEnable:   false
+    property alias fontSize:     rain.fontSize
+    property alias speed:        rain.speed
+    property alias fadeStrength: rain.fadeStrength
+    // Column palette; shades are rebuilt natively only when it changes
+    property alias colors:       rain.colors
+    // Non-zero: reproducible drops, glitches, glyphs and column picks
+    property alias seed:         rain.seed
+    // Drop detail (glitches, inline passes, frame rate, columns) to hold the frame budget
+    property alias adaptiveQuality: rain.adaptiveQuality
+    // Threads for the native per-tile passes (fade, upload); 0 = one per core
+    property alias renderThreads: rain.renderThreads
+    property bool  mqttEnable:   false
+    property bool  gpuFade:      true
 
     // ── Active renderer (injected from main.qml via property binding) ─
-    property var activeRenderer: null
-
-    // ── Drop state: one float per column (in grid-row units) ──────────
-    property var drops: []
-
-    // ================================================================
-    // Initialize drops array and the active renderer.
-    // Sets canvasWidth/Height and fadeStrength on the renderer BEFORE
-    // calling initializeColumns so the renderer has full context.
-    // ================================================================
-    function initDrops() {
-        if (canvas.width <= 0 || canvas.height <= 0) return
-
-        var cols = Math.floor(canvas.width / fontSize)
-
-        var newDrops = []
-        for (var j = 0; j < cols; j++) {
-            newDrops.push(Math.random() * canvas.height / fontSize)
-        }
-        drops = newDrops
-
-        if (activeRenderer) {
-            if (activeRenderer.canvasWidth  !== undefined) activeRenderer.canvasWidth  = canvas.width
-            if (activeRenderer.canvasHeight !== undefined) activeRenderer.canvasHeight = canvas.height
-            if (activeRenderer.fadeStrength !== undefined) activeRenderer.fadeStrength = canvas.fadeStrength
-            activeRenderer.initializeColumns(cols)
-        }
+    property alias activeRenderer: rain.activeRenderer
+    // True while the frame timer is stopped because nothing is visible
+    readonly property alias idle: rain.idle
+    // False while the wallpaper is hidden: no ticks at all
+    property alias running: rain.running
+    // The native item itself, for RainStats' frame timings
+    readonly property alias rainItem: rain
+
+    // Set by rebuild(); the next trail capture uses keep = 0
+    property bool flushPending: false
+    property bool flushTrail:   false
+
+    function initDrops()    { rain.initDrops() }
+    function requestPaint() { rain.requestPaint() }
+    function rebuild() {
+        canvas.flushPending = true
+        rain.initDrops()
     }
 
-    // ================================================================
-    // React when the renderer is swapped (render mode switch).
-    // Initialises the new renderer immediately on the next tick.
-    // ================================================================
-    onActiveRendererChanged: {
-        if (activeRenderer && canvas.width > 0 && canvas.height > 0) {
-            if (activeRenderer.canvasWidth  !== undefined) activeRenderer.canvasWidth  = canvas.width
-            if (activeRenderer.canvasHeight !== undefined) activeRenderer.canvasHeight = canvas.height
-            if (activeRenderer.fadeStrength !== undefined) activeRenderer.fadeStrength = canvas.fadeStrength
-            activeRenderer.initializeColumns(Math.floor(canvas.width / fontSize))
+    // ── Glyph source: drops, frame timer and renderer calls ──────────
+    // In gpuFade mode it only emits the glyphs of the current tick and is
+    // hidden from the scene; the compositor below draws the result.
+    MatrixRainItem {
+        id: rain
+        anchors.fill: parent
+        fadeMode: canvas.gpuFade ? MatrixRainItem.GpuFade : MatrixRainItem.CellFade
+
+        onFrameAdvanced: {
+            if (!canvas.gpuFade) return
+            canvas.flushTrail = canvas.flushPending
+            canvas.flushPending = false
+            trail.scheduleUpdate()
         }
     }
 
-    // ================================================================
-    // Animation timer – triggers a repaint at the configured speed.
-    // ================================================================
-    Timer {
-        id:       timer
-        interval: 1000 / canvas.speed
-        running:  true
-        repeat:   true
-        onTriggered: canvas.requestPaint()
+    ShaderEffectSource {
+        id: glyphLayer
+        anchors.fill: parent
+        sourceItem: rain
+        hideSource: canvas.gpuFade
+        live: canvas.gpuFade
+        visible: false
     }
 
-    // ================================================================
-    // Main rendering loop – Steps 1–3.
-    // ================================================================
-    onPaint: {
-        var ctx = getContext("2d")
-        var w   = canvas.width
-        var h   = canvas.height
-
-        if (!activeRenderer) return
-
-        // ── Step 1: global fade ────────────────────────────────────────
-        ctx.fillStyle = "rgba(0,0,0," + fadeStrength + ")"
-        ctx.fillRect(0, 0, w, h)
-
-        // Font set once per frame (shared by all renderers)
-        ctx.font = fontSize + "px monospace"
-
-        // ── Step 2: rain drop loop ─────────────────────────────────────
-        for (var i = 0; i < drops.length; i++) {
-            var x = i * fontSize
-            var y = drops[i] * fontSize
+    // ── Compositor: decayed trail + this tick's glyphs ───────────────
+    ShaderEffect {
+        id: compositor
+        anchors.fill: parent
+        visible: canvas.gpuFade
 
-            activeRenderer.renderColumnContent(ctx, i, x, y, drops)
+        property var  previous:  trail
+        property var  glyphs:    glyphLayer
+        property var  fadeMask:  rain.fadeMask
+        property real keep:      canvas.flushTrail ? 0.0 : 1.0 - canvas.fadeStrength
+        property size maskScale: Qt.size(width  / Math.max(1, rain.fadeMask.width),
+                                         height / Math.max(1, rain.fadeMask.height))
 
-            drops[i] += 1 + Math.random() * activeRenderer.jitter / 100
-
-            if (drops[i] * fontSize > h + fontSize) {
-                drops[i] = 0
-                activeRenderer.onColumnWrap(i)
-            }
-        }
-
-        // ── Step 3: inline-chars pass (optional) ──────────────────────
-        // Only called if the renderer implements renderInlineChars().
-        // Keep this generic so future renderers can opt in.
-        if (typeof activeRenderer.renderInlineChars === "function") {
-            activeRenderer.renderInlineChars(ctx)
-        }
+        fragmentShader: "qrc:/mqttrain/shaders/trail.frag.qsb"
     }
 
-    onWidthChanged:  initDrops()
-    onHeightChanged: initDrops()
-    Component.onCompleted: initDrops()
+    // ── Persistent trail buffer ──────────────────────────────────────
+    // Recursive capture of the compositor, refreshed once per tick so the
+    // decay is applied at the animation rate, not the display refresh rate.
+    // Half-float storage avoids the 8-bit "ghost" residue of long trails.
+    ShaderEffectSource {
+        id: trail
+        anchors.fill: parent
+        sourceItem: compositor
+        recursive: true
+        live: false
+        visible: false
+        format: ShaderEffectSource.RGBA16F
+    }
 }
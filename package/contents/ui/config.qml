@@ -16,18 +16,42 @@ ColumnLayout {
     property alias cfg_paletteIndex:  paletteCombo.currentIndex
     property alias cfg_jitter:        jitterSpin.value
     property alias cfg_glitchChance:  glitchSpin.value
+    property alias cfg_gpuFade:       gpuFade.checked
+    property alias cfg_adaptiveQuality: adaptiveQuality.checked
+    property alias cfg_renderThreads: renderThreadsSpin.value
+    property alias cfg_randomSeed:    seedSpin.value
+    property alias cfg_pauseWhenHidden: pauseWhenHidden.checked
     property alias cfg_mqttEnable:    mqttEnable.checked
     property alias cfg_mqttHost:      mqttHost.text
     property alias cfg_mqttPort:      mqttPort.value
     property alias cfg_mqttPath:      mqttPath.text
+    property alias cfg_mqttTransport: mqttTransportCombo.currentIndex
     property alias cfg_mqttTopic:     mqttTopic.text
     property alias cfg_mqttTopicBlacklist: mqttTopicBlacklist.text
+    property alias cfg_mqttTopicWhitelist: mqttTopicWhitelist.text
+    property alias cfg_mqttExtractors: mqttExtractors.text
     property alias cfg_mqttUsername:  mqttUsername.text
     property alias cfg_mqttPassword:  mqttPassword.text
     property alias cfg_mqttReconnectInterval: mqttReconnectIntervalSpin.value
+    property alias cfg_mqttPersistentSession: mqttPersistentSession.checked
+    property alias cfg_mqttClientId: mqttClientId.text
+    property alias cfg_mqttWorkerThread: mqttWorkerThread.checked
+    property alias cfg_mqttSharedConnection: mqttSharedConnection.checked
+    property alias cfg_mqttMaxBatchSize: mqttMaxBatchSizeSpin.value
+    property alias cfg_mqttDropPolicy: mqttDropPolicyCombo.currentIndex
+    property alias cfg_mqttCoalesce: mqttCoalesce.checked
+    property alias cfg_mqttWarmStart: mqttWarmStart.checked
+    property alias cfg_mqttMaxDisplayLength: mqttMaxDisplayLengthSpin.value
+    property alias cfg_mqttMaxPayloadKB: mqttMaxPayloadKBSpin.value
+    property alias cfg_mqttMemoryCapMB: mqttMemoryCapMBSpin.value
+    property alias cfg_mqttDiscovery: mqttDiscovery.checked
+    property alias cfg_mqttDiscoveryPrefix: mqttDiscoveryPrefix.text
     property alias cfg_mqttRenderMode: mqttRenderModeCombo.currentIndex
     property alias cfg_debugOverlay:  debugOverlay.checked
     property alias cfg_mqttDebug:     mqttDebug.checked
+    property alias cfg_mqttCaptureFile: mqttCaptureFile.text
+    property alias cfg_mqttCaptureCompress: mqttCaptureCompress.checked
+    property alias cfg_mqttReplayFile: mqttReplayFile.text
 
     // Tab bar
     QC.TabBar {
@@ -122,6 +146,37 @@ ColumnLayout {
                 from: 0; to: 100; stepSize: 1
                 KirigamiLayouts.FormData.label: qsTr("Glitch Chance (%)")
             }
+
+            QC.SpinBox {
+                id: seedSpin
+                from: 0; to: 2147483647; stepSize: 1
+                editable: true
+                KirigamiLayouts.FormData.label: qsTr("Random Seed (0 = random)")
+            }
+
+            QC.CheckBox {
+                id: gpuFade
+                text: qsTr("Fade trails on the GPU")
+                KirigamiLayouts.FormData.label: qsTr("GPU Fade")
+            }
+
+            QC.CheckBox {
+                id: adaptiveQuality
+                text: qsTr("Reduce detail when frames take too long")
+                KirigamiLayouts.FormData.label: qsTr("Adaptive Quality")
+            }
+
+            QC.SpinBox {
+                id: renderThreadsSpin
+                from: 0; to: 64; stepSize: 1
+                KirigamiLayouts.FormData.label: qsTr("Render Threads (0 = one per core)")
+            }
+
+            QC.CheckBox {
+                id: pauseWhenHidden
+                text: qsTr("Pause when covered, minimised or locked")
+                KirigamiLayouts.FormData.label: qsTr("Power Saving")
+            }
         }
 
         // ========== TAB 2: MQTT & NETWORK ==========
@@ -151,9 +206,22 @@ ColumnLayout {
                 KirigamiLayouts.FormData.label: qsTr("MQTT Port")
             }
 
+            QC.ComboBox {
+                id: mqttTransportCombo
+                // Index must stay in sync with MQTTClient::Transport
+                model: [
+                    qsTr("TCP (mqtt://)"),
+                    qsTr("TLS (mqtts://)"),
+                    qsTr("WebSocket (ws://)"),
+                    qsTr("Secure WebSocket (wss://)")
+                ]
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Transport")
+            }
+
             QC.TextField {
                 id: mqttPath
-                enabled: mqttEnable.checked
+                enabled: mqttEnable.checked && mqttTransportCombo.currentIndex >= 2
                 placeholderText: "/"
                 KirigamiLayouts.FormData.label: qsTr("WebSocket Path")
             }
@@ -161,8 +229,15 @@ ColumnLayout {
             QC.TextField {
                 id: mqttTopic
                 enabled: mqttEnable.checked
-                placeholderText: "zigbee2mqtt/#"
-                KirigamiLayouts.FormData.label: qsTr("MQTT Topic")
+                placeholderText: "zigbee2mqtt/+, zigbee2mqtt/bridge/state@1"
+                KirigamiLayouts.FormData.label: qsTr("MQTT Topics")
+            }
+
+            QC.Label {
+                text: qsTr("Comma-separated, one subscription each. Append @1 or @2 for QoS 1/2.")
+                font.italic: true
+                opacity: 0.7
+                wrapMode: Text.WordWrap
             }
 
             QC.TextField {
@@ -172,8 +247,50 @@ ColumnLayout {
                 KirigamiLayouts.FormData.label: qsTr("Topic Blacklist")
             }
 
+            QC.TextField {
+                id: mqttTopicWhitelist
+                enabled: mqttEnable.checked
+                placeholderText: qsTr("zigbee2mqtt/+,sensors/#")
+                KirigamiLayouts.FormData.label: qsTr("Topic Whitelist")
+            }
+
+            QC.Label {
+                text: qsTr("Comma-separated. Entries with + or # are MQTT topic filters, others match anywhere in the topic. An empty whitelist lets everything through.")
+                font.italic: true
+                opacity: 0.7
+                wrapMode: Text.WordWrap
+            }
+
+            QC.TextArea {
+                id: mqttExtractors
+                enabled: mqttEnable.checked
+                placeholderText: qsTr("zigbee2mqtt/+ = temperature, humidity, state")
+                KirigamiLayouts.FormData.label: qsTr("Payload Fields")
+            }
+
+            QC.Label {
+                text: qsTr("One rule per line: topic filter = JSON fields to show (dotted paths), or a template such as {temperature}°C. JSON messages on a matching topic without any of the fields are skipped.")
+                font.italic: true
+                opacity: 0.7
+                wrapMode: Text.WordWrap
+            }
+
+            QC.CheckBox {
+                id: mqttDiscovery
+                text: qsTr("Follow Home Assistant discovery")
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Discovery")
+            }
+
+            QC.TextField {
+                id: mqttDiscoveryPrefix
+                enabled: mqttEnable.checked && mqttDiscovery.checked
+                placeholderText: qsTr("homeassistant")
+                KirigamiLayouts.FormData.label: qsTr("Discovery Prefix")
+            }
+
             QC.Label {
-                text: qsTr("Comma-separated list of topics to ignore")
+                text: qsTr("Subscribes to the state topics announced under the prefix, cached per broker. Whitelist and blacklist still apply.")
                 font.italic: true
                 opacity: 0.7
                 wrapMode: Text.WordWrap
@@ -210,7 +327,99 @@ ColumnLayout {
                 id: mqttReconnectIntervalSpin
                 from: 1; to: 600; stepSize: 5
                 enabled: mqttEnable.checked
-                KirigamiLayouts.FormData.label: qsTr("Reconnect interval (s)")
+                KirigamiLayouts.FormData.label: qsTr("Max reconnect delay (s)")
+            }
+
+            QC.Label {
+                text: qsTr("Retries start almost immediately and back off exponentially, with jitter, up to this delay.")
+                font.italic: true
+                opacity: 0.7
+                wrapMode: Text.WordWrap
+            }
+
+            QC.CheckBox {
+                id: mqttPersistentSession
+                text: qsTr("Keep the session on the broker between reconnects")
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Persistent Session")
+            }
+
+            QC.TextField {
+                id: mqttClientId
+                enabled: mqttEnable.checked
+                placeholderText: qsTr("Generated automatically")
+                KirigamiLayouts.FormData.label: qsTr("Client ID")
+            }
+
+            QC.CheckBox {
+                id: mqttWorkerThread
+                text: qsTr("Receive and decode messages off the render thread")
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Worker Thread")
+            }
+
+            QC.CheckBox {
+                id: mqttSharedConnection
+                text: qsTr("Share one connection between screens (Client ID unused)")
+                enabled: mqttEnable.checked && mqttWorkerThread.checked
+                KirigamiLayouts.FormData.label: qsTr("Shared Connection")
+            }
+
+            QC.SpinBox {
+                id: mqttMaxBatchSizeSpin
+                from: 1; to: 500; stepSize: 8
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Max messages per frame")
+            }
+
+            QC.ComboBox {
+                id: mqttDropPolicyCombo
+                // Index must stay in sync with MQTTClient::DropPolicy
+                model: [
+                    qsTr("Keep newest per topic"),
+                    qsTr("Drop oldest")
+                ]
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("When overloaded")
+            }
+
+            QC.CheckBox {
+                id: mqttCoalesce
+                text: qsTr("Only show changed values (latest per topic, skip identical payloads)")
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Coalesce by Topic")
+            }
+
+            QC.CheckBox {
+                id: mqttWarmStart
+                text: qsTr("Show the last session's messages until the broker answers")
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Warm Start")
+            }
+
+            QC.SpinBox {
+                id: mqttMaxDisplayLengthSpin
+                from: 64; to: 16384; stepSize: 64
+                enabled: mqttEnable.checked
+                KirigamiLayouts.FormData.label: qsTr("Max characters shown per message")
+            }
+
+            QC.SpinBox {
+                id: mqttMaxPayloadKBSpin
+                from: 0; to: 65536; stepSize: 16
+                enabled: mqttEnable.checked
+                textFromValue: function(value) { return value === 0 ? qsTr("No limit") : value + " KB" }
+                valueFromText: function(text) { var n = parseInt(text); return isNaN(n) ? 0 : n }
+                KirigamiLayouts.FormData.label: qsTr("Skip payloads larger than")
+            }
+
+            QC.SpinBox {
+                id: mqttMemoryCapMBSpin
+                from: 0; to: 1024; stepSize: 8
+                enabled: mqttEnable.checked
+                textFromValue: function(value) { return value === 0 ? qsTr("No limit") : value + " MB" }
+                valueFromText: function(text) { var n = parseInt(text); return isNaN(n) ? 0 : n }
+                KirigamiLayouts.FormData.label: qsTr("Message memory cap")
             }
 
             QC.ComboBox {
@@ -245,6 +454,33 @@ ColumnLayout {
                 enabled: mqttEnable.checked
                 KirigamiLayouts.FormData.label: qsTr("Verbose Logging")
             }
+
+            QC.TextField {
+                id: mqttCaptureFile
+                enabled: mqttEnable.checked && mqttReplayFile.text.trim().length === 0
+                placeholderText: qsTr("~/mqttrain-capture.mqrc")
+                KirigamiLayouts.FormData.label: qsTr("Capture to File")
+            }
+
+            QC.CheckBox {
+                id: mqttCaptureCompress
+                text: qsTr("Compress the capture")
+                enabled: mqttCaptureFile.enabled && mqttCaptureFile.text.trim().length > 0
+            }
+
+            QC.TextField {
+                id: mqttReplayFile
+                enabled: mqttEnable.checked
+                placeholderText: qsTr("Leave empty to use the broker")
+                KirigamiLayouts.FormData.label: qsTr("Replay from File")
+            }
+
+            QC.Label {
+                text: qsTr("A capture records everything the broker sends (appended to an existing file). Replaying one, in a loop, takes the broker's place: nothing is connected while it is set.")
+                font.italic: true
+                opacity: 0.7
+                wrapMode: Text.WordWrap
+            }
         }
     }
 }
@@ -4,7 +4,9 @@
 
 import QtQuick 2.15
 import QtQuick.Controls 2.15
+import QtQml.Models 2.15
 import org.kde.plasma.plasmoid 2.0
+import org.kde.taskmanager 0.1 as TaskManager
 import ObsidianReq.MQTTRain 1.0
 import "components"
 import "renderers"
@@ -22,26 +24,56 @@ WallpaperItem {
     property int   paletteIndex: main.configuration.paletteIndex !== undefined ? main.configuration.paletteIndex : 0
     property real  jitter:      main.configuration.jitter      !== undefined ? main.configuration.jitter      : 0
     property int   glitchChance: main.configuration.glitchChance !== undefined ? main.configuration.glitchChance : 1
+    property bool  gpuFade:     main.configuration.gpuFade     !== undefined ? main.configuration.gpuFade     : true
+    property bool  adaptiveQuality: main.configuration.adaptiveQuality !== undefined ? main.configuration.adaptiveQuality : true
+    property int   renderThreads: main.configuration.renderThreads !== undefined ? main.configuration.renderThreads : 0
+    property int   randomSeed:  main.configuration.randomSeed  !== undefined ? main.configuration.randomSeed  : 0
+    property bool  pauseWhenHidden: main.configuration.pauseWhenHidden !== undefined ? main.configuration.pauseWhenHidden : true
 
     // MQTT settings
     property bool   mqttEnable:   main.configuration.mqttEnable   !== undefined ? main.configuration.mqttEnable   : false
     property string mqttHost:     (main.configuration.mqttHost     !== undefined ? main.configuration.mqttHost     : "homeassistant.lan").trim()
     property int    mqttPort:     main.configuration.mqttPort      !== undefined ? main.configuration.mqttPort      : 1883
+    property int    mqttTransport: main.configuration.mqttTransport !== undefined ? main.configuration.mqttTransport : 0
+    property string mqttPath:     (main.configuration.mqttPath || "/").trim()
     property string mqttTopic:    (main.configuration.mqttTopic    !== undefined ? main.configuration.mqttTopic    : "zigbee2mqtt/#").trim()
     property string mqttTopicBlacklist: (main.configuration.mqttTopicBlacklist !== undefined ? main.configuration.mqttTopicBlacklist : "").trim()
+    property string mqttTopicWhitelist: (main.configuration.mqttTopicWhitelist !== undefined ? main.configuration.mqttTopicWhitelist : "").trim()
+    property string mqttExtractors: (main.configuration.mqttExtractors !== undefined ? main.configuration.mqttExtractors : "").trim()
     property string mqttUsername: (main.configuration.mqttUsername || "").trim()
     property string mqttPassword: (main.configuration.mqttPassword !== undefined && main.configuration.mqttPassword !== null) ? main.configuration.mqttPassword : ""
     property bool   mqttDebug:    main.configuration.mqttDebug    !== undefined ? main.configuration.mqttDebug    : false
     property int    mqttReconnectInterval: main.configuration.mqttReconnectInterval !== undefined ? main.configuration.mqttReconnectInterval : 30
+    property bool   mqttPersistentSession: main.configuration.mqttPersistentSession !== undefined ? main.configuration.mqttPersistentSession : true
+    property string mqttClientId: (main.configuration.mqttClientId || "").trim()
+    property bool   mqttWorkerThread: main.configuration.mqttWorkerThread !== undefined ? main.configuration.mqttWorkerThread : true
+    property bool   mqttSharedConnection: main.configuration.mqttSharedConnection !== undefined ? main.configuration.mqttSharedConnection : true
+    property int    mqttMaxBatchSize: main.configuration.mqttMaxBatchSize !== undefined ? main.configuration.mqttMaxBatchSize : 32
+    property bool   mqttCoalesce: main.configuration.mqttCoalesce !== undefined ? main.configuration.mqttCoalesce : false
+    property bool   mqttWarmStart: main.configuration.mqttWarmStart !== undefined ? main.configuration.mqttWarmStart : true
+    property int    mqttMaxDisplayLength: main.configuration.mqttMaxDisplayLength !== undefined ? main.configuration.mqttMaxDisplayLength : 1024
+    property int    mqttMaxPayloadKB: main.configuration.mqttMaxPayloadKB !== undefined ? main.configuration.mqttMaxPayloadKB : 0
+    property int    mqttMemoryCapMB: main.configuration.mqttMemoryCapMB !== undefined ? main.configuration.mqttMemoryCapMB : 32
+    property int    mqttDropPolicy: main.configuration.mqttDropPolicy !== undefined ? main.configuration.mqttDropPolicy : 0
+    property bool   mqttDiscovery: main.configuration.mqttDiscovery !== undefined ? main.configuration.mqttDiscovery : false
+    property string mqttDiscoveryPrefix: (main.configuration.mqttDiscoveryPrefix !== undefined ? main.configuration.mqttDiscoveryPrefix : "homeassistant").trim()
+    // Debug capture/replay of broker traffic; a replay file replaces the broker
+    property string mqttCaptureFile: (main.configuration.mqttCaptureFile || "").trim()
+    property bool   mqttCaptureCompress: main.configuration.mqttCaptureCompress !== undefined ? main.configuration.mqttCaptureCompress : true
+    property string mqttReplayFile: (main.configuration.mqttReplayFile || "").trim()
     property int    mqttRenderMode: main.configuration.mqttRenderMode !== undefined ? main.configuration.mqttRenderMode : 0
 
     // Debug
     property bool debugOverlay: main.configuration.debugOverlay !== undefined ? main.configuration.debugOverlay : false
 
     // State tracking
-    property var messageHistory: []
     property int messagesReceived: 0
     readonly property int maxHistory: 5
+    // Debug box history, newest first; overwritten in place
+    MessageRing {
+        id: messageHistory
+        capacity: main.maxHistory
+    }
 
     // Color palettes
     property var palettes: [
@@ -59,139 +91,283 @@ WallpaperItem {
     function writeLog(msg)   { console.log("[MQTTRain] " + msg) }
     function writeDebug(msg) { if (mqttDebug) console.log("[MQTTRain][debug] " + msg) }
 
-    function getEffectiveRenderMode() {
-        if (!mqttEnable) return "Classic"
-        var mode = (mqttRenderMode >= 0 && mqttRenderMode < renderModeNames.length) ? mqttRenderMode : 0
-        return renderModeNames[mode]
+    // ===== Visibility =====
+    // A maximised or full-screen window on this screen hides the wallpaper
+    TaskManager.VirtualDesktopInfo { id: virtualDesktopInfo }
+    TaskManager.ActivityInfo { id: activityInfo }
+
+    TaskManager.TasksModel {
+        id: screenTasks
+        filterByScreen:         true
+        filterByVirtualDesktop: true
+        filterByActivity:       true
+        screenGeometry:  Qt.rect(Screen.virtualX, Screen.virtualY, Screen.width, Screen.height)
+        virtualDesktop:  virtualDesktopInfo.currentDesktop
+        activity:        activityInfo.currentActivity
+    }
+
+    Instantiator {
+        id: coveringTasks
+        active: main.pauseWhenHidden
+        model: screenTasks
+        delegate: QtObject {
+            readonly property bool covers: !model.IsMinimized && (model.IsMaximized === true || model.IsFullScreen === true)
+            onCoversChanged: main.updateOcclusion()
+        }
+        onObjectAdded:   main.updateOcclusion()
+        onObjectRemoved: main.updateOcclusion()
+    }
+
+    function updateOcclusion() {
+        var covered = false
+        for (var i = 0; i < coveringTasks.count && !covered; i++) {
+            var t = coveringTasks.objectAt(i)
+            covered = t !== null && t.covers
+        }
+        visibilityWatch.occluded = covered
     }
 
-    // Check if topic should be filtered based on blacklist
-    function shouldFilterTopic(topic) {
-        if (!mqttTopicBlacklist || mqttTopicBlacklist.length === 0) return false
-        var blacklistItems = mqttTopicBlacklist.split(',')
-        for (var i = 0; i < blacklistItems.length; i++) {
-            var item = blacklistItems[i].trim()
-            if (item.length > 0 && topic.indexOf(item) !== -1) {
-                writeDebug("\uD83D\uDEAB Filtered topic: " + topic + " (matches: " + item + ")")
-                return true
+    // Unexposed/minimised window, locked session or an occluding window
+    VisibilityWatch {
+        id: visibilityWatch
+        item:    main
+        enabled: main.pauseWhenHidden
+
+        onShownChanged: {
+            if (shown) {
+                writeLog("\u25B6\uFE0F Wallpaper visible, resuming")
+                // Fresh frame first, then the held latest values fill it
+                matrixCanvas.rebuild()
+                mqttClient.suspended = false
+            } else {
+                writeLog("\u23F8\uFE0F Wallpaper hidden, pausing animation")
+                mqttClient.suspended = true
             }
         }
-        return false
+    }
+
+    function getEffectiveRenderMode() {
+        if (!mqttEnable) return "Classic"
+        var mode = (mqttRenderMode >= 0 && mqttRenderMode < renderModeNames.length) ? mqttRenderMode : 0
+        return renderModeNames[mode]
     }
 
     // ===== MQTT Client =====
     MQTTClient {
         id: mqttClient
         reconnectInterval: main.mqttReconnectInterval * 1000
+        // Filtered topics are dropped in C++ before decoding
+        blacklist:         main.mqttTopicBlacklist
+        whitelist:         main.mqttTopicWhitelist
+        // Only these JSON fields are shown; built once per message in C++
+        extractors:        main.mqttExtractors
+        workerThread:      main.mqttWorkerThread
+        sharedConnection:  main.mqttSharedConnection
+        // At most one batch per animation frame
+        batchInterval:     Math.round(1000 / Math.max(1, main.speed))
+        maxBatchSize:      main.mqttMaxBatchSize
+        dropPolicy:        main.mqttDropPolicy === 1 ? MQTTClient.DropOldest : MQTTClient.KeepNewestPerTopic
+        // Chatty sensors: newest per topic per frame, identical payloads skipped before decoding
+        coalesceByTopic:   main.mqttCoalesce
+        // Only the shown prefix is decoded; oversized payloads are skipped undecoded
+        maxDisplayLength:  main.mqttMaxDisplayLength
+        maxPayloadBytes:   main.mqttMaxPayloadKB * 1024
+        // Whole plasmashell: at the cap new messages are shed, not queued
+        memoryCap:         main.mqttMemoryCapMB * 1024 * 1024
+        // Home Assistant config topics are consumed in C++, not rendered
+        discovery:         main.mqttDiscovery
+        discoveryPrefix:   main.mqttDiscoveryPrefix
+        // Raw broker traffic, for MqttReplay / mqttrain-bench
+        captureFile:       main.mqttEnable && main.mqttReplayFile.length === 0 ? main.mqttCaptureFile : ""
+        captureCompressed: main.mqttCaptureCompress
+        // Latest values of the last session, shown while connecting
+        snapshotSize:      main.mqttWarmStart ? 64 : 0
 
         onConnectedChanged: {
             if (connected) writeLog("\u2705 MQTT Connected")
             else           writeLog("\u274C MQTT Disconnected")
         }
 
-        onReconnecting: {
-            writeLog("\uD83D\uDD04 MQTT reconnecting in " + main.mqttReconnectInterval + "s...")
+        onReconnecting: function(delayMs) {
+            writeLog("\uD83D\uDD04 MQTT reconnecting in " + (delayMs / 1000).toFixed(1) + "s...")
+        }
+
+        // One batch per frame, oldest first
+        onMessagesReceived: function(messages) {
+            if (!messages || messages.length === 0) return
+            main.deliverMessages(messages)
+            main.messagesReceived += messages.length
+        }
+
+        // Snapshot of the last session, before the broker has answered
+        onMessagesRestored: function(messages) {
+            writeLog("\u267B\uFE0F Warm start with " + messages.length + " message(s) from the last session")
+            main.deliverMessages(messages)
+        }
+
+        onConnectionError: function(error) {
+            writeLog("\u274C MQTT Error: " + error)
         }
+    }
 
-        onMessageReceived: function(topic, payload) {
-            var safeTopic   = (topic   != null && topic   !== undefined) ? topic.toString()   : ""
-            var safePayload = (payload != null && payload !== undefined) ? payload.toString() : ""
+    // Stands in for the broker while a replay file is set
+    MqttReplay {
+        id: mqttReplay
+        client:  mqttClient
+        source:  main.mqttReplayFile
+        loop:    true
+        running: main.mqttEnable && main.mqttReplayFile.length > 0
+
+        onRunningChanged: writeLog(running ? "\u23EF\uFE0F Replaying " + source : "\u23F9\uFE0F Replay stopped")
+        onReplayError: function(error) {
+            writeLog("\u274C Replay error: " + error)
+        }
+    }
 
-            writeDebug("\uD83D\uDCE8 [" + safeTopic + "] " + safePayload)
+    function deliverMessages(messages) {
+        var renderer = (mqttEnable && matrixCanvas.activeRenderer) ? matrixCanvas.activeRenderer : null
 
-            // Filter blacklisted topics
-            if (shouldFilterTopic(safeTopic)) return
+        // topic is already a string and payload an MqttPayload handle
+        // sharing the received bytes: pass both on as they are
+        for (var i = 0; i < messages.length; i++) {
+            var m = messages[i]
 
-            messagesReceived++
+            if (mqttDebug) writeDebug("\uD83D\uDCE8 [" + m.topic + "] " + m.payload.toString())
 
-            // Update message history for debug box
-            var hist = messageHistory.slice()
-            hist.unshift({ topic: safeTopic, payload: safePayload })
-            if (hist.length > maxHistory) hist = hist.slice(0, maxHistory)
-            messageHistory = hist
+            messageHistory.push(m.topic, m.payload)
 
             // Delegate to active renderer
-            if (mqttEnable && matrixCanvas.activeRenderer) {
-                matrixCanvas.activeRenderer.assignMessage(safeTopic, safePayload)
-                matrixCanvas.requestPaint()
-            }
+            if (renderer) renderer.assignMessage(m.topic, m.payload, m.display)
         }
 
-        onConnectionError: function(error) {
-            writeLog("\u274C MQTT Error: " + error)
-        }
+        if (renderer) matrixCanvas.requestPaint()
     }
 
     // ===== MQTT Connection Management =====
+    // The broker keeps a persistent session per client ID, so the ID must
+    // survive restarts and differ between screens: generate it once and
+    // store it in this wallpaper instance's configuration.
+    function ensureClientId() {
+        if (mqttClientId.length > 0) return mqttClientId
+        var id = "mqttrain-"
+        for (var i = 0; i < 12; i++)
+            id += Math.floor(Math.random() * 16).toString(16)
+        writeLog("\uD83C\uDD94 Generated MQTT client ID: " + id)
+        main.configuration.mqttClientId = id
+        return id
+    }
+
     function mqttConnect() {
         if (!mqttEnable) {
             mqttClient.disconnectFromHost()
             return
         }
+        if (mqttReplayFile.length > 0) {
+            mqttClient.disconnectFromHost()
+            return
+        }
         writeLog("Connecting to " + mqttHost + ":" + mqttPort + " topic=[" + mqttTopic + "]")
         mqttClient.host     = mqttHost.trim()
         mqttClient.port     = mqttPort
+        mqttClient.transport = mqttTransport
+        mqttClient.path     = mqttPath
         mqttClient.username = mqttUsername.trim()
         mqttClient.password = mqttPassword
+        mqttClient.clientId = ensureClientId()
+        mqttClient.persistentSession = mqttPersistentSession
         mqttClient.topic    = mqttTopic.trim()
         mqttClient.connectToHost()
     }
 
-    // ===== Renderer Instances =====
-    ClassicRenderer {
-        id: classicRenderer
-        fontSize:    main.fontSize
-        baseColor:   main.singleColor
-        jitter:      main.jitter
-        glitchChance: main.glitchChance
-        palettes:    main.palettes
-        paletteIndex: main.paletteIndex
-        colorMode:   main.colorMode
-    }
-
-    MixedModeRenderer {
-        id: mixedRenderer
-        fontSize:    main.fontSize
-        baseColor:   main.singleColor
-        jitter:      main.jitter
-        glitchChance: main.glitchChance
-        palettes:    main.palettes
-        paletteIndex: main.paletteIndex
-        colorMode:   main.colorMode
-    }
-
-    MqttOnlyRenderer {
-        id: mqttOnlyRenderer
-        fontSize:    main.fontSize
-        baseColor:   main.singleColor
-        jitter:      main.jitter
-        glitchChance: main.glitchChance
-        palettes:    main.palettes
-        paletteIndex: main.paletteIndex
-        colorMode:   main.colorMode
-        messagePoolSize: 20
-    }
-
-    MqttDrivenRenderer {
-        id: mqttDrivenRenderer
-        fontSize:    main.fontSize
-        baseColor:   main.singleColor
-        jitter:      main.jitter
-        glitchChance: main.glitchChance
-        palettes:    main.palettes
-        paletteIndex: main.paletteIndex
-        colorMode:   main.colorMode
-    }
-
-    HorizontalInjectRenderer {
-        id: horizontalInjectRenderer
-        fontSize:    main.fontSize
-        baseColor:   main.singleColor
-        jitter:      main.jitter
-        glitchChance: main.glitchChance
-        palettes:    main.palettes
-        paletteIndex: main.paletteIndex
-        colorMode:   main.colorMode
+    // ===== Renderers =====
+    // Only the active renderer exists: the Loader builds it on a mode
+    // switch (and frees the previous one), then refills it from the
+    // client's recent messages so the new mode does not start empty.
+    Component {
+        id: classicComponent
+        ClassicRenderer {
+            fontSize:    main.fontSize
+            baseColor:   main.singleColor
+            jitter:      main.jitter
+            glitchChance: main.glitchChance
+            palettes:    main.palettes
+            paletteIndex: main.paletteIndex
+            colorMode:   main.colorMode
+        }
+    }
+
+    Component {
+        id: mixedComponent
+        MixedModeRenderer {
+            fontSize:    main.fontSize
+            baseColor:   main.singleColor
+            jitter:      main.jitter
+            glitchChance: main.glitchChance
+            palettes:    main.palettes
+            paletteIndex: main.paletteIndex
+            colorMode:   main.colorMode
+        }
+    }
+
+    Component {
+        id: mqttOnlyComponent
+        MqttOnlyRenderer {
+            fontSize:    main.fontSize
+            baseColor:   main.singleColor
+            jitter:      main.jitter
+            glitchChance: main.glitchChance
+            palettes:    main.palettes
+            paletteIndex: main.paletteIndex
+            colorMode:   main.colorMode
+            messagePoolSize: 20
+        }
+    }
+
+    Component {
+        id: mqttDrivenComponent
+        MqttDrivenRenderer {
+            fontSize:    main.fontSize
+            baseColor:   main.singleColor
+            jitter:      main.jitter
+            glitchChance: main.glitchChance
+            palettes:    main.palettes
+            paletteIndex: main.paletteIndex
+            colorMode:   main.colorMode
+        }
+    }
+
+    Component {
+        id: horizontalInjectComponent
+        HorizontalInjectRenderer {
+            fontSize:    main.fontSize
+            baseColor:   main.singleColor
+            jitter:      main.jitter
+            glitchChance: main.glitchChance
+            palettes:    main.palettes
+            paletteIndex: main.paletteIndex
+            colorMode:   main.colorMode
+        }
+    }
+
+    Loader {
+        id: rendererLoader
+        sourceComponent: {
+            if (!main.mqttEnable) return classicComponent
+            switch (main.mqttRenderMode) {
+                case 0:  return mixedComponent
+                case 1:  return mqttOnlyComponent
+                case 2:  return mqttDrivenComponent
+                case 3:  return horizontalInjectComponent
+                default: return mixedComponent
+            }
+        }
+
+        onLoaded: {
+            if (!main.mqttEnable) return
+            var recent = mqttClient.recentMessages()
+            for (var i = 0; i < recent.length; i++)
+                item.assignMessage(recent[i].topic, recent[i].payload, recent[i].display)
+        }
     }
 
     // ===== Matrix Canvas =====
@@ -203,20 +379,26 @@ WallpaperItem {
         speed:        main.speed
         fadeStrength: main.fadeStrength
         mqttEnable:   main.mqttEnable
-
-        activeRenderer: {
-            if (!main.mqttEnable) return classicRenderer
-            switch (main.mqttRenderMode) {
-                case 0:  return mixedRenderer
-                case 1:  return mqttOnlyRenderer
-                case 2:  return mqttDrivenRenderer
-                case 3:  return horizontalInjectRenderer
-                default: return mixedRenderer
-            }
-        }
+        gpuFade:      main.gpuFade
+        adaptiveQuality: main.adaptiveQuality
+        renderThreads: main.renderThreads
+        // Re-evaluated only when colorMode, singleColor or paletteIndex change
+        colors:       main.colorMode === 0 ? [main.singleColor] : main.palettes[main.paletteIndex]
+        running:      visibilityWatch.shown
+        seed:         main.randomSeed
+
+        activeRenderer: rendererLoader.item
     }
 
     // ===== Debug Box =====
+    // Sampled once a second, and only while the overlay is shown
+    RainStats {
+        id: rainStats
+        active:   main.debugOverlay
+        rainItem: matrixCanvas.rainItem
+        client:   mqttClient
+    }
+
     MQTTDebugOverlay {
         id: debugOverlay
         anchors.fill: parent
@@ -226,22 +408,21 @@ WallpaperItem {
         mqttHost:         main.mqttHost
         mqttPort:         main.mqttPort
         mqttTopic:        main.mqttTopic
-        reconnectInterval: main.mqttReconnectInterval
         messagesReceived: main.messagesReceived
-        fadeStrength:     main.fadeStrength
+        messagesDropped:  mqttClient.droppedMessages
+        messagesCoalesced: main.mqttCoalesce ? mqttClient.coalescedMessages : -1
+        messagesOversized: mqttClient.oversizedMessages
+        filterHits:       mqttClient.filterHits
+        discoveredEntities: main.mqttDiscovery ? mqttClient.discoveredEntities : -1
         renderMode:       main.getEffectiveRenderMode()
-        messageHistory:   main.messageHistory
-
-        activeColumns: {
-            if (!matrixCanvas.activeRenderer) return 0
-            var ca = matrixCanvas.activeRenderer.columnAssignments
-            if (!ca) return 0
-            var count = 0
-            for (var i = 0; i < ca.length; i++) {
-                if (ca[i] !== null && (ca[i].active !== false)) count++
-            }
-            return count
-        }
+        renderIdle:       matrixCanvas.idle
+        qualityLevel:     main.adaptiveQuality ? matrixCanvas.rainItem.qualityName : ""
+        messageHistory:   messageHistory
+        stats:            rainStats
+
+        // Maintained incrementally by the renderer's ColumnState
+        activeColumns: (matrixCanvas.activeRenderer && matrixCanvas.activeRenderer.columnState)
+                       ? matrixCanvas.activeRenderer.columnState.activeCount : 0
 
         totalColumns: matrixCanvas.activeRenderer ? matrixCanvas.activeRenderer.columns : 0
     }
@@ -255,8 +436,17 @@ WallpaperItem {
     onPaletteIndexChanged: matrixCanvas.requestPaint()
     onJitterChanged:      matrixCanvas.requestPaint()
     onGlitchChanceChanged: matrixCanvas.requestPaint()
+    onGpuFadeChanged:     writeLog("\uD83C\uDFA8 GPU fade " + (gpuFade ? "enabled" : "disabled"))
+    onAdaptiveQualityChanged: writeLog("\uD83C\uDF9A\uFE0F Adaptive quality " + (adaptiveQuality ? "enabled" : "disabled"))
+    onRenderThreadsChanged: writeLog("\uD83E\uDDF5 Render threads " + (renderThreads > 0 ? renderThreads : "one per core"))
+    onRandomSeedChanged:  writeLog("\uD83C\uDFB2 Random seed " + (randomSeed !== 0 ? randomSeed : "off"))
     onDebugOverlayChanged: matrixCanvas.requestPaint()
 
+    onPauseWhenHiddenChanged: {
+        writeLog("\u23F8\uFE0F Pause when hidden " + (pauseWhenHidden ? "enabled" : "disabled"))
+        updateOcclusion()
+    }
+
     onMqttRenderModeChanged: {
         if (mqttEnable) {
             var mode = (mqttRenderMode >= 0 && mqttRenderMode < renderModeNames.length) ? mqttRenderMode : 0
@@ -281,17 +471,63 @@ WallpaperItem {
 
     onMqttHostChanged:  { if (mqttEnable) mqttConnect() }
     onMqttPortChanged:  { if (mqttEnable) mqttConnect() }
+    onMqttTransportChanged: { if (mqttEnable) mqttConnect() }
+    onMqttPathChanged:  { if (mqttEnable && mqttTransport >= MQTTClient.WebSocket) mqttConnect() }
+    onMqttPersistentSessionChanged: { if (mqttEnable) mqttConnect() }
+    // Also fires when ensureClientId() stores a fresh ID; that one is in use already
+    onMqttClientIdChanged: { if (mqttEnable && mqttClient.clientId !== mqttClientId) mqttConnect() }
+    // Subscriptions are diffed in C++: only changed entries are (un)subscribed
     onMqttTopicChanged: {
-        if (mqttEnable && mqttClient.connected) {
-            mqttClient.disconnectFromHost()
-            mqttConnect()
-        }
+        writeLog("\uD83D\uDCE1 Topics updated: [" + mqttTopic + "]")
+        mqttClient.topic = mqttTopic
+    }
+
+    onMqttReplayFileChanged: { if (mqttEnable) mqttConnect() }
+
+    onMqttWorkerThreadChanged: {
+        writeLog("\uD83E\uDDF5 MQTT worker thread " + (mqttWorkerThread ? "enabled" : "disabled"))
+    }
+
+    onMqttSharedConnectionChanged: {
+        writeLog("\uD83D\uDD17 MQTT shared connection " + (mqttSharedConnection ? "enabled" : "disabled"))
+    }
+
+    onMqttMaxPayloadKBChanged: {
+        writeLog("\uD83D\uDCE6 Max payload size: " + (mqttMaxPayloadKB > 0 ? mqttMaxPayloadKB + " KB" : "no limit"))
+    }
+
+    onMqttMemoryCapMBChanged: {
+        writeLog("\uD83E\uDDE0 Message memory cap: " + (mqttMemoryCapMB > 0 ? mqttMemoryCapMB + " MB" : "no limit"))
+    }
+
+    onMqttCaptureFileChanged: {
+        writeLog("\u23FA\uFE0F MQTT capture " + (mqttCaptureFile.length > 0 ? "to " + mqttCaptureFile : "off"))
+    }
+
+    onMqttCoalesceChanged: {
+        writeLog("\uD83E\uDDF9 Coalesce by topic " + (mqttCoalesce ? "enabled" : "disabled"))
+    }
+
+    onMqttDiscoveryChanged: {
+        writeLog("\uD83C\uDFE0 HA discovery " + (mqttDiscovery ? "enabled under " + mqttDiscoveryPrefix : "disabled"))
+    }
+
+    onMqttDiscoveryPrefixChanged: {
+        writeLog("\uD83C\uDFE0 HA discovery prefix: " + mqttDiscoveryPrefix)
     }
 
     onMqttTopicBlacklistChanged: {
         writeLog("\uD83D\uDEAB Topic blacklist updated: [" + mqttTopicBlacklist + "]")
     }
 
+    onMqttTopicWhitelistChanged: {
+        writeLog("\u2714\uFE0F Topic whitelist updated: [" + mqttTopicWhitelist + "]")
+    }
+
+    onMqttExtractorsChanged: {
+        writeLog("\uD83E\uDDE9 Payload field rules updated: [" + mqttExtractors.replace(/\n/g, "; ") + "]")
+    }
+
     // ===== Initialization =====
     Component.onCompleted: {
         writeLog("=== Matrix Rain MQTT Wallpaper ===")
@@ -303,7 +539,10 @@ WallpaperItem {
             writeLog("MQTT host=[" + mqttHost + "] port=" + mqttPort + " topic=[" + mqttTopic + "]")
             if (mqttTopicBlacklist.length > 0)
                 writeLog("\uD83D\uDEAB Topic blacklist: [" + mqttTopicBlacklist + "]")
-            writeLog("\uD83D\uDD04 Reconnect interval: " + mqttReconnectInterval + "s")
+            if (mqttTopicWhitelist.length > 0)
+                writeLog("\u2714\uFE0F Topic whitelist: [" + mqttTopicWhitelist + "]")
+            writeLog("\uD83D\uDD04 Reconnect backoff up to " + mqttReconnectInterval + "s"
+                     + (mqttPersistentSession ? ", persistent session" : ""))
             writeLog("\uD83C\uDFAD Render mode: " + renderModeNames[mqttRenderMode])
             Qt.callLater(mqttConnect)
         } else {
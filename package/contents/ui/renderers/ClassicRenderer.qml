@@ -3,13 +3,12 @@
 // Used as fallback when MQTT is disabled
 
 import QtQuick 2.15
-import "../utils/ColorUtils.js" as ColorUtils
+import ObsidianReq.MQTTRain 1.0
 
 Item {
     id: renderer
     
-    // Column state (not used, but required for interface compatibility)
-    property var columnAssignments: []
+    // Column count (no columnState: classic mode tracks no messages)
     property int columns: 0
     
     // Rendering configuration
@@ -24,30 +23,20 @@ Item {
     /**
      * Classic mode doesn't process MQTT messages
      */
-    function assignMessage(topic, payload) {
+    function assignMessage(topic, payload, display) {
         // No-op: classic mode ignores MQTT
     }
     
     /**
      * Render random Matrix character for column
      */
-    function renderColumnContent(ctx, columnIndex, x, y, drops) {
-        // Determine base color
-        var color = (colorMode === 0)
-            ? baseColor.toString()
-            : palettes[paletteIndex][columnIndex % palettes[paletteIndex].length]
-        
+    function renderColumnContent(ctx, columnIndex, x, y, drops, rand, charIndex) {
         // Random glitch effect
-        var isGlitch = (Math.random() < glitchChance / 100)
-        
-        // Random Katakana character (U+30A0 to U+30FF)
-        var ch = String.fromCharCode(0x30A0 + Math.floor(Math.random() * 96))
-        
-        // Set color
-        ctx.fillStyle = isGlitch ? "#ffffff" : color
+        var isGlitch = (rand[columnIndex] < glitchChance / 100)
         
-        // Render character
-        ctx.fillText(ch, x, y)
+        // Random Katakana character (U+30A0 to U+30FF) in the column colour,
+        // both resolved natively from the prebuilt palette
+        ctx.randomGlyph(columnIndex, isGlitch ? RainPainter.Glitch : RainPainter.Base, x, y)
     }
     
     /**
@@ -63,12 +52,6 @@ Item {
     function initializeColumns(numColumns) {
         console.log("[ClassicRenderer] initializeColumns: numColumns=" + numColumns)
         
-        // Create placeholder array for interface compatibility
-        var newCA = []
-        for (var i = 0; i < numColumns; i++) {
-            newCA.push(null)
-        }
-        columnAssignments = newCA
         columns = numColumns
     }
 }
@@ -3,13 +3,14 @@
 // MQTT chars are injected as horizontal, time-limited obstacle cells.
 
 import QtQuick 2.15
+import ObsidianReq.MQTTRain 1.0
 import "../utils/MatrixRainLogic.js" as Logic
-import "../utils/ColorUtils.js" as ColorUtils
 
 Item {
     id: renderer
 
-    property var columnAssignments: []
+    // A column is active while it holds at least one MQTT cell (kept by cellGrid)
+    readonly property alias columnState: slots
     property int columns: 0
 
     property int fontSize: 16
@@ -26,115 +27,46 @@ Item {
 
     property int rows: 0
     property int mqttCellLifetimeMs: 3000
+    readonly property real acceleratedFadeAlpha: 1 - Math.pow(1 - fadeStrength, 30)
+    readonly property string acceleratedFadeStyle: "rgba(0,0,0," + acceleratedFadeAlpha + ")"
 
-    property var mqttCells: ({})
-    property var activeCellCountByColumn: []
-
-    function cellKey(col, row) {
-        return col + ":" + row
-    }
+    // Obstacle cells: native dense grid, expiry driven by a min-heap
+    readonly property alias cellGrid: grid
 
     function rowCountFromCanvas() {
         if (fontSize <= 0 || canvasHeight <= 0) return 1
         return Math.max(1, Math.floor(canvasHeight / fontSize))
     }
 
-    function ensureGridMetrics() {
-        rows = rowCountFromCanvas()
-    }
-
-    function updateColumnActive(columnIndex) {
-        var isActive = activeCellCountByColumn[columnIndex] > 0
-        var newCA = columnAssignments.slice()
-        newCA[columnIndex] = isActive ? { active: true } : null
-        columnAssignments = newCA
-    }
-
-    function removeCellByKey(key) {
-        var existing = mqttCells[key]
-        if (!existing) return
-
-        delete mqttCells[key]
-
-        var col = existing.col
-        if (col >= 0 && col < activeCellCountByColumn.length) {
-            activeCellCountByColumn[col] = Math.max(0, activeCellCountByColumn[col] - 1)
-            updateColumnActive(col)
-        }
-    }
-
-    function setCell(col, row, entry, expiresAt) {
-        var key = cellKey(col, row)
-        var existing = mqttCells[key]
-
-        if (!existing) {
-            activeCellCountByColumn[col] += 1
-            updateColumnActive(col)
-        }
-
-        mqttCells[key] = {
-            col: col,
-            row: row,
-            ch: (entry && entry.ch) ? entry.ch : " ",
-            isValue: !!(entry && entry.isValue),
-            expiresAt: expiresAt
-        }
-    }
-
-    function cleanupExpiredCells(nowMs) {
-        // Non rimuoviamo le celle scadute - lasciamole fare fade naturale
-        // Verranno rimosse solo quando un drop Katakana ci passa sopra
-    }
-
-    function assignMessage(topic, payload) {
-        if (columns <= 0) return
+    function assignMessage(topic, payload, display) {
+        if (columns <= 0 || rows <= 0) return
 
-        ensureGridMetrics()
-
-        var chars = Logic.buildDisplayChars(topic, payload)
+        var chars = Logic.buildDisplayChars(topic, payload, display)
         if (!chars || chars.length === 0) return
 
-        cleanupExpiredCells(Date.now())
-
-        var row = Math.floor(Math.random() * rows)
-        var startCol = Math.floor(Math.random() * columns)
-        var expiresAt = Date.now() + mqttCellLifetimeMs
-
-        for (var i = 0; i < chars.length; i++) {
-            var col = (startCol + i) % columns
-            setCell(col, row, chars[i], expiresAt)
-        }
+        var row = slots.randomIndex(rows)
+        var startCol = slots.randomIndex(columns)
+        grid.inject(row, startCol, chars.text, mqttCellLifetimeMs)
     }
 
-    function renderColumnContent(ctx, columnIndex, x, y, drops) {
-        ensureGridMetrics()
-
+    function renderColumnContent(ctx, columnIndex, x, y, drops, rand, charIndex) {
         var row = Math.floor(drops[columnIndex])
         if (row < 0 || row >= rows) return
 
-        var key = cellKey(columnIndex, row)
-        var cell = mqttCells[key]
-        if (cell) {
-            if (cell.expiresAt > Date.now()) {
-                return  // Salto ostacolo: cella MQTT ancora attiva
-            }
+        var state = grid.state(columnIndex, row)
+        if (state === CellGrid.Live) {
+            return  // Salto ostacolo: cella MQTT ancora attiva
+        }
+        if (state === CellGrid.Expired) {
             // Cella scaduta: applica fade accelerato (equivalente a ~30 frame di fade naturale)
-            for (var i = 0; i < 30; i++) {
-                ctx.fillStyle = "rgba(0,0,0," + fadeStrength + ")"
-                ctx.fillRect(x, y - fontSize, fontSize, fontSize)
-            }
-            removeCellByKey(key)
+            // in a single fill: 30 × alpha a compose to 1 - (1 - a)^30.
+            ctx.fillStyle = acceleratedFadeStyle
+            ctx.fillRect(x, y - fontSize, fontSize, fontSize)
+            grid.clear(columnIndex, row)
         }
 
-        var color = (colorMode === 0)
-            ? baseColor.toString()
-            : palettes[paletteIndex][columnIndex % palettes[paletteIndex].length]
-
-        var isGlitch = (Math.random() < glitchChance / 100)
-        var ch = String.fromCharCode(0x30A0 + Math.floor(Math.random() * 96))
-
-        ctx.fillStyle = isGlitch ? "#ffffff" : color
-        ctx.fillText(ch, x, y)
+        var isGlitch = (rand[columnIndex] < glitchChance / 100)
+        ctx.randomGlyph(columnIndex, isGlitch ? RainPainter.Glitch : RainPainter.Base, x, y)
     }
 
     function onColumnWrap(columnIndex) {
@@ -142,45 +74,23 @@ Item {
     }
 
     function renderInlineChars(ctx) {
-        ensureGridMetrics()
-
-        var now = Date.now()
-        cleanupExpiredCells(now)
-
-        var keys = Object.keys(mqttCells)
-        for (var i = 0; i < keys.length; i++) {
-            var cell = mqttCells[keys[i]]
-            if (!cell) continue
-            
-            // Non ridisegnare celle scadute (lasciale fare fade naturale)
-            if (cell.expiresAt <= now) continue
-
-            var color = (colorMode === 0)
-                ? baseColor.toString()
-                : palettes[paletteIndex][cell.col % palettes[paletteIndex].length]
-
-            var x = cell.col * fontSize
-            var y = cell.row * fontSize
-
-            ctx.fillStyle = color
-            ctx.fillText(cell.ch, x, y)
-        }
+        // Live cells only, in the ctx palette; expired ones keep fading naturally
+        grid.paint(ctx)
     }
 
     function initializeColumns(numColumns) {
-        ensureGridMetrics()
-
+        rows = rowCountFromCanvas()
         columns = numColumns
 
-        var newCA = []
-        var newCounts = []
-        for (var i = 0; i < numColumns; i++) {
-            newCA.push(null)
-            newCounts.push(0)
-        }
+        slots.reset(numColumns)
+        grid.reset(numColumns, rows)
+    }
+
+    ColumnState { id: slots }
 
-        columnAssignments = newCA
-        activeCellCountByColumn = newCounts
-        mqttCells = ({})
+    CellGrid {
+        id: grid
+        cellSize: renderer.fontSize
+        columnState: slots
     }
 }
@@ -3,14 +3,14 @@
 // MQTT messages are assigned to random columns; other columns show random chars
 
 import QtQuick 2.15
+import ObsidianReq.MQTTRain 1.0
 import "../utils/MatrixRainLogic.js" as Logic
-import "../utils/ColorUtils.js" as ColorUtils
 
 Item {
     id: renderer
     
-    // Column state
-    property var columnAssignments: []
+    // Column state: native slot pool, updated in place
+    readonly property alias columnState: slots
     property int columns: 0
     
     // Rendering configuration
@@ -25,16 +25,12 @@ Item {
     /**
      * Assign incoming MQTT message to a random free column
      */
-    function assignMessage(topic, payload) {
-        var chars = Logic.buildDisplayChars(topic, payload)
+    function assignMessage(topic, payload, display) {
+        var chars = Logic.buildDisplayChars(topic, payload, display)
         
         console.log("[MixedModeRenderer] assignMessage: topic=" + topic + ", chars.length=" + chars.length)
         
-        // Logic.assignMessageToColumn mutates the array in-place
-        // We need to clone, mutate, then reassign to trigger property change
-        var newCA = columnAssignments.slice()
-        Logic.assignMessageToColumn(chars, newCA, 3)
-        columnAssignments = newCA
+        slots.assignRandom(chars, 3)
     }
     
     /**
@@ -44,56 +40,31 @@ Item {
      * @param x - X position
      * @param y - Y position
      * @param drops - Drops array
+     * @param rand - This tick's uniform [0,1) value per column (seedable, native)
+     * @param charIndex - (floor(drop) + column) % chars length per column, from slots
      */
-    function renderColumnContent(ctx, columnIndex, x, y, drops) {
-        var assignment = columnAssignments[columnIndex]
-        var ch
+    function renderColumnContent(ctx, columnIndex, x, y, drops, rand, charIndex) {
+        var slotChars = slots.chars(columnIndex)
         
-        // Determine base color
-        var color = (colorMode === 0)
-            ? baseColor.toString()
-            : palettes[paletteIndex][columnIndex % palettes[paletteIndex].length]
+        var isGlitch = (rand[columnIndex] < glitchChance / 100)
+        var slotLen = (slotChars !== undefined && slotChars) ? slotChars.length : 0
         
-        var isGlitch = (Math.random() < glitchChance / 100)
-        
-        if (assignment !== null) {
+        if (slotLen > 0) {
             // Column has MQTT message
-            var slotChars = assignment.chars
-            var slotLen = slotChars ? slotChars.length : 0
+            var idx = charIndex[columnIndex]
             
-            if (slotLen > 0) {
-                var r = Math.floor(drops[columnIndex])
-                var idx = (r + columnIndex) % slotLen
-                var entry = (idx >= 0 && idx < slotLen) ? slotChars[idx] : null
-                
-                if (entry && typeof entry.ch === "string" && entry.ch.length > 0) {
-                    ch = entry.ch
-                    
-                    if (isGlitch) {
-                        ctx.fillStyle = "#ffffff"
-                    } else if (entry.isValue) {
-                        // Lighten value characters
-                        ctx.fillStyle = ColorUtils.lightenColor(color, 0.55)
-                    } else {
-                        ctx.fillStyle = color
-                    }
-                } else {
-                    // Fallback to random
-                    ch = String.fromCharCode(0x30A0 + Math.floor(Math.random() * 96))
-                    ctx.fillStyle = isGlitch ? "#ffffff" : color
-                }
-            } else {
-                // Empty assignment: random
-                ch = String.fromCharCode(0x30A0 + Math.floor(Math.random() * 96))
-                ctx.fillStyle = isGlitch ? "#ffffff" : color
+            if (idx >= 0 && idx < slotLen) {
+                // Value characters use the lightened shade
+                var shade = isGlitch ? RainPainter.Glitch
+                          : Logic.isValueAt(slotChars, idx) ? RainPainter.Value
+                          : RainPainter.Base
+                ctx.glyph(Logic.codeAt(slotChars, idx), columnIndex, shade, x, y)
+                return
             }
-        } else {
-            // Free column: random Matrix characters
-            ch = String.fromCharCode(0x30A0 + Math.floor(Math.random() * 96))
-            ctx.fillStyle = isGlitch ? "#ffffff" : color
         }
         
-        ctx.fillText(ch, x, y)
+        // Free column or empty assignment: random Matrix characters
+        ctx.randomGlyph(columnIndex, isGlitch ? RainPainter.Glitch : RainPainter.Base, x, y)
     }
     
     /**
@@ -101,18 +72,8 @@ Item {
      * @param columnIndex - Column that wrapped
      */
     function onColumnWrap(columnIndex) {
-        if (columnAssignments[columnIndex] !== null) {
-            // Clone array to trigger property change
-            var newCA = columnAssignments.slice()
-            newCA[columnIndex].passesLeft -= 1
-            
-            if (newCA[columnIndex].passesLeft <= 0) {
-                // Free the column
-                newCA[columnIndex] = null
-            }
-            
-            columnAssignments = newCA
-        }
+        // Frees the column once its passes are used up
+        slots.wrap(columnIndex)
     }
     
     /**
@@ -122,11 +83,9 @@ Item {
     function initializeColumns(numColumns) {
         console.log("[MixedModeRenderer] initializeColumns: numColumns=" + numColumns)
         
-        var newCA = []
-        for (var i = 0; i < numColumns; i++) {
-            newCA.push(null)
-        }
-        columnAssignments = newCA
+        slots.reset(numColumns)
         columns = numColumns
     }
+    
+    ColumnState { id: slots }
 }
@@ -3,18 +3,18 @@
 // All columns display messages from a rotating pool
 
 import QtQuick 2.15
+import ObsidianReq.MQTTRain 1.0
 import "../utils/MatrixRainLogic.js" as Logic
-import "../utils/ColorUtils.js" as ColorUtils
 
 Item {
     id: renderer
     
-    // Column state
-    property var columnAssignments: []
+    // Column state: native slot pool, updated in place
+    readonly property alias columnState: slots
     property int columns: 0
     
-    // Message pool for rotation
-    property var messagePool: []
+    // Message pool for rotation: native ring, newest first, overwritten in place
+    readonly property alias messagePool: pool
     property int messagePoolSize: 20
     
     // Rendering configuration
@@ -29,25 +29,13 @@ Item {
     /**
      * Assign incoming MQTT message to pool and redistribute
      */
-    function assignMessage(topic, payload) {
-        var chars = Logic.buildDisplayChars(topic, payload)
+    function assignMessage(topic, payload, display) {
+        var chars = Logic.buildDisplayChars(topic, payload, display)
         
         console.log("[MqttOnlyRenderer] assignMessage: topic=" + topic + ", chars.length=" + chars.length)
         
-        // Add to message pool
-        var newPool = messagePool.slice() // Copy array
-        newPool.push({
-            topic: topic,
-            payload: payload,
-            chars: chars
-        })
-        
-        // Limit pool size
-        if (newPool.length > messagePoolSize) {
-            newPool.shift() // Remove oldest
-        }
-        
-        messagePool = newPool // Trigger property change
+        // Add to message pool; the ring drops the oldest past messagePoolSize
+        pool.push(topic, payload, chars)
         
         // Redistribute messages across all columns
         redistributeMessages()
@@ -55,63 +43,38 @@ Item {
     
     /**
      * Distribute messages from pool to all columns
-     * CRITICAL: Must create NEW array, not mutate existing one
      */
     function redistributeMessages() {
-        if (messagePool.length === 0) {
+        if (pool.count === 0) {
             console.log("[MqttOnlyRenderer] redistributeMessages: pool empty")
             return
         }
         
-        console.log("[MqttOnlyRenderer] redistributeMessages: pool.length=" + messagePool.length + ", columns=" + columns)
+        console.log("[MqttOnlyRenderer] redistributeMessages: pool.count=" + pool.count + ", columns=" + columns)
         
-        // Create NEW array (QML property system requirement)
-        var newCA = []
+        // Slots are overwritten in place; negative passes never free them
         for (var i = 0; i < columns; i++) {
-            var msgIndex = i % messagePool.length
-            newCA.push({
-                chars: messagePool[msgIndex].chars,
-                passesLeft: 999999 // Never free
-            })
+            slots.assign(i, pool.chars(i % pool.count), -1)
         }
         
-        // Replace array to trigger property notification
-        columnAssignments = newCA
-        
-        console.log("[MqttOnlyRenderer] redistributeMessages: assigned " + newCA.length + " columns")
+        console.log("[MqttOnlyRenderer] redistributeMessages: assigned " + columns + " columns")
     }
     
     /**
      * Render content for a single column
      */
-    function renderColumnContent(ctx, columnIndex, x, y, drops) {
-        var assignment = columnAssignments[columnIndex]
+    function renderColumnContent(ctx, columnIndex, x, y, drops, rand, charIndex) {
+        var slotChars = slots.chars(columnIndex)
         
-        // Determine base color
-        var color = (colorMode === 0)
-            ? baseColor.toString()
-            : palettes[paletteIndex][columnIndex % palettes[paletteIndex].length]
+        var isGlitch = (rand[columnIndex] < glitchChance / 100)
         
-        var isGlitch = (Math.random() < glitchChance / 100)
-        
-        if (assignment !== null && assignment.chars && assignment.chars.length > 0) {
-            // Render from message chars
-            var slotChars = assignment.chars
-            var r = Math.floor(drops[columnIndex])
-            var idx = (r + columnIndex) % slotChars.length
-            var entry = slotChars[idx]
-            
-            var ch = (entry && entry.ch) ? entry.ch : "?"
-            
-            if (isGlitch) {
-                ctx.fillStyle = "#ffffff"
-            } else if (entry && entry.isValue) {
-                ctx.fillStyle = ColorUtils.lightenColor(color, 0.55)
-            } else {
-                ctx.fillStyle = color
-            }
-            
-            ctx.fillText(ch, x, y)
+        if (slotChars !== undefined && slotChars.length > 0) {
+            // Render from message chars, colour from the prebuilt palette
+            var idx = charIndex[columnIndex]
+            var shade = isGlitch ? RainPainter.Glitch
+                      : Logic.isValueAt(slotChars, idx) ? RainPainter.Value
+                      : RainPainter.Base
+            ctx.glyph(Logic.codeAt(slotChars, idx), columnIndex, shade, x, y)
         } else {
             // No messages yet: show placeholder
             ctx.fillStyle = "#333333"
@@ -132,17 +95,16 @@ Item {
     function initializeColumns(numColumns) {
         console.log("[MqttOnlyRenderer] initializeColumns: numColumns=" + numColumns)
         
-        var newCA = []
-        for (var i = 0; i < numColumns; i++) {
-            newCA.push(null)
-        }
-        columnAssignments = newCA
+        slots.reset(numColumns)
         columns = numColumns
         
         // Redistribute existing messages if any
-        if (messagePool.length > 0) {
-            console.log("[MqttOnlyRenderer] initializeColumns: redistributing existing " + messagePool.length + " messages")
+        if (pool.count > 0) {
+            console.log("[MqttOnlyRenderer] initializeColumns: redistributing existing " + pool.count + " messages")
             redistributeMessages()
         }
     }
+    
+    ColumnState { id: slots }
+    MessageRing { id: pool; capacity: renderer.messagePoolSize }
 }
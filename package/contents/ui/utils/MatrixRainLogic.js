@@ -2,11 +2,43 @@
 .pragma library
 
 /**
- * Tag each character of a JSON string as key or value
+ * Compact display chars: one string plus one flag byte per character
+ * (1 = JSON value, 0 = key/structure). Produced by the C++
+ * PayloadTokenizer; the functions below are the JS fallback and accessors.
+ *
+ *   { text: "...", flags: Uint8Array, length: text.length }
+ */
+function emptyChars() {
+    return { text: "", flags: new Uint8Array(0), length: 0 }
+}
+
+/**
+ * Character at idx (caller keeps idx within 0..length-1)
+ */
+function charAt(chars, idx) {
+    return chars.text.charAt(idx)
+}
+
+/**
+ * UTF-16 code at idx, for ctx.glyph() (no one-character string is built)
+ */
+function codeAt(chars, idx) {
+    return chars.text.charCodeAt(idx)
+}
+
+/**
+ * Whether the character at idx is a JSON value
+ */
+function isValueAt(chars, idx) {
+    return chars.flags[idx] === 1
+}
+
+/**
+ * Tag each character of a JSON string as key or value (JS fallback)
  * @param {string} json - JSON string to process
- * @param {Array} result - Output array of {ch, isValue} objects
+ * @param {Uint8Array} flags - Output flags, set to 1 for value chars
  */
-function colorJsonChars(json, result) {
+function colorJsonChars(json, flags) {
     if (!json || json.length === 0) return
     
     var ST_STRUCT = 0, ST_IN_KEY = 1, ST_IN_VAL_STR = 2, ST_IN_VAL_NUM = 3
@@ -23,40 +55,32 @@ function colorJsonChars(json, result) {
                         state = ST_IN_VAL_STR
                         afterColon = false
                         escaped = false
-                        result.push({ ch: ch, isValue: true })
+                        flags[i] = 1
                     } else {
                         state = ST_IN_KEY
                         escaped = false
-                        result.push({ ch: ch, isValue: false })
                     }
                 } else if (ch === '[') {
                     arrayDepth++
                     afterColon = false
-                    result.push({ ch: ch, isValue: false })
                 } else if (ch === ']') {
                     if (arrayDepth > 0) arrayDepth--
-                    result.push({ ch: ch, isValue: false })
                 } else if (ch === '{' || ch === '}' || ch === ',') {
                     afterColon = false
-                    result.push({ ch: ch, isValue: false })
                 } else if (ch === ':') {
                     afterColon = true
-                    result.push({ ch: ch, isValue: false })
                 } else if (ch === ' ' || ch === '\t' || ch === '\n' || ch === '\r') {
-                    result.push({ ch: ch, isValue: false })
+                    // whitespace: structure
                 } else if (afterColon || arrayDepth > 0) {
                     state = ST_IN_VAL_NUM
                     afterColon = false
-                    result.push({ ch: ch, isValue: true })
-                } else {
-                    result.push({ ch: ch, isValue: false })
+                    flags[i] = 1
                 }
             } else if (state === ST_IN_KEY) {
-                result.push({ ch: ch, isValue: false })
                 if (ch === '"' && !escaped) state = ST_STRUCT
                 escaped = (ch === '\\' && !escaped)
             } else if (state === ST_IN_VAL_STR) {
-                result.push({ ch: ch, isValue: true })
+                flags[i] = 1
                 if (ch === '"' && !escaped) state = ST_STRUCT
                 escaped = (ch === '\\' && !escaped)
             } else if (state === ST_IN_VAL_NUM) {
@@ -64,97 +88,59 @@ function colorJsonChars(json, result) {
                     state = ST_STRUCT
                     afterColon = false
                     if (ch === ']' && arrayDepth > 0) arrayDepth--
-                    result.push({ ch: ch, isValue: false })
                 } else {
-                    result.push({ ch: ch, isValue: true })
+                    flags[i] = 1
                 }
             }
         }
     } catch(e) {
         console.log("[MatrixRainLogic] colorJsonChars error at pos " + i + ": " + e)
-        // Append remaining chars as uncolored
-        for (var k = i; k < json.length; k++) {
-            result.push({ ch: json.charAt(k), isValue: false })
-        }
+        // Remaining chars stay uncolored (flags already 0)
     }
 }
 
 /**
- * Build display character array from MQTT message
+ * Build display chars from MQTT message
  * @param {string} topic - MQTT topic (not displayed)
- * @param {string} payload - Message payload
- * @returns {Array} Array of {ch, isValue} objects
+ * @param {string|MqttPayload} payload - Message payload (string or C++ handle)
+ * @param {Object} display - Optional {text, flags} from the C++ tokenizer
+ * @returns {Object} Compact display chars ({text, flags, length})
  */
-function buildDisplayChars(topic, payload) {
+function buildDisplayChars(topic, payload, display) {
+    // Fast path: already tokenised by MQTTClient (flags is an ArrayBuffer)
+    if (display && display.text !== undefined && display.flags !== undefined) {
+        var dt = display.text
+        return { text: dt, flags: new Uint8Array(display.flags), length: dt.length }
+    }
+    
     var p = (payload != null && payload !== undefined) ? payload.toString() : ""
-    var result = []
     
     // Skip empty or whitespace-only payloads
     if (p.trim().length === 0) {
         console.log("[MatrixRainLogic] Skipping empty payload")
-        return []
+        return emptyChars()
     }
     
+    // Append separator (flag stays 0)
+    var text = p + "/"
+    var flags = new Uint8Array(text.length)
+    
     try {
         var parsed = null
         try { parsed = JSON.parse(p) } catch(e) {}
         
         if (parsed !== null && typeof parsed === "object") {
             // Valid JSON: colorize
-            colorJsonChars(p, result)
+            colorJsonChars(p, flags)
         } else {
             // Plain string: all as value
-            for (var j = 0; j < p.length; j++) {
-                result.push({ ch: p.charAt(j), isValue: true })
-            }
+            for (var j = 0; j < p.length; j++) flags[j] = 1
         }
-        
-        // Append separator
-        result.push({ ch: '/', isValue: false })
     } catch(e) {
         console.log("[MatrixRainLogic] buildDisplayChars error: " + e)
         // Fallback: flat uncolored
-        result = []
-        var flat = p + "/"
-        for (var k = 0; k < flat.length; k++) {
-            result.push({ ch: flat.charAt(k), isValue: false })
-        }
-    }
-    
-    return result
-}
-
-/**
- * Assign message to a random free column
- * @param {Array} chars - Character array from buildDisplayChars
- * @param {Array} columnAssignments - Column assignment array (mutated)
- * @param {number} passesLeft - Number of passes before freeing (default 3)
- */
-function assignMessageToColumn(chars, columnAssignments, passesLeft) {
-    if (!columnAssignments || columnAssignments.length === 0) return
-    if (passesLeft === undefined) passesLeft = 3
-    
-    var nCols = columnAssignments.length
-    var freeCols = []
-    
-    // Find free columns
-    for (var k = 0; k < nCols; k++) {
-        if (columnAssignments[k] === null) {
-            freeCols.push(k)
-        }
-    }
-    
-    var targetCol
-    if (freeCols.length > 0) {
-        // Prefer free column
-        targetCol = freeCols[Math.floor(Math.random() * freeCols.length)]
-    } else {
-        // All busy: pick random
-        targetCol = Math.floor(Math.random() * nCols)
+        flags = new Uint8Array(text.length)
     }
     
-    columnAssignments[targetCol] = { 
-        chars: chars, 
-        passesLeft: passesLeft 
-    }
+    return { text: text, flags: flags, length: text.length }
 }
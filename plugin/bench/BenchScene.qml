@@ -0,0 +1,77 @@
+// BenchScene.qml
+//
+// Scene driven by mqttrain-bench: the wallpaper's MatrixCanvas, the five
+// renderers and an MQTTClient fed by replayed traffic, wired the way
+// main.qml wires them minus Plasma (configuration, task manager, overlay).
+// Loaded with a base URL inside package/contents/ui so the relative
+// imports below resolve to the real components and renderers.
+
+import QtQuick 2.15
+import ObsidianReq.MQTTRain 1.0
+import "components"
+import "renderers"
+
+Item {
+    id: scene
+
+    // 0 = Classic (MQTT off), 1–4 = mqttRenderMode 0–3 + 1
+    property int  mode: 0
+    property int  fontSize: 16
+    property int  speed: 50
+    property int  seed: 1
+    // Native per-tile passes; 0 = one per core
+    property int  renderThreads: 0
+    property var  palette: ["#00ff00", "#ff00ff", "#00ffff", "#ff0000", "#ffff00", "#0000ff"]
+
+    readonly property alias canvas: matrixCanvas
+    readonly property alias client: mqttClient
+    // Messages handed to the renderer
+    property int  delivered: 0
+
+    MQTTClient {
+        id: mqttClient
+        batchInterval: Math.round(1000 / Math.max(1, scene.speed))
+
+        onMessagesReceived: function(messages) {
+            var renderer = scene.mode > 0 ? matrixCanvas.activeRenderer : null
+            for (var i = 0; i < messages.length; i++) {
+                var m = messages[i]
+                if (renderer) renderer.assignMessage(m.topic, m.payload, m.display)
+            }
+            scene.delivered += messages.length
+            if (renderer) matrixCanvas.requestPaint()
+        }
+    }
+
+    ClassicRenderer          { id: classicRenderer;          fontSize: scene.fontSize; palettes: [scene.palette]; colorMode: 1 }
+    MixedModeRenderer        { id: mixedRenderer;            fontSize: scene.fontSize; palettes: [scene.palette]; colorMode: 1 }
+    MqttOnlyRenderer         { id: mqttOnlyRenderer;         fontSize: scene.fontSize; palettes: [scene.palette]; colorMode: 1; messagePoolSize: 20 }
+    MqttDrivenRenderer       { id: mqttDrivenRenderer;       fontSize: scene.fontSize; palettes: [scene.palette]; colorMode: 1 }
+    HorizontalInjectRenderer { id: horizontalInjectRenderer; fontSize: scene.fontSize; palettes: [scene.palette]; colorMode: 1 }
+
+    MatrixCanvas {
+        id: matrixCanvas
+        anchors.fill: parent
+
+        fontSize:     scene.fontSize
+        speed:        scene.speed
+        fadeStrength: 0.05
+        mqttEnable:   scene.mode > 0
+        gpuFade:      true
+        // Measure the full-quality pipeline, not what the governor trades away
+        adaptiveQuality: false
+        renderThreads: scene.renderThreads
+        colors:       scene.palette
+        seed:         scene.seed
+
+        activeRenderer: {
+            switch (scene.mode) {
+                case 1:  return mixedRenderer
+                case 2:  return mqttOnlyRenderer
+                case 3:  return mqttDrivenRenderer
+                case 4:  return horizontalInjectRenderer
+                default: return classicRenderer
+            }
+        }
+    }
+}
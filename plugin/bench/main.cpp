@@ -0,0 +1,431 @@
+// mqttrain-bench: runs the wallpaper's rain surface offscreen for every
+// requested renderer mode and resolution, optionally under replayed MQTT
+// traffic, and prints one JSON report (frame times, message throughput,
+// allocations, peak RSS) suitable for regression gating.
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QRegularExpression>
+#include <QTimer>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include "mqttcapture.h"
+#include "mqttclient.h"
+#include "mqttreplay.h"
+#include "rainitem.h"
+#include "registertypes.h"
+
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#endif
+
+// ── Allocation counting ──────────────────────────────────────────────
+// glibc lets an executable interpose malloc and forward to the __libc_*
+// entry points; operator new and Qt's containers all end up here.
+#if defined(__GLIBC__)
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t n, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+}
+
+namespace {
+std::atomic<quint64> g_allocations { 0 };
+}
+
+extern "C" void *malloc(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+static qint64 allocationCount() { return qint64(g_allocations.load(std::memory_order_relaxed)); }
+#else
+static qint64 allocationCount() { return -1; }
+#endif
+
+namespace {
+
+struct Resolution
+{
+    QString name;
+    QSize   size;
+};
+
+struct ModeSpec
+{
+    const char *name;
+    int         sceneMode;   // BenchScene.mode
+};
+
+const ModeSpec kModes[] = {
+    { "classic",           0 },
+    { "mixed",             1 },
+    { "mqtt-only",         2 },
+    { "mqtt-driven",       3 },
+    { "horizontal-inject", 4 },
+};
+
+// Single screens plus the widths of common multi-monitor spans
+const Resolution kResolutions[] = {
+    { QStringLiteral("1080p"),        { 1920, 1080 } },
+    { QStringLiteral("1440p"),        { 2560, 1440 } },
+    { QStringLiteral("4k"),           { 3840, 2160 } },
+    { QStringLiteral("dual-1080p"),   { 3840, 1080 } },
+    { QStringLiteral("triple-1080p"), { 5760, 1080 } },
+    { QStringLiteral("dual-4k"),      { 7680, 2160 } },
+};
+
+qint64 peakRssKb()
+{
+#if defined(Q_OS_UNIX)
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) == 0) return qint64(usage.ru_maxrss);   // KiB on Linux
+#endif
+    return -1;
+}
+
+bool parseResolution(const QString &spec, Resolution *out)
+{
+    for (const Resolution &r : kResolutions) {
+        if (r.name.compare(spec, Qt::CaseInsensitive) == 0) { *out = r; return true; }
+    }
+    static const QRegularExpression wxh(QStringLiteral("^(\\d+)x(\\d+)$"));
+    const QRegularExpressionMatch m = wxh.match(spec);
+    if (!m.hasMatch()) return false;
+    *out = { spec, QSize(m.captured(1).toInt(), m.captured(2).toInt()) };
+    return out->size.width() > 0 && out->size.height() > 0;
+}
+
+QJsonObject distribution(QList<qint64> nsecs)
+{
+    if (nsecs.isEmpty()) return {};
+    std::sort(nsecs.begin(), nsecs.end());
+    auto at = [&](int pct) { return nsecs[qsizetype((nsecs.size() - 1) * pct / 100)] / 1e6; };
+    return QJsonObject {
+        { QStringLiteral("p50"), at(50) },
+        { QStringLiteral("p95"), at(95) },
+        { QStringLiteral("p99"), at(99) },
+        { QStringLiteral("max"), nsecs.last() / 1e6 },
+    };
+}
+
+struct Options
+{
+    QString   packageDir;
+    int       durationMs = 5000;
+    int       warmupMs = 1000;
+    int       fps = 50;
+    int       fontSize = 16;
+    int       seed = 1;
+    int       renderThreads = 0;
+    qreal     replaySpeed = 1;
+    MqttReplay *replay = nullptr;
+};
+
+// One mode at one resolution: a fresh window and scene, a warm-up, then
+// the measured run
+QJsonObject runScenario(QQmlEngine &engine, const QByteArray &sceneQml, const Options &opt,
+                        const ModeSpec &mode, const Resolution &res, QString *error)
+{
+    // Declared first so the scene is torn down while its window still exists
+    QQuickWindow window;
+    window.resize(res.size);
+
+    const QUrl base = QUrl::fromLocalFile(QDir(opt.packageDir).filePath(QStringLiteral("BenchScene.qml")));
+    QQmlComponent component(&engine);
+    component.setData(sceneQml, base);
+    std::unique_ptr<QObject> root(component.createWithInitialProperties({
+        { QStringLiteral("mode"),     mode.sceneMode },
+        { QStringLiteral("speed"),    opt.fps },
+        { QStringLiteral("fontSize"), opt.fontSize },
+        { QStringLiteral("seed"),     opt.seed },
+        { QStringLiteral("renderThreads"), opt.renderThreads },
+    }));
+    auto *scene = qobject_cast<QQuickItem *>(root.get());
+    if (!scene) {
+        *error = component.errorString();
+        return {};
+    }
+
+    scene->setParentItem(window.contentItem());
+    scene->setSize(res.size);
+    window.show();
+
+    auto *rain = qvariant_cast<QObject *>(scene->property("canvas"))->property("rainItem").value<MatrixRainItem *>();
+    auto *client = scene->property("client").value<MQTTClient *>();
+    if (!rain || !client) {
+        *error = QStringLiteral("scene is missing canvas.rainItem or client");
+        return {};
+    }
+
+    if (opt.replay) {
+        opt.replay->setClient(client);
+        opt.replay->start();
+    }
+
+    auto wait = [](int ms) {
+        QEventLoop loop;
+        QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+        loop.exec();
+    };
+    wait(opt.warmupMs);
+
+    // Measured run
+    QList<qint64> tickIntervals, swapIntervals;
+    QElapsedTimer clock;
+    qint64 lastTick = -1, lastSwap = -1;
+    const auto tickConn = QObject::connect(rain, &MatrixRainItem::frameAdvanced, [&]() {
+        const qint64 now = clock.nsecsElapsed();
+        if (lastTick >= 0) tickIntervals.append(now - lastTick);
+        lastTick = now;
+    });
+    // frameSwapped comes from the render thread; queued, so intervals are
+    // as seen by the GUI thread (close enough, and no locking)
+    const auto swapConn = QObject::connect(&window, &QQuickWindow::frameSwapped, &window, [&]() {
+        const qint64 now = clock.nsecsElapsed();
+        if (lastSwap >= 0) swapIntervals.append(now - lastSwap);
+        lastSwap = now;
+    }, Qt::QueuedConnection);
+
+    const QVariantMap ingestBefore = client->ingestStats();
+    const int deliveredBefore = scene->property("delivered").toInt();
+    const quint64 injectedBefore = opt.replay ? quint64(opt.replay->injectedMessages()) : 0;
+    const quint64 bytesBefore = opt.replay ? opt.replay->injectedBytes() : 0;
+    const qint64 allocsBefore = allocationCount();
+
+    rain->setProfiling(true);
+    clock.start();
+    wait(opt.durationMs);
+    const qreal seconds = clock.elapsed() / 1000.0;
+
+    const qint64 allocsAfter = allocationCount();
+    const QVariantList steps = rain->frameTimings().percentiles();
+    rain->setProfiling(false);
+    QObject::disconnect(tickConn);
+    QObject::disconnect(swapConn);
+    if (opt.replay) opt.replay->stop();
+
+    const QVariantMap ingest = client->ingestStats();
+    auto delta = [&](const char *key) {
+        const QString k = QString::fromLatin1(key);
+        return ingest.value(k).toLongLong() - ingestBefore.value(k).toLongLong();
+    };
+    const qint64 ticks = tickIntervals.size() + (lastTick >= 0 ? 1 : 0);
+    const qint64 tokenized = delta("tokenized");
+
+    QJsonObject stepsJson;
+    for (const QVariant &v : steps) {
+        const QVariantMap s = v.toMap();
+        stepsJson.insert(s.value(QStringLiteral("step")).toString(), QJsonObject {
+            { QStringLiteral("p50"), s.value(QStringLiteral("p50")).toDouble() },
+            { QStringLiteral("p95"), s.value(QStringLiteral("p95")).toDouble() },
+            { QStringLiteral("p99"), s.value(QStringLiteral("p99")).toDouble() },
+        });
+    }
+
+    QJsonObject messages {
+        { QStringLiteral("injectedPerSecond"),  opt.replay ? (quint64(opt.replay->injectedMessages()) - injectedBefore) / seconds : 0 },
+        { QStringLiteral("bytesPerSecond"),     opt.replay ? (opt.replay->injectedBytes() - bytesBefore) / seconds : 0 },
+        { QStringLiteral("receivedPerSecond"),  delta("received") / seconds },
+        { QStringLiteral("filteredPerSecond"),  delta("filtered") / seconds },
+        { QStringLiteral("deliveredPerSecond"), (scene->property("delivered").toInt() - deliveredBefore) / seconds },
+        { QStringLiteral("droppedPerSecond"),   (delta("dropped") + delta("coalesced")) / seconds },
+        { QStringLiteral("tokenizeMicros"),     tokenized > 0 ? delta("tokenizeNs") / 1000.0 / tokenized : 0 },
+    };
+
+    return QJsonObject {
+        { QStringLiteral("mode"),       QString::fromLatin1(mode.name) },
+        { QStringLiteral("resolution"), res.name },
+        { QStringLiteral("width"),      res.size.width() },
+        { QStringLiteral("height"),     res.size.height() },
+        { QStringLiteral("columns"),    rain->columns() },
+        { QStringLiteral("seconds"),    seconds },
+        { QStringLiteral("ticks"),      ticks },
+        { QStringLiteral("ticksPerSecond"), ticks / seconds },
+        { QStringLiteral("tickIntervalMs"), distribution(tickIntervals) },
+        { QStringLiteral("frameIntervalMs"), distribution(swapIntervals) },
+        // Last FrameTimings::kWindow samples of each step
+        { QStringLiteral("stepMs"),     stepsJson },
+        { QStringLiteral("messages"),   messages },
+        { QStringLiteral("allocationsPerTick"),
+          allocsBefore < 0 || ticks == 0 ? QJsonValue() : QJsonValue(double(allocsAfter - allocsBefore) / ticks) },
+        { QStringLiteral("peakRssKb"),  peakRssKb() },
+        // MemoryLedger high-water mark (queued/held/latest messages, topics, rings)
+        { QStringLiteral("ledgerPeakBytes"), ingest.value(QStringLiteral("memoryPeak")).toDouble() },
+    };
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Offscreen unless the caller picked a platform (xcb/wayland to watch it)
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QGuiApplication app(argc, argv);
+    app.setApplicationName(QStringLiteral("mqttrain-bench"));
+
+    QStringList modeNames, resolutionNames;
+    for (const ModeSpec &m : kModes) modeNames << QString::fromLatin1(m.name);
+    for (const Resolution &r : kResolutions) resolutionNames << r.name;
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Offscreen benchmark for the MQTT Rain wallpaper"));
+    parser.addHelpOption();
+    const QCommandLineOption replayOpt(QStringLiteral("replay"),
+        QStringLiteral("Recorded traffic to replay: an MQTTClient capture file, or mosquitto_sub -v -F '%U %t %p' text."), QStringLiteral("file"));
+    const QCommandLineOption speedOpt(QStringLiteral("speed"),
+        QStringLiteral("Replay speed: 1 = recorded timing, 0 = as fast as possible."), QStringLiteral("factor"), QStringLiteral("1"));
+    const QCommandLineOption modesOpt(QStringLiteral("modes"),
+        QStringLiteral("Comma-separated renderer modes (%1).").arg(modeNames.join(u',')), QStringLiteral("list"), modeNames.join(u','));
+    const QCommandLineOption resOpt(QStringLiteral("resolutions"),
+        QStringLiteral("Comma-separated resolutions (%1 or WxH).").arg(resolutionNames.join(u',')),
+        QStringLiteral("list"), QStringLiteral("1080p,4k,triple-1080p"));
+    const QCommandLineOption durationOpt(QStringLiteral("duration"),
+        QStringLiteral("Measured seconds per scenario."), QStringLiteral("s"), QStringLiteral("5"));
+    const QCommandLineOption warmupOpt(QStringLiteral("warmup"),
+        QStringLiteral("Unmeasured seconds before each scenario."), QStringLiteral("s"), QStringLiteral("1"));
+    const QCommandLineOption fpsOpt(QStringLiteral("fps"),
+        QStringLiteral("Animation speed (ticks per second)."), QStringLiteral("n"), QStringLiteral("50"));
+    const QCommandLineOption seedOpt(QStringLiteral("seed"),
+        QStringLiteral("Random seed (0 = non-deterministic)."), QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption threadsOpt(QStringLiteral("threads"),
+        QStringLiteral("Threads for the per-tile fade and upload passes (0 = one per core, 1 = serial)."),
+        QStringLiteral("n"), QStringLiteral("0"));
+    const QCommandLineOption packageOpt(QStringLiteral("package"),
+        QStringLiteral("Wallpaper QML directory (package/contents/ui)."), QStringLiteral("dir"),
+        QStringLiteral(MQTTRAIN_PACKAGE_UI_DIR));
+    const QCommandLineOption outputOpt({ QStringLiteral("o"), QStringLiteral("output") },
+        QStringLiteral("Write the JSON report here instead of stdout."), QStringLiteral("file"));
+    parser.addOptions({ replayOpt, speedOpt, modesOpt, resOpt, durationOpt, warmupOpt, fpsOpt, seedOpt,
+                        threadsOpt, packageOpt, outputOpt });
+    parser.process(app);
+
+    Options opt;
+    opt.packageDir  = parser.value(packageOpt);
+    opt.durationMs  = qMax(1, int(parser.value(durationOpt).toDouble() * 1000));
+    opt.warmupMs    = qMax(0, int(parser.value(warmupOpt).toDouble() * 1000));
+    opt.fps         = qBound(1, parser.value(fpsOpt).toInt(), 1000);
+    opt.seed        = parser.value(seedOpt).toInt();
+    opt.renderThreads = qMax(0, parser.value(threadsOpt).toInt());
+    opt.replaySpeed = parser.value(speedOpt).toDouble();
+
+    QList<const ModeSpec *> modes;
+    for (const QString &name : parser.value(modesOpt).split(u',', Qt::SkipEmptyParts)) {
+        const auto it = std::find_if(std::begin(kModes), std::end(kModes),
+                                     [&](const ModeSpec &m) { return name.trimmed() == QLatin1String(m.name); });
+        if (it == std::end(kModes)) {
+            fprintf(stderr, "unknown mode: %s\n", qPrintable(name));
+            return 2;
+        }
+        modes.append(it);
+    }
+
+    QList<Resolution> resolutions;
+    for (const QString &spec : parser.value(resOpt).split(u',', Qt::SkipEmptyParts)) {
+        Resolution r;
+        if (!parseResolution(spec.trimmed(), &r)) {
+            fprintf(stderr, "unknown resolution: %s\n", qPrintable(spec));
+            return 2;
+        }
+        resolutions.append(r);
+    }
+
+    // Read through once up front: a malformed file fails here, not mid-run
+    MqttReplay replay;
+    qint64 replayMessages = 0;
+    if (parser.isSet(replayOpt)) {
+        const QString path = MqttCapture::localPath(parser.value(replayOpt));
+        MqttCaptureReader reader;
+        MqttCaptureRecord record;
+        QString error;
+        if (reader.open(path, &error)) {
+            while (reader.next(&record)) ++replayMessages;
+            error = reader.errorString();
+            if (error.isEmpty() && replayMessages == 0) error = QStringLiteral("no messages");
+        }
+        if (!error.isEmpty()) {
+            fprintf(stderr, "cannot load %s: %s\n", qPrintable(path), qPrintable(error));
+            return 2;
+        }
+        replay.setSource(path);
+        replay.setSpeed(opt.replaySpeed);
+        replay.setLoop(true);
+        opt.replay = &replay;
+    }
+
+    QFile sceneFile(QStringLiteral(":/bench/BenchScene.qml"));
+    if (!sceneFile.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "BenchScene.qml resource missing\n");
+        return 1;
+    }
+    const QByteArray sceneQml = sceneFile.readAll();
+
+    registerMqttRainTypes("ObsidianReq.MQTTRain");
+    QQmlEngine engine;
+
+    QJsonArray scenarios;
+    for (const Resolution &res : std::as_const(resolutions)) {
+        for (const ModeSpec *mode : std::as_const(modes)) {
+            fprintf(stderr, "▶ %s @ %s\n", mode->name, qPrintable(res.name));
+            QString error;
+            const QJsonObject result = runScenario(engine, sceneQml, opt, *mode, res, &error);
+            if (result.isEmpty()) {
+                fprintf(stderr, "scenario failed: %s\n", qPrintable(error));
+                return 1;
+            }
+            scenarios.append(result);
+        }
+    }
+
+    const QJsonObject report {
+        { QStringLiteral("qt"),          QString::fromLatin1(qVersion()) },
+        { QStringLiteral("platform"),    QGuiApplication::platformName() },
+        { QStringLiteral("replay"),      opt.replay ? QJsonValue(parser.value(replayOpt)) : QJsonValue() },
+        { QStringLiteral("replayMessages"), replayMessages },
+        { QStringLiteral("replaySpeed"), opt.replaySpeed },
+        { QStringLiteral("fps"),         opt.fps },
+        { QStringLiteral("seed"),        opt.seed },
+        { QStringLiteral("renderThreads"), opt.renderThreads },
+        { QStringLiteral("scenarios"),   scenarios },
+        { QStringLiteral("peakRssKb"),   peakRssKb() },
+    };
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOpt)) {
+        QFile out(parser.value(outputOpt));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(json) != json.size()) {
+            fprintf(stderr, "cannot write %s\n", qPrintable(out.fileName()));
+            return 1;
+        }
+    } else {
+        fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include "cellgrid.h"
+#include "rainpainter.h"
+#include <QDebug>
+#include <QVarLengthArray>
+#include <limits>
+
+namespace {
+// Expired cells no drop has reached by then are reclaimed anyway; the
+// natural fade has long made them invisible.
+constexpr qint64 kExpiredGraceMs = 10000;
+}
+
+CellGrid::CellGrid(QObject *parent)
+    : QObject(parent)
+    , m_columns(0)
+    , m_rows(0)
+    , m_cellSize(16)
+    , m_live(0)
+    , m_timer(new QTimer(this))
+{
+    m_clock.start();
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::CoarseTimer);
+    connect(m_timer, &QTimer::timeout, this, &CellGrid::processDeadlines);
+}
+
+CellGrid::~CellGrid() = default;
+
+void CellGrid::setCellSize(int size)
+{
+    size = qMax(1, size);
+    if (m_cellSize != size) {
+        m_cellSize = size;
+        emit cellSizeChanged();
+    }
+}
+
+void CellGrid::setColumnState(ColumnState *state)
+{
+    if (m_columnState != state) {
+        m_columnState = state;
+        emit columnStateChanged();
+    }
+}
+
+void CellGrid::reset(int columns, int rows)
+{
+    columns = qMax(0, columns);
+    rows    = qMax(0, rows);
+    const size_t cells = size_t(columns) * size_t(rows);
+
+    m_chars.assign(cells, u' ');
+    m_states.assign(cells, Empty);
+    m_generations.assign(cells, 0);
+    m_occupiedPerColumn.assign(size_t(columns), 0);
+    m_liveIndices.clear();
+    m_liveIndices.reserve(cells);
+    m_livePos.assign(cells, -1);
+    m_deadlines = {};
+    m_timer->stop();
+
+    if (m_columns != columns || m_rows != rows) {
+        m_columns = columns;
+        m_rows = rows;
+        emit sizeChanged();
+    }
+    setLiveCount(0);
+}
+
+void CellGrid::inject(int row, int startCol, const QString &text, int lifetimeMs)
+{
+    if (m_columns == 0 || row < 0 || row >= m_rows || text.isEmpty()) return;
+
+    const qint64 expiresAt = m_clock.elapsed() + qMax(0, lifetimeMs);
+    startCol = ((startCol % m_columns) + m_columns) % m_columns;
+
+    // Longer than a row: later characters overwrite earlier ones, as before
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const int col = int((startCol + i) % m_columns);
+        const int index = row * m_columns + col;
+
+        if (m_states[size_t(index)] == Empty)
+            columnOccupancyChanged(col, +1);
+        if (m_livePos[size_t(index)] < 0) {
+            m_livePos[size_t(index)] = int(m_liveIndices.size());
+            m_liveIndices.push_back(index);
+        }
+
+        const QChar ch = text.at(i);
+        m_chars[size_t(index)] = ch.isNull() ? u' ' : ch.unicode();
+        m_states[size_t(index)] = Live;
+        ++m_generations[size_t(index)];
+        schedule(expiresAt, index);
+    }
+
+    setLiveCount(int(m_liveIndices.size()));
+    armTimer();
+}
+
+int CellGrid::state(int column, int row) const
+{
+    if (!valid(column, row)) return Empty;
+    return m_states[size_t(row * m_columns + column)];
+}
+
+void CellGrid::clear(int column, int row)
+{
+    if (!valid(column, row)) return;
+    release(row * m_columns + column);
+    setLiveCount(int(m_liveIndices.size()));
+}
+
+void CellGrid::paint(QObject *ctx, const QVariantList &colors)
+{
+    if (m_liveIndices.empty()) return;
+
+    auto *painter = qobject_cast<RainPainter *>(ctx);
+    if (!painter) {
+        qWarning() << "[MQTTRain] CellGrid.paint() needs the MatrixRainItem ctx";
+        return;
+    }
+
+    // Explicit colours are resolved once per frame, not once per cell;
+    // otherwise the painter's prebuilt palette is used
+    QVarLengthArray<QRgb, 16> rgb;
+    for (const QVariant &c : colors)
+        rgb.append(RainPainter::toRgb(c));
+
+    const qreal fs = m_cellSize;
+    for (int index : m_liveIndices) {
+        const int col = index % m_columns;
+        const int row = index / m_columns;
+        const QRgb color = rgb.isEmpty() ? painter->shadeColor(col, RainPainter::Base)
+                                         : rgb[col % rgb.size()];
+        painter->stampGlyph(QChar(m_chars[size_t(index)]), color, col * fs, row * fs);
+    }
+}
+
+void CellGrid::release(int index)
+{
+    if (m_states[size_t(index)] == Empty) return;
+
+    unlinkLive(index);
+    m_states[size_t(index)] = Empty;
+    ++m_generations[size_t(index)];
+    columnOccupancyChanged(index % m_columns, -1);
+}
+
+void CellGrid::unlinkLive(int index)
+{
+    const int pos = m_livePos[size_t(index)];
+    if (pos < 0) return;
+
+    // Swap-remove keeps the live list dense
+    const int last = m_liveIndices.back();
+    m_liveIndices[size_t(pos)] = last;
+    m_livePos[size_t(last)] = pos;
+    m_liveIndices.pop_back();
+    m_livePos[size_t(index)] = -1;
+}
+
+void CellGrid::schedule(qint64 at, int index)
+{
+    m_deadlines.push({ at, index, m_generations[size_t(index)] });
+}
+
+void CellGrid::armTimer()
+{
+    if (m_deadlines.empty()) {
+        m_timer->stop();
+        return;
+    }
+    const qint64 wait = qMax<qint64>(0, m_deadlines.top().at - m_clock.elapsed());
+    m_timer->start(int(qMin<qint64>(wait, std::numeric_limits<int>::max())));
+}
+
+void CellGrid::processDeadlines()
+{
+    const qint64 now = m_clock.elapsed();
+
+    while (!m_deadlines.empty() && m_deadlines.top().at <= now) {
+        const Deadline d = m_deadlines.top();
+        m_deadlines.pop();
+        if (d.generation != m_generations[size_t(d.index)]) continue;   // rewritten
+
+        if (m_states[size_t(d.index)] == Live) {
+            // Stops being an obstacle; wait for a drop to fade it out
+            unlinkLive(d.index);
+            m_states[size_t(d.index)] = Expired;
+            schedule(d.at + kExpiredGraceMs, d.index);
+        } else if (m_states[size_t(d.index)] == Expired) {
+            release(d.index);
+        }
+    }
+
+    setLiveCount(int(m_liveIndices.size()));
+    armTimer();
+}
+
+void CellGrid::setLiveCount(int count)
+{
+    if (m_live != count) {
+        m_live = count;
+        emit liveCountChanged();
+    }
+}
+
+void CellGrid::columnOccupancyChanged(int column, int delta)
+{
+    int &n = m_occupiedPerColumn[size_t(column)];
+    const bool was = n > 0;
+    n += delta;
+    const bool now = n > 0;
+    if (was == now || !m_columnState) return;
+
+    if (now) m_columnState->assign(column, QJSValue(), -1);
+    else     m_columnState->release(column);
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantList>
+#include <queue>
+#include <vector>
+#include "columnstate.h"
+
+// Obstacle cells of the Horizontal Inject renderer.
+//
+// Dense column-by-row arrays replace the former `mqttCells` object keyed
+// by "col:row" strings: a lookup is one index computation, no string is
+// built and no JS object is allocated per cell. Each cell goes through
+//
+//   Empty → Live (until its lifetime ends) → Expired → Empty
+//
+// Live cells are obstacles redrawn every frame by paint(); an Expired
+// cell is waiting for a drop to pass over it (the renderer applies the
+// accelerated fade, then clear()s it). Deadlines sit in a min-heap and a
+// single-shot timer fires at the earliest one, so expiry costs nothing
+// per frame and cells no drop ever reaches are still reclaimed after a
+// grace period instead of accumulating.
+//
+// When columnState is set, a column is kept active there while it holds
+// at least one non-empty cell.
+class CellGrid : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int columns   READ columns   NOTIFY sizeChanged)
+    Q_PROPERTY(int rows      READ rows      NOTIFY sizeChanged)
+    Q_PROPERTY(int cellSize  READ cellSize  WRITE setCellSize NOTIFY cellSizeChanged)
+    Q_PROPERTY(int liveCount READ liveCount NOTIFY liveCountChanged)
+    Q_PROPERTY(ColumnState *columnState READ columnState WRITE setColumnState NOTIFY columnStateChanged)
+
+public:
+    enum CellState { Empty = 0, Live = 1, Expired = 2 };
+    Q_ENUM(CellState)
+
+    explicit CellGrid(QObject *parent = nullptr);
+    ~CellGrid() override;
+
+    int columns()   const { return m_columns; }
+    int rows()      const { return m_rows; }
+    int cellSize()  const { return m_cellSize; }
+    int liveCount() const { return m_live; }
+    ColumnState *columnState() const { return m_columnState; }
+
+    void setCellSize(int size);
+    void setColumnState(ColumnState *state);
+
+    // Clears every cell and resizes the grid.
+    Q_INVOKABLE void reset(int columns, int rows);
+
+    // Writes text into `row` starting at `startCol`, wrapping around the
+    // columns; every cell lives for lifetimeMs.
+    Q_INVOKABLE void inject(int row, int startCol, const QString &text, int lifetimeMs);
+
+    Q_INVOKABLE int  state(int column, int row) const;
+    Q_INVOKABLE void clear(int column, int row);
+
+    // Stamps every live cell into a RainPainter `ctx`; cells of column c
+    // use colors[c % colors.length], or the ctx palette when omitted.
+    Q_INVOKABLE void paint(QObject *ctx, const QVariantList &colors = {});
+
+signals:
+    void sizeChanged();
+    void cellSizeChanged();
+    void liveCountChanged();
+    void columnStateChanged();
+
+private slots:
+    void processDeadlines();
+
+private:
+    struct Deadline
+    {
+        qint64  at;           // ms on m_clock
+        int     index;
+        quint32 generation;   // stale when the cell was rewritten since
+        bool operator>(const Deadline &o) const { return at > o.at; }
+    };
+
+    bool valid(int column, int row) const
+    {
+        return column >= 0 && column < m_columns && row >= 0 && row < m_rows;
+    }
+    void release(int index);
+    void unlinkLive(int index);
+    void schedule(qint64 at, int index);
+    void armTimer();
+    void setLiveCount(int count);
+    void columnOccupancyChanged(int column, int delta);
+
+    int m_columns;
+    int m_rows;
+    int m_cellSize;
+    int m_live;
+
+    // Row-major, index = row * m_columns + column
+    std::vector<char16_t> m_chars;
+    std::vector<quint8>   m_states;
+    std::vector<quint32>  m_generations;
+    std::vector<int>      m_occupiedPerColumn;
+    std::vector<int>      m_liveIndices;   // unordered; m_livePos maps back
+    std::vector<int>      m_livePos;       // index → position in m_liveIndices, -1 if not live
+
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> m_deadlines;
+    QElapsedTimer m_clock;
+    QTimer       *m_timer;
+    QPointer<ColumnState> m_columnState;
+};
@@ -0,0 +1,87 @@
+#include "columnkernels.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MQTTRAIN_SSE2 1
+#endif
+
+namespace ColumnKernels {
+
+void steps(float *step, const float *rand, int n, float base, float scale)
+{
+    int i = 0;
+#ifdef MQTTRAIN_SSE2
+    const __m128 b = _mm_set1_ps(base);
+    const __m128 s = _mm_set1_ps(base * scale);
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(step + i, _mm_add_ps(b, _mm_mul_ps(_mm_loadu_ps(rand + i), s)));
+#endif
+    for (; i < n; ++i)
+        step[i] = base + rand[i] * (base * scale);
+}
+
+void advance(float *pos, const float *step, int n)
+{
+    int i = 0;
+#ifdef MQTTRAIN_SSE2
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(pos + i, _mm_add_ps(_mm_loadu_ps(pos + i), _mm_loadu_ps(step + i)));
+#endif
+    for (; i < n; ++i)
+        pos[i] += step[i];
+}
+
+int wrap(float *pos, int n, float limit, int *wrapped)
+{
+    int count = 0;
+    int i = 0;
+#ifdef MQTTRAIN_SSE2
+    // Wraps are rare: test four columns at once, touch lanes only on a hit
+    const __m128 lim = _mm_set1_ps(limit);
+    for (; i + 4 <= n; i += 4) {
+        const __m128 p = _mm_loadu_ps(pos + i);
+        const __m128 over = _mm_cmpgt_ps(p, lim);
+        const int mask = _mm_movemask_ps(over);
+        if (mask == 0) continue;
+        _mm_storeu_ps(pos + i, _mm_andnot_ps(over, p));
+        for (int lane = 0; lane < 4; ++lane)
+            if (mask & (1 << lane)) wrapped[count++] = i + lane;
+    }
+#endif
+    for (; i < n; ++i) {
+        if (pos[i] > limit) {
+            pos[i] = 0;
+            wrapped[count++] = i;
+        }
+    }
+    return count;
+}
+
+void charIndex(const float *pos, const qint32 *len, qint32 *idx, int n)
+{
+    int i = 0;
+#ifdef MQTTRAIN_SSE2
+    // No integer divide in SSE2: the quotient comes from a float divide
+    // (exact enough below 2^24), then one correction step each way
+    const __m128i four = _mm_set1_epi32(4);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i column = _mm_setr_epi32(0, 1, 2, 3);
+    for (; i + 4 <= n; i += 4, column = _mm_add_epi32(column, four)) {
+        const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(len + i));
+        const __m128i k = _mm_add_epi32(_mm_cvttps_epi32(_mm_loadu_ps(pos + i)), column);
+        const __m128i valid = _mm_cmpgt_epi32(l, zero);
+        const __m128 lsafe = _mm_cvtepi32_ps(_mm_or_si128(_mm_and_si128(valid, l),
+                                                          _mm_andnot_si128(valid, _mm_set1_epi32(1))));
+        const __m128 kf = _mm_cvtepi32_ps(k);
+        const __m128 q = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(kf, lsafe)));
+        __m128i r = _mm_cvttps_epi32(_mm_sub_ps(kf, _mm_mul_ps(q, lsafe)));
+        const __m128i ls = _mm_cvttps_epi32(lsafe);
+        r = _mm_add_epi32(r, _mm_and_si128(_mm_cmplt_epi32(r, zero), ls));
+        r = _mm_sub_epi32(r, _mm_andnot_si128(_mm_cmplt_epi32(r, ls), ls));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(idx + i), _mm_and_si128(r, valid));
+    }
+#endif
+    for (; i < n; ++i)
+        idx[i] = len[i] > 0 ? (qint32(pos[i]) + i) % len[i] : 0;
+}
+
+} // namespace ColumnKernels
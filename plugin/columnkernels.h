@@ -0,0 +1,32 @@
+#pragma once
+#include <QtGlobal>
+
+// Per-tick column kernels of MatrixRainItem over its struct-of-arrays
+// state: drop positions and steps as contiguous floats, chars lengths and
+// character indices as contiguous 32-bit ints, one element per column.
+//
+// Each kernel is one pass over the arrays with no per-column branches in
+// the common path. On x86-64 they run four columns per SSE2 instruction
+// (SSE2 is baseline there, no runtime dispatch); elsewhere the plain loops
+// are left for the compiler to vectorise. The cost of a tick's native
+// part grows with columns / 4 rather than with columns, for 8K walls.
+//
+// Positions are in rows and never negative; all counts fit in 24 bits,
+// so the float arithmetic below is exact where it needs to be.
+namespace ColumnKernels {
+
+// step[i] = base * (1 + rand[i] * scale): this tick's advance per column
+void steps(float *step, const float *rand, int n, float base, float scale);
+
+// pos[i] += step[i]
+void advance(float *pos, const float *step, int n);
+
+// Positions past limit restart at 0; their columns are written to
+// wrapped (ascending). Returns how many.
+int wrap(float *pos, int n, float limit, int *wrapped);
+
+// idx[i] = (floor(pos[i]) + i) % len[i], 0 where len[i] <= 0: the
+// character a renderer draws from a column's message
+void charIndex(const float *pos, const qint32 *len, qint32 *idx, int n);
+
+} // namespace ColumnKernels
@@ -0,0 +1,189 @@
+#include "columnstate.h"
+
+ColumnState::ColumnState(QObject *parent)
+    : QObject(parent)
+    , m_oldest(-1)
+    , m_newest(-1)
+    , m_columns(0)
+    , m_active(0)
+    , m_evictionPolicy(EvictLeastRecent)
+    , m_rng()
+{
+}
+
+void ColumnState::setEvictionPolicy(EvictionPolicy policy)
+{
+    if (m_evictionPolicy != policy) {
+        m_evictionPolicy = policy;
+        emit evictionPolicyChanged();
+    }
+}
+
+void ColumnState::reset(int columns)
+{
+    columns = qMax(0, columns);
+    if (size_t(columns) > m_chars.size()) {
+        const size_t n = size_t(columns);
+        m_chars.resize(n);
+        m_length.resize(n);
+        m_passes.resize(n);
+        m_busy.resize(n);
+        m_older.resize(n);
+        m_newer.resize(n);
+    }
+
+    // Drop references to old chars so they can be collected
+    for (int c = 0; c < int(m_chars.size()); ++c) clearSlot(c);
+
+    m_free.resize(size_t(columns));
+    m_freePos.resize(size_t(columns));
+    for (int c = 0; c < columns; ++c) {
+        m_free[size_t(c)] = c;
+        m_freePos[size_t(c)] = c;
+    }
+    m_oldest = m_newest = -1;
+
+    if (m_columns != columns) {
+        m_columns = columns;
+        emit columnsChanged();
+    }
+    setActiveCount(0);
+}
+
+bool ColumnState::isActive(int column) const
+{
+    return valid(column) && m_busy[size_t(column)];
+}
+
+QJSValue ColumnState::chars(int column) const
+{
+    if (!isActive(column)) return QJSValue();
+    return m_chars[size_t(column)];
+}
+
+int ColumnState::passesLeft(int column) const
+{
+    return isActive(column) ? m_passes[size_t(column)] : 0;
+}
+
+void ColumnState::assign(int column, const QJSValue &chars, int passes)
+{
+    if (!valid(column)) return;
+
+    const size_t c = size_t(column);
+    const bool wasActive = m_busy[c];
+    if (wasActive) unlinkRecent(column);
+    else           takeFree(column);
+
+    m_chars[c]  = chars;
+    m_length[c] = chars.isObject() ? qMax(0, chars.property(QStringLiteral("length")).toInt()) : 0;
+    m_passes[c] = passes;
+    m_busy[c]   = 1;
+    linkNewest(column);
+
+    if (!wasActive) setActiveCount(m_active + 1);
+    emit columnChanged(column);
+}
+
+int ColumnState::assignRandom(const QJSValue &chars, int passes)
+{
+    if (m_columns == 0) return -1;
+
+    int column;
+    if (!m_free.empty())
+        column = m_free[m_rng.bounded(quint32(m_free.size()))];
+    else if (m_evictionPolicy == EvictLeastRecent)
+        column = m_oldest;
+    else
+        column = int(m_rng.bounded(quint32(m_columns)));
+
+    assign(column, chars, passes);
+    return column;
+}
+
+int ColumnState::randomIndex(int count)
+{
+    if (count <= 0) return 0;
+    return int(m_rng.bounded(quint32(count)));
+}
+
+bool ColumnState::wrap(int column)
+{
+    if (!isActive(column)) return false;
+
+    qint32 &passes = m_passes[size_t(column)];
+    if (passes < 0) return false;
+
+    if (--passes > 0) return false;
+    release(column);
+    return true;
+}
+
+void ColumnState::release(int column)
+{
+    if (!isActive(column)) return;
+
+    unlinkRecent(column);
+    clearSlot(column);
+    putFree(column);
+    setActiveCount(m_active - 1);
+    emit columnChanged(column);
+}
+
+void ColumnState::setActiveCount(int count)
+{
+    if (m_active != count) {
+        m_active = count;
+        emit activeCountChanged();
+    }
+}
+
+void ColumnState::takeFree(int column)
+{
+    // Swap-remove keeps the free list dense
+    const int pos = m_freePos[size_t(column)];
+    const int last = m_free.back();
+    m_free[size_t(pos)] = last;
+    m_freePos[size_t(last)] = pos;
+    m_free.pop_back();
+    m_freePos[size_t(column)] = -1;
+}
+
+void ColumnState::putFree(int column)
+{
+    m_freePos[size_t(column)] = int(m_free.size());
+    m_free.push_back(column);
+}
+
+void ColumnState::unlinkRecent(int column)
+{
+    const size_t c = size_t(column);
+    const qint32 older = m_older[c];
+    const qint32 newer = m_newer[c];
+    if (older >= 0) m_newer[size_t(older)] = newer;
+    else            m_oldest = newer;
+    if (newer >= 0) m_older[size_t(newer)] = older;
+    else            m_newest = older;
+    m_older[c] = m_newer[c] = -1;
+}
+
+void ColumnState::linkNewest(int column)
+{
+    const size_t c = size_t(column);
+    m_older[c] = m_newest;
+    m_newer[c] = -1;
+    if (m_newest >= 0) m_newer[size_t(m_newest)] = column;
+    else               m_oldest = column;
+    m_newest = column;
+}
+
+void ColumnState::clearSlot(int column)
+{
+    const size_t c = size_t(column);
+    m_chars[c]  = QJSValue();
+    m_length[c] = 0;
+    m_passes[c] = 0;
+    m_busy[c]   = 0;
+    m_older[c]  = -1;
+    m_newer[c]  = -1;
+}
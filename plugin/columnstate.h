@@ -0,0 +1,108 @@
+#pragma once
+#include <QJSValue>
+#include <QObject>
+#include <vector>
+#include "xoshiro.h"
+
+// Per-column message slots shared by the MQTT renderers.
+//
+// Replaces the `columnAssignments` JS array that renderers cloned with
+// slice() and reassigned on every message and every wrap just to get a
+// property change. Slots live in a preallocated pool that only grows
+// (reset() to fewer columns keeps the capacity) and are updated in place;
+// changes are reported per column through columnChanged(), and the
+// number of occupied columns is tracked incrementally in activeCount.
+//
+// A slot holds the display chars ({text, flags, length}) as an opaque
+// QJSValue and a pass counter: wrap() consumes one pass and frees the
+// column when it reaches zero. Negative passes never expire; the column
+// stays until release() or reset().
+//
+// Slots are stored as a struct of arrays (chars, chars length, passes,
+// active flag, assignment links), one contiguous array per field, so
+// MatrixRainItem's per-tick kernels read lengths() as one int array.
+//
+// Placement is O(1): free columns sit in a dense free list (swap-remove,
+// with a position index back into it), so assignRandom() picks one with a
+// single random draw instead of scanning. Busy columns are chained in
+// assignment order; when none is free, the least recently assigned one
+// is evicted (or a random one, per evictionPolicy).
+class ColumnState : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int columns     READ columns     NOTIFY columnsChanged)
+    Q_PROPERTY(int activeCount READ activeCount NOTIFY activeCountChanged)
+    Q_PROPERTY(EvictionPolicy evictionPolicy READ evictionPolicy WRITE setEvictionPolicy NOTIFY evictionPolicyChanged)
+
+public:
+    enum EvictionPolicy {
+        EvictLeastRecent,   // overwrite the column assigned longest ago
+        EvictRandom         // overwrite any busy column
+    };
+    Q_ENUM(EvictionPolicy)
+
+    explicit ColumnState(QObject *parent = nullptr);
+
+    int columns()     const { return m_columns; }
+    int activeCount() const { return m_active; }
+    EvictionPolicy evictionPolicy() const { return m_evictionPolicy; }
+    void setEvictionPolicy(EvictionPolicy policy);
+
+    // Frees every slot and resizes the pool to `columns`.
+    Q_INVOKABLE void reset(int columns);
+
+    Q_INVOKABLE bool     isActive(int column) const;
+    // Display chars of an active column, undefined otherwise.
+    Q_INVOKABLE QJSValue chars(int column) const;
+    Q_INVOKABLE int      passesLeft(int column) const;
+
+    Q_INVOKABLE void assign(int column, const QJSValue &chars, int passes);
+    // Assigns to a random free column, or evicts a busy one per
+    // evictionPolicy when all are taken. Returns the column, -1 when
+    // there are no columns.
+    Q_INVOKABLE int  assignRandom(const QJSValue &chars, int passes);
+    // Consumes one pass; returns true when this freed the column.
+    Q_INVOKABLE bool wrap(int column);
+    Q_INVOKABLE void release(int column);
+    // Uniform draw in [0, count) from the same stream as assignRandom();
+    // 0 when count <= 0
+    Q_INVOKABLE int  randomIndex(int count);
+
+    // Reproducible assignRandom() picks; MatrixRainItem seeds the
+    // columnState of its renderer from its own seed
+    void reseed(quint64 seed, quint64 stream) { m_rng.reseed(seed, stream); }
+
+    // Chars length per column, 0 for free columns; columns() entries
+    const qint32 *lengths() const { return m_length.data(); }
+
+signals:
+    void columnChanged(int column);
+    void columnsChanged();
+    void activeCountChanged();
+    void evictionPolicyChanged();
+
+private:
+    bool valid(int column) const { return column >= 0 && column < m_columns; }
+    void setActiveCount(int count);
+    void takeFree(int column);
+    void putFree(int column);
+    void unlinkRecent(int column);
+    void linkNewest(int column);
+    void clearSlot(int column);
+
+    // One entry per column; capacity >= m_columns, never shrunk
+    std::vector<QJSValue> m_chars;
+    std::vector<qint32>   m_length;    // chars.length, 0 when free
+    std::vector<qint32>   m_passes;
+    std::vector<quint8>   m_busy;
+    std::vector<qint32>   m_older;     // assignment-order chain of active slots
+    std::vector<qint32>   m_newer;
+    std::vector<int>      m_free;      // free columns, unordered
+    std::vector<int>      m_freePos;   // column → index in m_free, -1 when active
+    int                   m_oldest;    // head of the assignment chain, -1 if none
+    int                   m_newest;
+    int                   m_columns;
+    int                   m_active;
+    EvictionPolicy        m_evictionPolicy;
+    Xoshiro256            m_rng;
+};
@@ -0,0 +1,387 @@
+#include "discoveryregistry.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+
+constexpr int kCacheVersion = 1;
+
+// Home Assistant abbreviations for the keys we care about, plus the
+// common ones so a normalised config reads like the documented schema.
+const QHash<QString, QString> &configAbbreviations()
+{
+    static const QHash<QString, QString> table = {
+        { QStringLiteral("act_t"),        QStringLiteral("action_topic") },
+        { QStringLiteral("avty"),         QStringLiteral("availability") },
+        { QStringLiteral("avty_mode"),    QStringLiteral("availability_mode") },
+        { QStringLiteral("avty_t"),       QStringLiteral("availability_topic") },
+        { QStringLiteral("avty_tpl"),     QStringLiteral("availability_template") },
+        { QStringLiteral("bri_cmd_t"),    QStringLiteral("brightness_command_topic") },
+        { QStringLiteral("bri_stat_t"),   QStringLiteral("brightness_state_topic") },
+        { QStringLiteral("clr_temp_stat_t"), QStringLiteral("color_temp_state_topic") },
+        { QStringLiteral("cmd_t"),        QStringLiteral("command_topic") },
+        { QStringLiteral("cmd_tpl"),      QStringLiteral("command_template") },
+        { QStringLiteral("curr_temp_t"),  QStringLiteral("current_temperature_topic") },
+        { QStringLiteral("dev"),          QStringLiteral("device") },
+        { QStringLiteral("dev_cla"),      QStringLiteral("device_class") },
+        { QStringLiteral("ent_cat"),      QStringLiteral("entity_category") },
+        { QStringLiteral("exp_aft"),      QStringLiteral("expire_after") },
+        { QStringLiteral("frc_upd"),      QStringLiteral("force_update") },
+        { QStringLiteral("ic"),           QStringLiteral("icon") },
+        { QStringLiteral("json_attr_t"),  QStringLiteral("json_attributes_topic") },
+        { QStringLiteral("json_attr_tpl"), QStringLiteral("json_attributes_template") },
+        { QStringLiteral("mode_stat_t"),  QStringLiteral("mode_state_topic") },
+        { QStringLiteral("obj_id"),       QStringLiteral("object_id") },
+        { QStringLiteral("pct_stat_t"),   QStringLiteral("percentage_state_topic") },
+        { QStringLiteral("pl_avail"),     QStringLiteral("payload_available") },
+        { QStringLiteral("pl_not_avail"), QStringLiteral("payload_not_available") },
+        { QStringLiteral("pl_off"),       QStringLiteral("payload_off") },
+        { QStringLiteral("pl_on"),        QStringLiteral("payload_on") },
+        { QStringLiteral("pos_t"),        QStringLiteral("position_topic") },
+        { QStringLiteral("ret"),          QStringLiteral("retain") },
+        { QStringLiteral("rgb_stat_t"),   QStringLiteral("rgb_state_topic") },
+        { QStringLiteral("stat_cla"),     QStringLiteral("state_class") },
+        { QStringLiteral("stat_t"),       QStringLiteral("state_topic") },
+        { QStringLiteral("stat_tpl"),     QStringLiteral("state_template") },
+        { QStringLiteral("t"),            QStringLiteral("topic") },
+        { QStringLiteral("temp_stat_t"),  QStringLiteral("temperature_state_topic") },
+        { QStringLiteral("uniq_id"),      QStringLiteral("unique_id") },
+        { QStringLiteral("unit_of_meas"), QStringLiteral("unit_of_measurement") },
+        { QStringLiteral("val_tpl"),      QStringLiteral("value_template") },
+    };
+    return table;
+}
+
+const QHash<QString, QString> &deviceAbbreviations()
+{
+    static const QHash<QString, QString> table = {
+        { QStringLiteral("cns"),  QStringLiteral("connections") },
+        { QStringLiteral("hw"),   QStringLiteral("hw_version") },
+        { QStringLiteral("ids"),  QStringLiteral("identifiers") },
+        { QStringLiteral("mdl"),  QStringLiteral("model") },
+        { QStringLiteral("mf"),   QStringLiteral("manufacturer") },
+        { QStringLiteral("sa"),   QStringLiteral("suggested_area") },
+        { QStringLiteral("sw"),   QStringLiteral("sw_version") },
+        { QStringLiteral("via_dev"), QStringLiteral("via_device") },
+    };
+    return table;
+}
+
+QJsonObject renameKeys(const QJsonObject &in, const QHash<QString, QString> &table)
+{
+    QJsonObject out;
+    for (auto it = in.constBegin(); it != in.constEnd(); ++it)
+        out.insert(table.value(it.key(), it.key()), it.value());
+    return out;
+}
+
+// "~/state" → base + "/state", "state/~" → "state/" + base
+QString expandBase(const QString &topic, const QString &base)
+{
+    if (base.isEmpty()) return topic;
+    if (topic.startsWith(u'~')) return base + topic.mid(1);
+    if (topic.endsWith(u'~'))   return topic.left(topic.size() - 1) + base;
+    return topic;
+}
+
+} // namespace
+
+QJsonObject DiscoveryRegistry::Entity::toJson() const
+{
+    return QJsonObject {
+        { QStringLiteral("component"),             component },
+        { QStringLiteral("object_id"),             objectId },
+        { QStringLiteral("name"),                  name },
+        { QStringLiteral("unique_id"),             uniqueId },
+        { QStringLiteral("state_topic"),           stateTopic },
+        { QStringLiteral("command_topic"),         commandTopic },
+        { QStringLiteral("availability_topic"),    availabilityTopic },
+        { QStringLiteral("json_attributes_topic"), jsonAttributesTopic },
+        { QStringLiteral("device_class"),          deviceClass },
+        { QStringLiteral("unit_of_measurement"),   unit },
+        { QStringLiteral("hash"),                  QString::fromLatin1(payloadHash.toHex()) },
+    };
+}
+
+DiscoveryRegistry::Entity DiscoveryRegistry::Entity::fromJson(const QJsonObject &o)
+{
+    Entity e;
+    e.component           = o.value(QStringLiteral("component")).toString();
+    e.objectId            = o.value(QStringLiteral("object_id")).toString();
+    e.name                = o.value(QStringLiteral("name")).toString();
+    e.uniqueId            = o.value(QStringLiteral("unique_id")).toString();
+    e.stateTopic          = o.value(QStringLiteral("state_topic")).toString();
+    e.commandTopic        = o.value(QStringLiteral("command_topic")).toString();
+    e.availabilityTopic   = o.value(QStringLiteral("availability_topic")).toString();
+    e.jsonAttributesTopic = o.value(QStringLiteral("json_attributes_topic")).toString();
+    e.deviceClass         = o.value(QStringLiteral("device_class")).toString();
+    e.unit                = o.value(QStringLiteral("unit_of_measurement")).toString();
+    e.payloadHash         = QByteArray::fromHex(o.value(QStringLiteral("hash")).toString().toLatin1());
+    return e;
+}
+
+DiscoveryRegistry::DiscoveryRegistry(QObject *parent)
+    : QObject(parent)
+    , m_prefix(QStringLiteral("homeassistant"))
+    , m_saveTimer(new QTimer(this))
+    , m_dirty(false)
+{
+    // A discovery replay touches hundreds of entities; write once it settles
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(5000);
+    connect(m_saveTimer, &QTimer::timeout, this, &DiscoveryRegistry::flushCache);
+}
+
+DiscoveryRegistry::~DiscoveryRegistry()
+{
+    flushCache();
+}
+
+void DiscoveryRegistry::setPrefix(const QString &prefix)
+{
+    QString v = prefix.trimmed();
+    while (v.endsWith(u'/')) v.chop(1);
+    if (v.isEmpty()) v = QStringLiteral("homeassistant");
+    if (m_prefix == v) return;
+
+    // Cached entities belong to the old prefix
+    flushCache();
+    m_prefix = v;
+    if (!m_brokerKey.isEmpty()) {
+        const QString key = m_brokerKey;
+        m_brokerKey.clear();
+        loadCache(key);
+    }
+}
+
+QStringList DiscoveryRegistry::discoveryFilters() const
+{
+    return { m_prefix + QStringLiteral("/+/+/config"),
+             m_prefix + QStringLiteral("/+/+/+/config") };
+}
+
+bool DiscoveryRegistry::isDiscoveryTopic(QStringView topic) const
+{
+    if (!topic.endsWith(u"/config")) return false;
+    if (!topic.startsWith(m_prefix) || topic.size() <= m_prefix.size()
+        || topic[m_prefix.size()] != u'/') return false;
+
+    // <prefix>/<component>/[<node_id>/]<object_id>/config
+    const qsizetype levels = topic.mid(m_prefix.size()).count(u'/');
+    return levels == 3 || levels == 4;
+}
+
+QJsonObject DiscoveryRegistry::normalize(const QJsonObject &config)
+{
+    QJsonObject out = renameKeys(config, configAbbreviations());
+
+    const QString base = out.value(QStringLiteral("~")).toString();
+    for (auto it = out.begin(); it != out.end(); ++it) {
+        if (it.value().isString() && (it.key().endsWith(QLatin1String("_topic")) || it.key() == QLatin1String("topic")))
+            it.value() = expandBase(it.value().toString(), base);
+    }
+
+    const QJsonValue device = out.value(QStringLiteral("device"));
+    if (device.isObject())
+        out.insert(QStringLiteral("device"), renameKeys(device.toObject(), deviceAbbreviations()));
+
+    // availability: [{t|topic, ...}, ...]
+    const QJsonValue availability = out.value(QStringLiteral("availability"));
+    if (availability.isArray()) {
+        QJsonArray list;
+        for (const QJsonValue &v : availability.toArray()) {
+            if (!v.isObject()) { list.append(v); continue; }
+            QJsonObject a = renameKeys(v.toObject(), configAbbreviations());
+            a.insert(QStringLiteral("topic"), expandBase(a.value(QStringLiteral("topic")).toString(), base));
+            list.append(a);
+        }
+        out.insert(QStringLiteral("availability"), list);
+    }
+    return out;
+}
+
+bool DiscoveryRegistry::handleMessage(const QString &topic, const QByteArray &payload)
+{
+    if (payload.isEmpty()) {
+        if (removeEntity(topic)) {
+            qDebug() << "🏠 discovery: removed" << topic;
+            scheduleSave();
+        }
+        return true;
+    }
+
+    // Retained replay of a config we already know: nothing to parse
+    const QByteArray hash = QCryptographicHash::hash(payload, QCryptographicHash::Sha1);
+    const auto known = m_entities.constFind(topic);
+    if (known != m_entities.cend() && known->payloadHash == hash)
+        return true;
+
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(payload, &error);
+    if (!doc.isObject()) {
+        qWarning() << "⚠️ discovery: invalid config on" << topic << error.errorString();
+        return false;
+    }
+
+    const QJsonObject config = normalize(doc.object());
+    // <component>/[<node_id>/]<object_id>/config
+    const QStringList levels = topic.mid(m_prefix.size() + 1).split(u'/');
+
+    Entity e;
+    e.component           = levels.value(0);
+    e.objectId            = levels.value(levels.size() - 2);
+    e.name                = config.value(QStringLiteral("name")).toString();
+    e.uniqueId            = config.value(QStringLiteral("unique_id")).toString();
+    e.stateTopic          = config.value(QStringLiteral("state_topic")).toString();
+    e.commandTopic        = config.value(QStringLiteral("command_topic")).toString();
+    e.availabilityTopic   = config.value(QStringLiteral("availability_topic")).toString();
+    e.jsonAttributesTopic = config.value(QStringLiteral("json_attributes_topic")).toString();
+    e.deviceClass         = config.value(QStringLiteral("device_class")).toString();
+    e.unit                = config.value(QStringLiteral("unit_of_measurement")).toString();
+    e.payloadHash         = hash;
+
+    if (e.name.isEmpty()) {
+        const QJsonObject device = config.value(QStringLiteral("device")).toObject();
+        e.name = device.value(QStringLiteral("name")).toString();
+    }
+
+    addEntity(topic, e);
+    scheduleSave();
+    return true;
+}
+
+void DiscoveryRegistry::addEntity(const QString &discoveryTopic, const Entity &entity)
+{
+    const QString previous = m_entities.value(discoveryTopic).stateTopic;
+    const bool existed = m_entities.contains(discoveryTopic);
+    m_entities.insert(discoveryTopic, entity);
+
+    bool topicsChanged = false;
+    if (previous != entity.stateTopic) {
+        if (!previous.isEmpty())         topicsChanged |= releaseTopic(previous);
+        if (!entity.stateTopic.isEmpty()) topicsChanged |= retainTopic(entity.stateTopic);
+    }
+
+    if (!existed) emit entitiesChanged(entityCount());
+    if (topicsChanged) emit stateTopicsChanged();
+}
+
+bool DiscoveryRegistry::removeEntity(const QString &discoveryTopic)
+{
+    const auto it = m_entities.constFind(discoveryTopic);
+    if (it == m_entities.cend()) return false;
+
+    const QString stateTopic = it->stateTopic;
+    m_entities.erase(it);
+
+    emit entitiesChanged(entityCount());
+    if (!stateTopic.isEmpty() && releaseTopic(stateTopic))
+        emit stateTopicsChanged();
+    return true;
+}
+
+// true when the topic was not referenced before
+bool DiscoveryRegistry::retainTopic(const QString &topic)
+{
+    return ++m_stateTopicRefs[topic] == 1;
+}
+
+// true when the last reference went away
+bool DiscoveryRegistry::releaseTopic(const QString &topic)
+{
+    auto it = m_stateTopicRefs.find(topic);
+    if (it == m_stateTopicRefs.end()) return false;
+    if (--it.value() > 0) return false;
+    m_stateTopicRefs.erase(it);
+    return true;
+}
+
+QStringList DiscoveryRegistry::stateTopics() const
+{
+    QStringList topics = m_stateTopicRefs.keys();
+    topics.sort();
+    return topics;
+}
+
+void DiscoveryRegistry::scheduleSave()
+{
+    m_dirty = true;
+    if (!m_brokerKey.isEmpty() && !m_saveTimer->isActive())
+        m_saveTimer->start();
+}
+
+QString DiscoveryRegistry::cachePath(const QString &brokerKey) const
+{
+    const QByteArray id = QCryptographicHash::hash((brokerKey + u'|' + m_prefix).toUtf8(),
+                                                   QCryptographicHash::Sha1).toHex().left(16);
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+         + QStringLiteral("/mqttrain/discovery-") + QString::fromLatin1(id) + QStringLiteral(".json");
+}
+
+void DiscoveryRegistry::loadCache(const QString &brokerKey)
+{
+    if (brokerKey == m_brokerKey) return;
+
+    flushCache();
+    m_brokerKey = brokerKey;
+
+    const bool hadTopics = !m_stateTopicRefs.isEmpty();
+    m_entities.clear();
+    m_stateTopicRefs.clear();
+
+    QFile file(cachePath(brokerKey));
+    if (file.open(QIODevice::ReadOnly)) {
+        const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+        if (root.value(QStringLiteral("version")).toInt() == kCacheVersion) {
+            const QJsonObject entities = root.value(QStringLiteral("entities")).toObject();
+            for (auto it = entities.constBegin(); it != entities.constEnd(); ++it) {
+                const Entity e = Entity::fromJson(it.value().toObject());
+                m_entities.insert(it.key(), e);
+                if (!e.stateTopic.isEmpty()) retainTopic(e.stateTopic);
+            }
+        }
+        qDebug() << "🏠 discovery cache:" << m_entities.size() << "entities," << m_stateTopicRefs.size()
+                 << "state topics from" << file.fileName();
+    }
+
+    m_dirty = false;
+    emit entitiesChanged(entityCount());
+    if (hadTopics || !m_stateTopicRefs.isEmpty())
+        emit stateTopicsChanged();
+}
+
+void DiscoveryRegistry::flushCache()
+{
+    m_saveTimer->stop();
+    if (!m_dirty || m_brokerKey.isEmpty()) return;
+    m_dirty = false;
+
+    QJsonObject entities;
+    for (auto it = m_entities.constBegin(); it != m_entities.constEnd(); ++it)
+        entities.insert(it.key(), it->toJson());
+
+    const QJsonObject root {
+        { QStringLiteral("version"),  kCacheVersion },
+        { QStringLiteral("prefix"),   m_prefix },
+        { QStringLiteral("entities"), entities },
+    };
+
+    const QString path = cachePath(m_brokerKey);
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "⚠️ discovery cache not writable:" << path << file.errorString();
+        return;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    if (!file.commit())
+        qWarning() << "⚠️ discovery cache write failed:" << path << file.errorString();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+// Home Assistant MQTT discovery registry (docs/mqtt-specs.md §2).
+//
+// Consumes <prefix>/<component>/[<node_id>/]<object_id>/config payloads,
+// normalises the abbreviated keys (stat_t → state_topic, dev → device,
+// ...) and expands '~' base topics, and keeps one Entity per discovery
+// topic. The union of their state topics is what MqttConnection
+// subscribes to instead of a broad wildcard.
+//
+// The registry is cached on disk per broker, so at the next login the
+// state topics are known before the first discovery message arrives.
+// Each entity remembers a hash of its raw payload: the retained replay
+// that follows every (re)subscribe is recognised and skipped without
+// parsing JSON again. An empty payload removes the entity, as in HA.
+class DiscoveryRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Entity
+    {
+        QString    component;
+        QString    objectId;
+        QString    name;
+        QString    uniqueId;
+        QString    stateTopic;
+        QString    commandTopic;
+        QString    availabilityTopic;
+        QString    jsonAttributesTopic;
+        QString    deviceClass;
+        QString    unit;
+        QByteArray payloadHash;
+
+        QJsonObject toJson() const;
+        static Entity fromJson(const QJsonObject &o);
+    };
+
+    explicit DiscoveryRegistry(QObject *parent = nullptr);
+    ~DiscoveryRegistry() override;
+
+    QString prefix() const { return m_prefix; }
+    void    setPrefix(const QString &prefix);
+
+    // Subscriptions needed to follow discovery itself
+    QStringList discoveryFilters() const;
+    bool        isDiscoveryTopic(QStringView topic) const;
+
+    // Returns false when the payload could not be used (kept for logging).
+    bool handleMessage(const QString &topic, const QByteArray &payload);
+
+    // Distinct state topics of all known entities, sorted
+    QStringList stateTopics() const;
+    bool        isStateTopic(const QString &topic) const { return m_stateTopicRefs.contains(topic); }
+    int         entityCount() const { return int(m_entities.size()); }
+
+    // Switches to the cache of another broker; key identifies it (host:port)
+    void loadCache(const QString &brokerKey);
+    void flushCache();
+
+    static QJsonObject normalize(const QJsonObject &config);
+
+signals:
+    void stateTopicsChanged();
+    void entitiesChanged(int count);
+
+private:
+    void addEntity(const QString &discoveryTopic, const Entity &entity);
+    bool removeEntity(const QString &discoveryTopic);
+    bool retainTopic(const QString &topic);
+    bool releaseTopic(const QString &topic);
+    void scheduleSave();
+    QString cachePath(const QString &brokerKey) const;
+
+    QString                 m_prefix;
+    QString                 m_brokerKey;
+    QHash<QString, Entity>  m_entities;         // by discovery topic
+    QHash<QString, int>     m_stateTopicRefs;   // state topic → entity count
+    QTimer                 *m_saveTimer;
+    bool                    m_dirty;
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <QtGlobal>
+
+// Adaptive quality for MatrixRainItem: keeps the rain inside a frame
+// budget when the machine is busy (a compile, a video call) instead of
+// competing with the foreground for frames it cannot deliver.
+//
+// Every tick reports what it cost on the GUI thread (tick plus the last
+// scene-graph upload). Over a window of kWindow ticks the mean is
+// compared with the budget, kBudgetShare of the nominal frame interval:
+// over it the level steps down at once, under kHeadroom of it for
+// kCalmWindows windows in a row it steps back up. Each level keeps the
+// savings of the ones before:
+//
+//   Full          everything
+//   NoGlitches    no glitch rolls or jitter (no per-column random draws)
+//   HalfInline    renderInlineChars every other tick
+//   ReducedSpeed  frame interval × 1.5
+//   HalfColumns   each tick walks every other column; a column moves
+//                 two rows on its turn, so the fall speed is kept
+class FrameGovernor
+{
+public:
+    enum Level { Full, NoGlitches, HalfInline, ReducedSpeed, HalfColumns, LevelCount };
+
+    static constexpr int   kWindow = 32;
+    static constexpr qreal kBudgetShare = 0.5;
+    static constexpr qreal kHeadroom = 0.5;
+    static constexpr int   kCalmWindows = 4;
+
+    void setEnabled(bool enabled)
+    {
+        m_enabled = enabled;
+        reset();
+    }
+    bool enabled() const { return m_enabled; }
+
+    void setIntervalMs(int ms) { m_budgetNs = qint64(ms * 1e6 * kBudgetShare); }
+    qint64 budgetNs() const { return m_budgetNs; }
+    // Mean cost of the last complete window
+    qint64 meanNs() const { return m_meanNs; }
+
+    Level level() const { return m_level; }
+    void reset()
+    {
+        m_level = Full;
+        m_sumNs = 0;
+        m_samples = 0;
+        m_calm = 0;
+    }
+
+    // Returns true when the level changed
+    bool addFrame(qint64 nsecs)
+    {
+        if (!m_enabled || m_budgetNs <= 0) return false;
+        m_sumNs += nsecs;
+        if (++m_samples < kWindow) return false;
+
+        m_meanNs = m_sumNs / m_samples;
+        m_sumNs = 0;
+        m_samples = 0;
+
+        if (m_meanNs > m_budgetNs) {
+            m_calm = 0;
+            if (m_level + 1 == LevelCount) return false;
+            m_level = Level(m_level + 1);
+            return true;
+        }
+        if (m_meanNs < m_budgetNs * kHeadroom && m_level > Full && ++m_calm >= kCalmWindows) {
+            m_calm = 0;
+            m_level = Level(m_level - 1);
+            return true;
+        }
+        if (m_meanNs >= m_budgetNs * kHeadroom) m_calm = 0;
+        return false;
+    }
+
+    bool  glitches() const { return m_level < NoGlitches; }
+    bool  inlineEveryTick() const { return m_level < HalfInline; }
+    qreal intervalFactor() const { return m_level >= ReducedSpeed ? 1.5 : 1.0; }
+    bool  halfColumns() const { return m_level >= HalfColumns; }
+
+    static const char *name(Level level)
+    {
+        static const char *const names[LevelCount] = {
+            "full", "no glitches", "half inline", "reduced speed", "half columns"
+        };
+        return names[level];
+    }
+
+private:
+    bool   m_enabled = true;
+    Level  m_level = Full;
+    qint64 m_budgetNs = 0;
+    qint64 m_sumNs = 0;
+    qint64 m_meanNs = 0;
+    int    m_samples = 0;
+    int    m_calm = 0;
+};
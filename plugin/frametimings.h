@@ -0,0 +1,73 @@
+#pragma once
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QtGlobal>
+#include <algorithm>
+#include <array>
+
+// Rolling per-step durations of MatrixRainItem's frame pipeline.
+//
+// Each step keeps its last kWindow samples in a fixed ring, so recording
+// is a store and an increment; percentiles are only computed when the
+// debug overlay polls (RainStats, once a second). Steps are recorded
+// independently: a tick without a scene-graph sync adds no Upload sample.
+class FrameTimings
+{
+public:
+    enum Step {
+        Fade,          // step 1: CPU cell decay or GPU mask reset
+        Columns,       // step 2: renderColumnContent / onColumnWrap per column
+        InlineChars,   // step 3: renderInlineChars
+        Tick,          // the whole GUI-thread tick, steps 1–3
+        Upload,        // updatePaintNode: quads built for the scene graph
+        StepCount
+    };
+
+    // ~5 s at 50 fps
+    static constexpr int kWindow = 256;
+
+    void add(Step step, qint64 nsecs)
+    {
+        Ring &r = m_rings[size_t(step)];
+        r.samples[size_t(r.next)] = nsecs;
+        r.next = (r.next + 1) % kWindow;
+        r.count = qMin(r.count + 1, kWindow);
+    }
+
+    void clear() { m_rings = {}; }
+
+    // [{step, p50, p95, p99}] in milliseconds; steps without samples are left out
+    QVariantList percentiles() const
+    {
+        static const char *const names[StepCount] = { "fade", "columns", "inline", "tick", "upload" };
+
+        QVariantList out;
+        std::array<qint64, kWindow> sorted;
+        for (int s = 0; s < StepCount; ++s) {
+            const Ring &r = m_rings[size_t(s)];
+            if (r.count == 0) continue;
+
+            std::copy_n(r.samples.begin(), r.count, sorted.begin());
+            std::sort(sorted.begin(), sorted.begin() + r.count);
+            auto at = [&](int pct) { return sorted[size_t((r.count - 1) * pct / 100)] / 1e6; };
+            out.append(QVariantMap {
+                { QStringLiteral("step"), QString::fromLatin1(names[s]) },
+                { QStringLiteral("p50"),  at(50) },
+                { QStringLiteral("p95"),  at(95) },
+                { QStringLiteral("p99"),  at(99) },
+            });
+        }
+        return out;
+    }
+
+private:
+    struct Ring
+    {
+        std::array<qint64, kWindow> samples {};
+        int next = 0;
+        int count = 0;
+    };
+
+    std::array<Ring, StepCount> m_rings {};
+};
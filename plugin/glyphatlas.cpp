@@ -0,0 +1,134 @@
+#include "glyphatlas.h"
+#include <QFontMetrics>
+#include <QPainter>
+
+GlyphAtlas::GlyphAtlas()
+    : m_fontSize(0)
+    , m_cellW(0)
+    , m_cellH(0)
+    , m_ascent(0)
+    , m_fallback(0)
+    , m_ascii{}
+    , m_katakana{}
+    , m_generation(0)
+{
+    m_font.setFamily(QStringLiteral("monospace"));
+    m_font.setStyleHint(QFont::Monospace);
+    setFontSize(16);
+}
+
+void GlyphAtlas::setFontSize(int px)
+{
+    px = qMax(1, px);
+    if (m_fontSize == px) return;
+    m_fontSize = px;
+    m_font.setPixelSize(px);
+    rebuild();
+}
+
+int GlyphAtlas::lookup(QChar ch)
+{
+    if (ch.isSurrogate()) return m_fallback;
+
+    auto it = m_index.constFind(ch.unicode());
+    if (it != m_index.constEnd()) return it.value();
+
+    int slot = addGlyph(ch);
+    return slot >= 0 ? slot : m_fallback;
+}
+
+void GlyphAtlas::rebuild()
+{
+    QFontMetrics fm(m_font);
+    m_ascent = fm.ascent();
+    // Katakana is full-width, so size cells for the widest glyph rather than
+    // the ASCII advance; the column pitch stays fontSize regardless.
+    m_cellW = qMax(m_fontSize, fm.maxWidth()) + 2 * kPadding;
+    m_cellH = fm.height() + 2 * kPadding;
+
+    const QVector<QChar> previous = m_chars;
+
+    m_index.clear();
+    m_chars.clear();
+    m_uv.clear();
+    m_image = QImage(kColumns * m_cellW, 8 * m_cellH, QImage::Format_ARGB32_Premultiplied);
+    m_image.fill(Qt::transparent);
+
+    for (char16_t c = 0x20; c <= 0x7E; ++c)
+        addGlyph(QChar(c));
+    for (char16_t c = 0x30A0; c <= 0x30FF; ++c)
+        addGlyph(QChar(c));
+    addGlyph(QChar(0x00B7));   // '·' placeholder used by MqttOnlyRenderer
+    m_fallback = m_index.value(u'?');
+
+    // Control characters (payload newlines, tabs) draw as blanks
+    m_ascii.fill(m_index.value(u' '));
+    for (char16_t c = 0x20; c <= 0x7E; ++c)
+        m_ascii[c] = m_index.value(c);
+    for (char16_t c = 0x30A0; c <= 0x30FF; ++c)
+        m_katakana[c - 0x30A0] = m_index.value(c);
+
+    // Keep payload glyphs that were added lazily before the font changed.
+    for (QChar ch : previous) {
+        if (!m_index.contains(ch.unicode()))
+            addGlyph(ch);
+    }
+
+    updateUv();
+    ++m_generation;
+}
+
+bool GlyphAtlas::grow()
+{
+    if (m_image.height() / m_cellH * kColumns >= kMaxSlots) return false;
+
+    QImage bigger(m_image.width(), m_image.height() * 2, QImage::Format_ARGB32_Premultiplied);
+    bigger.fill(Qt::transparent);
+    QPainter p(&bigger);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    p.drawImage(0, 0, m_image);
+    p.end();
+    m_image = bigger;
+    updateUv();
+    return true;
+}
+
+int GlyphAtlas::addGlyph(QChar ch)
+{
+    const int slot = m_chars.size();
+    const int capacity = (m_image.height() / m_cellH) * kColumns;
+    if (slot >= capacity && !grow()) return -1;
+
+    m_chars.append(ch);
+    m_index.insert(ch.unicode(), slot);
+    rasterize(ch, slot);
+
+    const qreal w = m_image.width();
+    const qreal h = m_image.height();
+    m_uv.append(QRectF((slot % kColumns) * m_cellW / w, (slot / kColumns) * m_cellH / h,
+                       m_cellW / w, m_cellH / h));
+    ++m_generation;
+    return slot;
+}
+
+void GlyphAtlas::rasterize(QChar ch, int slot)
+{
+    const int x = (slot % kColumns) * m_cellW;
+    const int y = (slot / kColumns) * m_cellH;
+
+    QPainter p(&m_image);
+    p.setFont(m_font);
+    p.setPen(Qt::white);
+    p.drawText(x + kPadding, y + kPadding + m_ascent, QString(ch));
+}
+
+void GlyphAtlas::updateUv()
+{
+    const qreal w = m_image.width();
+    const qreal h = m_image.height();
+    m_uv.resize(m_chars.size());
+    for (int slot = 0; slot < m_chars.size(); ++slot) {
+        m_uv[slot] = QRectF((slot % kColumns) * m_cellW / w, (slot / kColumns) * m_cellH / h,
+                            m_cellW / w, m_cellH / h);
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QRectF>
+#include <QVector>
+#include <array>
+
+// White-on-transparent glyph atlas for the native rain renderer.
+//
+// Glyphs are rasterised once into a single QImage and looked up by index;
+// colour is applied per vertex by the glyph material, so one atlas serves
+// every palette entry. Katakana (U+30A0–U+30FF) and printable ASCII are
+// prebuilt, anything else (payload characters) is added on first use.
+// The prebuilt ranges are looked up in flat tables; only payload
+// characters outside them go through the hash.
+class GlyphAtlas
+{
+public:
+    GlyphAtlas();
+
+    void setFontSize(int px);
+    int  fontSize() const { return m_fontSize; }
+
+    // Returns the atlas slot for ch, rasterising it if needed.
+    // Falls back to '?' when the atlas is full or ch is a lone surrogate.
+    int glyphIndex(QChar ch)
+    {
+        const char16_t c = ch.unicode();
+        if (c < 0x80) return m_ascii[c];
+        if (c >= 0x30A0 && c <= 0x30FF) return m_katakana[c - 0x30A0];
+        return lookup(ch);
+    }
+
+    const QRectF &uvRect(int index) const { return m_uv[index]; }
+    const QImage &image()      const { return m_image; }
+    int           cellWidth()  const { return m_cellW; }
+    int           cellHeight() const { return m_cellH; }
+    int           ascent()     const { return m_ascent; }
+    int           padding()    const { return kPadding; }
+
+    // Bumped every time image() changes; the render thread re-uploads the
+    // texture when its copy of the generation is stale.
+    quint64 generation() const { return m_generation; }
+
+private:
+    static constexpr int kPadding  = 1;
+    static constexpr int kColumns  = 32;
+    static constexpr int kMaxSlots = 4096;
+
+    int  lookup(QChar ch);
+    void rebuild();
+    bool grow();
+    int  addGlyph(QChar ch);
+    void rasterize(QChar ch, int slot);
+    void updateUv();
+
+    QFont                  m_font;
+    QImage                 m_image;
+    QHash<char16_t, int>   m_index;
+    QVector<QChar>         m_chars;
+    QVector<QRectF>        m_uv;
+    int                    m_fontSize;
+    int                    m_cellW;
+    int                    m_cellH;
+    int                    m_ascent;
+    int                    m_fallback;
+    std::array<int, 0x80>  m_ascii;      // slot per code unit, ' ' below 0x20
+    std::array<int, 0x60>  m_katakana;   // U+30A0 + i
+    quint64                m_generation;
+};
@@ -0,0 +1,100 @@
+#include "glyphmaterial.h"
+#include <QMatrix4x4>
+#include <QSGMaterialShader>
+#include <cstring>
+
+namespace {
+
+class GlyphMaterialShader : public QSGMaterialShader
+{
+public:
+    GlyphMaterialShader()
+    {
+        setShaderFileName(VertexStage,   QStringLiteral(":/mqttrain/shaders/glyph.vert.qsb"));
+        setShaderFileName(FragmentStage, QStringLiteral(":/mqttrain/shaders/glyph.frag.qsb"));
+    }
+
+    bool updateUniformData(RenderState &state, QSGMaterial *, QSGMaterial *) override
+    {
+        QByteArray *buf = state.uniformData();
+        bool changed = false;
+        if (state.isMatrixDirty()) {
+            const QMatrix4x4 m = state.combinedMatrix();
+            std::memcpy(buf->data(), m.constData(), 64);
+            changed = true;
+        }
+        if (state.isOpacityDirty()) {
+            const float opacity = state.opacity();
+            std::memcpy(buf->data() + 64, &opacity, 4);
+            changed = true;
+        }
+        return changed;
+    }
+
+    void updateSampledImage(RenderState &state, int binding, QSGTexture **texture,
+                            QSGMaterial *newMaterial, QSGMaterial *) override
+    {
+        if (binding != 1) return;
+        auto *mat = static_cast<GlyphMaterial *>(newMaterial);
+        if (!mat->texture()) return;
+        mat->texture()->commitTextureOperations(state.rhi(), state.resourceUpdateBatch());
+        *texture = mat->texture();
+    }
+};
+
+} // namespace
+
+GlyphMaterial::GlyphMaterial()
+    : m_texture(nullptr)
+{
+    setFlag(Blending, true);
+}
+
+GlyphMaterial::~GlyphMaterial()
+{
+    delete m_texture;
+}
+
+QSGMaterialType *GlyphMaterial::type() const
+{
+    static QSGMaterialType type;
+    return &type;
+}
+
+QSGMaterialShader *GlyphMaterial::createShader(QSGRendererInterface::RenderMode) const
+{
+    return new GlyphMaterialShader;
+}
+
+int GlyphMaterial::compare(const QSGMaterial *other) const
+{
+    auto *o = static_cast<const GlyphMaterial *>(other);
+    if (m_texture == o->m_texture) return 0;
+    return m_texture < o->m_texture ? -1 : 1;
+}
+
+void GlyphMaterial::setTexture(QSGTexture *texture)
+{
+    if (m_texture == texture) return;
+    delete m_texture;
+    m_texture = texture;
+    if (m_texture) {
+        m_texture->setFiltering(QSGTexture::Linear);
+        m_texture->setHorizontalWrapMode(QSGTexture::ClampToEdge);
+        m_texture->setVerticalWrapMode(QSGTexture::ClampToEdge);
+    }
+}
+
+const QSGGeometry::AttributeSet &GlyphMaterial::attributes()
+{
+    static const QSGGeometry::Attribute attrs[] = {
+        QSGGeometry::Attribute::createWithAttributeType(0, 2, QSGGeometry::FloatType,
+                                                        QSGGeometry::PositionAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(1, 2, QSGGeometry::FloatType,
+                                                        QSGGeometry::TexCoordAttribute),
+        QSGGeometry::Attribute::createWithAttributeType(2, 4, QSGGeometry::UnsignedByteType,
+                                                        QSGGeometry::ColorAttribute),
+    };
+    static const QSGGeometry::AttributeSet set = { 3, sizeof(GlyphVertex), attrs };
+    return set;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <QSGGeometry>
+#include <QSGMaterial>
+#include <QSGTexture>
+
+// Vertex layout of one glyph quad corner: position, atlas UV and a
+// premultiplied RGBA colour (the atlas only carries coverage in alpha).
+struct GlyphVertex
+{
+    float x, y;
+    float u, v;
+    uchar r, g, b, a;
+};
+
+// Textured, per-vertex tinted material used by MatrixRainItem.
+// Owns its atlas texture; shaders are compiled into the plugin resources
+// by qt_add_shaders (see CMakeLists.txt).
+class GlyphMaterial : public QSGMaterial
+{
+public:
+    GlyphMaterial();
+    ~GlyphMaterial() override;
+
+    QSGMaterialType   *type() const override;
+    QSGMaterialShader *createShader(QSGRendererInterface::RenderMode renderMode) const override;
+    int                compare(const QSGMaterial *other) const override;
+
+    QSGTexture *texture() const { return m_texture; }
+    void        setTexture(QSGTexture *texture);
+
+    static const QSGGeometry::AttributeSet &attributes();
+
+private:
+    QSGTexture *m_texture;
+};
@@ -0,0 +1,68 @@
+#pragma once
+#include <QtGlobal>
+#include <atomic>
+
+// Process-wide byte count of what MQTT traffic keeps alive: queued
+// messages, the latest payloads of a shared connection, messages held
+// while suspended, interned topics and the MessageRing buffers.
+//
+// Every MQTTRain instance in plasmashell charges the same ledger, so the
+// cap is one bound for the whole process rather than per wallpaper.
+// Structures that can shed (a new queue entry, a new held or latest
+// topic) ask tryCharge() and give up the message when the cap would be
+// exceeded; structures bounded by a count (rings, interner) charge and
+// trim themselves. peak() is the high-water mark since start.
+//
+// Sizes are estimates (UTF-16 units × 2, byte arrays by size), not
+// allocator truth; they track the growth that matters after days of
+// uptime. Relaxed atomics: charged on connection threads, read on the
+// GUI thread.
+class MemoryLedger
+{
+public:
+    static constexpr qint64 kDefaultCap = 32 * 1024 * 1024;
+
+    static MemoryLedger &instance()
+    {
+        static MemoryLedger ledger;
+        return ledger;
+    }
+
+    qint64 bytes() const { return m_bytes.load(std::memory_order_relaxed); }
+    qint64 peak()  const { return m_peak.load(std::memory_order_relaxed); }
+    qint64 cap()   const { return m_cap.load(std::memory_order_relaxed); }
+    void   setCap(qint64 cap) { m_cap.store(qMax<qint64>(0, cap), std::memory_order_relaxed); }
+    // Over the cap already; 0 means no cap
+    bool   overCap() const { return cap() > 0 && bytes() > cap(); }
+
+    void charge(qint64 n)
+    {
+        if (n <= 0) return;
+        raisePeak(m_bytes.fetch_add(n, std::memory_order_relaxed) + n);
+    }
+    void credit(qint64 n)
+    {
+        if (n > 0) m_bytes.fetch_sub(n, std::memory_order_relaxed);
+    }
+    // Charges n unless that would go over the cap
+    bool tryCharge(qint64 n)
+    {
+        const qint64 limit = cap();
+        if (limit > 0 && bytes() + n > limit) return false;
+        charge(n);
+        return true;
+    }
+
+private:
+    MemoryLedger() = default;
+
+    void raisePeak(qint64 now)
+    {
+        qint64 seen = m_peak.load(std::memory_order_relaxed);
+        while (now > seen && !m_peak.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {}
+    }
+
+    std::atomic<qint64> m_bytes { 0 };
+    std::atomic<qint64> m_peak { 0 };
+    std::atomic<qint64> m_cap { kDefaultCap };
+};
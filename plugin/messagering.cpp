@@ -0,0 +1,106 @@
+#include "messagering.h"
+#include "memoryledger.h"
+#include "mqttpayload.h"
+
+MessageRing::MessageRing(QObject *parent)
+    : QObject(parent)
+    , m_next(0)
+    , m_count(0)
+{
+}
+
+MessageRing::~MessageRing()
+{
+    for (const Entry &e : m_slots)
+        MemoryLedger::instance().credit(e.bytes);
+}
+
+void MessageRing::setCapacity(int capacity)
+{
+    capacity = qMax(0, capacity);
+    if (capacity == int(m_slots.size())) return;
+
+    // Newest first into a fresh ring, the rest handed back
+    std::vector<Entry> slots(size_t(capacity), Entry());
+    const int kept = qMin(m_count, capacity);
+    for (int i = 0; i < kept; ++i)
+        slots[size_t(kept - 1 - i)] = std::move(m_slots[slot(i)]);
+    while (m_count > kept) dropOldest();
+
+    m_slots = std::move(slots);
+    m_count = kept;
+    m_next = capacity > 0 ? size_t(kept % capacity) : 0;
+    emit capacityChanged();
+    emit updated();
+}
+
+void MessageRing::push(const QString &topic, const QVariant &payload, const QJSValue &chars)
+{
+    if (m_slots.empty()) return;
+
+    MemoryLedger &ledger = MemoryLedger::instance();
+    Entry &e = m_slots[m_next];
+    ledger.credit(e.bytes);
+    e.topic = topic;
+    e.payload = payload;
+    e.chars = chars;
+    e.bytes = footprint(topic, payload, chars);
+    ledger.charge(e.bytes);
+
+    m_next = (m_next + 1) % m_slots.size();
+    m_count = qMin(m_count + 1, int(m_slots.size()));
+
+    // Over the cap the newest entry is all a ring is worth
+    while (m_count > 1 && ledger.overCap()) dropOldest();
+    emit updated();
+}
+
+void MessageRing::clear()
+{
+    if (m_count == 0) return;
+    while (m_count > 0) dropOldest();
+    m_next = 0;
+    emit updated();
+}
+
+QString MessageRing::topic(int index) const
+{
+    return index >= 0 && index < m_count ? m_slots[slot(index)].topic : QString();
+}
+
+QVariant MessageRing::payload(int index) const
+{
+    return index >= 0 && index < m_count ? m_slots[slot(index)].payload : QVariant();
+}
+
+QJSValue MessageRing::chars(int index) const
+{
+    return index >= 0 && index < m_count ? m_slots[slot(index)].chars : QJSValue();
+}
+
+qint64 MessageRing::footprint(const QString &topic, const QVariant &payload, const QJSValue &chars)
+{
+    qint64 bytes = qint64(topic.size()) * 2;
+    if (payload.metaType() == QMetaType::fromType<MqttPayload>())
+        bytes += payload.value<MqttPayload>().size();
+    else
+        bytes += qint64(payload.toString().size()) * 2;
+    // Display chars: UTF-16 text plus one flag byte per unit
+    if (chars.isObject())
+        bytes += qint64(chars.property(QStringLiteral("length")).toInt()) * 3;
+    return bytes;
+}
+
+size_t MessageRing::slot(int index) const
+{
+    const size_t n = m_slots.size();
+    return (m_next + n - 1 - size_t(index)) % n;
+}
+
+void MessageRing::dropOldest()
+{
+    Entry &e = m_slots[slot(m_count - 1)];
+    MemoryLedger::instance().credit(e.bytes);
+    e = Entry();
+    --m_count;
+}
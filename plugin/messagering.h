@@ -0,0 +1,65 @@
+#pragma once
+#include <QJSValue>
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <vector>
+
+// Fixed-size ring of recent messages for QML: the debug overlay's history
+// and MqttOnlyRenderer's rotation pool.
+//
+// Replaces JS arrays that were copied with slice() and re-sliced on every
+// message just to get a property change. Slots are allocated once per
+// capacity and overwritten in place, oldest first; updated() is the
+// single change notifier. Index 0 is the newest entry.
+//
+// An entry is a topic, a payload (an MqttPayload handle, or anything
+// else QML passes) and an optional opaque chars value (display chars
+// {text, flags, length}). Their size is charged to the MemoryLedger;
+// while it is over its cap a push trims the ring down to the entry just
+// pushed. GUI thread only.
+class MessageRing : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int capacity READ capacity WRITE setCapacity NOTIFY capacityChanged)
+    Q_PROPERTY(int count    READ count                      NOTIFY updated)
+
+public:
+    explicit MessageRing(QObject *parent = nullptr);
+    ~MessageRing() override;
+
+    int  capacity() const { return int(m_slots.size()); }
+    int  count()    const { return m_count; }
+    // Keeps the newest entries that still fit
+    void setCapacity(int capacity);
+
+    Q_INVOKABLE void push(const QString &topic, const QVariant &payload, const QJSValue &chars = QJSValue());
+    Q_INVOKABLE void clear();
+
+    // Empty / undefined past count
+    Q_INVOKABLE QString  topic(int index) const;
+    Q_INVOKABLE QVariant payload(int index) const;
+    Q_INVOKABLE QJSValue chars(int index) const;
+
+signals:
+    void capacityChanged();
+    void updated();
+
+private:
+    struct Entry
+    {
+        QString  topic;
+        QVariant payload;
+        QJSValue chars;
+        qint64   bytes = 0;   // charged to the MemoryLedger
+    };
+
+    static qint64 footprint(const QString &topic, const QVariant &payload, const QJSValue &chars);
+    // Slot of the index-th newest entry; index < m_count
+    size_t slot(int index) const;
+    void   dropOldest();
+
+    std::vector<Entry> m_slots;
+    size_t             m_next;    // slot the next push overwrites
+    int                m_count;
+};
@@ -0,0 +1,136 @@
+#include "messagesnapshot.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace {
+constexpr quint32 kMagic = 0x4d51534e;   // "MQSN"
+constexpr quint16 kVersion = 1;
+// Bridge dumps are not worth a warm start; their display form still is
+constexpr qsizetype kMaxPayloadBytes = 16 * 1024;
+}
+
+MessageSnapshot::MessageSnapshot()
+    : m_capacity(0)
+    , m_dirty(false)
+{
+}
+
+MessageSnapshot::~MessageSnapshot()
+{
+    save();
+}
+
+void MessageSnapshot::setCapacity(int capacity)
+{
+    m_capacity = qMax(0, capacity);
+    if (m_messages.size() > m_capacity) {
+        m_messages.remove(0, m_messages.size() - m_capacity);
+        m_dirty = true;
+    }
+}
+
+QString MessageSnapshot::path(const QString &key)
+{
+    const QByteArray id = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+         + QStringLiteral("/mqttrain/snapshot-") + QString::fromLatin1(id) + QStringLiteral(".bin");
+}
+
+void MessageSnapshot::load(const QString &key)
+{
+    if (key == m_key) return;
+
+    save();
+    m_key = key;
+    m_messages.clear();
+    m_dirty = false;
+    if (key.isEmpty() || m_capacity == 0) return;
+
+    QFile file(path(key));
+    if (!file.open(QIODevice::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != kMagic || version != kVersion) {
+        qWarning() << "⚠️ snapshot ignored, unknown format:" << file.fileName();
+        return;
+    }
+
+    // Oldest first on disk: with a smaller capacity since the save, the
+    // newest capacity records are kept, as setCapacity() would
+    const quint32 skip = count > quint32(m_capacity) ? count - quint32(m_capacity) : 0;
+    m_messages.reserve(qMin<quint32>(count, quint32(m_capacity)));
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString topic;
+        QByteArray payload;
+        MqttInbound m;
+        in >> topic >> payload >> m.display.text >> m.display.flags;
+        if (in.status() != QDataStream::Ok || m.display.flags.size() != m.display.text.size())
+            break;
+        if (i < skip) continue;
+        m.topic = topic;
+        m.payload = MqttPayload(payload);
+        m_messages.append(std::move(m));
+    }
+    if (in.status() != QDataStream::Ok)
+        qWarning() << "⚠️ snapshot truncated:" << file.fileName();
+    qDebug() << "♻️ snapshot:" << m_messages.size() << "message(s) from" << file.fileName();
+}
+
+void MessageSnapshot::save()
+{
+    if (!m_dirty || m_key.isEmpty()) return;
+    m_dirty = false;
+
+    const QString file = path(m_key);
+    QDir().mkpath(QFileInfo(file).absolutePath());
+
+    QSaveFile out(file);
+    if (!out.open(QIODevice::WriteOnly)) {
+        qWarning() << "⚠️ snapshot not writable:" << file << out.errorString();
+        return;
+    }
+    QDataStream stream(&out);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << kMagic << kVersion << quint32(m_messages.size());
+    for (const MqttInbound &m : std::as_const(m_messages))
+        stream << m.topic << m.payload.bytes() << m.display.text << m.display.flags;
+    if (!out.commit())
+        qWarning() << "⚠️ snapshot write failed:" << file << out.errorString();
+}
+
+void MessageSnapshot::record(const MqttInbound &message)
+{
+    if (m_capacity == 0 || m_key.isEmpty()) return;
+
+    MqttInbound m;
+    m.topic = message.topic;
+    // The preview is all QML reads of a restored payload
+    const QByteArray &bytes = message.payload.bytes();
+    m.payload = bytes.size() > kMaxPayloadBytes
+        ? MqttPayload(bytes.first(MqttPayload::utf8Prefix(bytes, kMaxPayloadBytes)))
+        : message.payload;
+    m.display = message.display;
+
+    // A topic shown again moves to the end instead of taking a second slot
+    for (qsizetype i = 0; i < m_messages.size(); ++i) {
+        if (m_messages[i].topic == m.topic) {
+            m_messages.removeAt(i);
+            break;
+        }
+    }
+    if (m_messages.size() >= m_capacity)
+        m_messages.removeFirst();
+    m_messages.append(std::move(m));
+    m_dirty = true;
+}
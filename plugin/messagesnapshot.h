@@ -0,0 +1,41 @@
+#pragma once
+#include <QList>
+#include <QString>
+#include "mqttsubscriber.h"
+
+// The latest message of each of the last topics shown, in display form,
+// cached on disk per broker and topic list. At the next login MQTTClient hands them to the
+// renderers straight away, so the rain shows real values while the TCP
+// connect, CONNACK and retained replay are still under way; a renderer
+// built later (render mode switch) is filled from the same list.
+//
+// Written on a timer and when switching brokers, never per message.
+// GUI thread only.
+class MessageSnapshot
+{
+public:
+    MessageSnapshot();
+    ~MessageSnapshot();
+
+    // 0 disables recording (what is on disk stays)
+    void setCapacity(int capacity);
+    int  capacity() const { return m_capacity; }
+
+    QString key() const { return m_key; }
+    // Saves the current snapshot, then loads the one of key (maybe none)
+    void load(const QString &key);
+    void save();
+
+    // Oldest first
+    const QList<MqttInbound> &messages() const { return m_messages; }
+    void record(const MqttInbound &message);
+    bool isDirty() const { return m_dirty; }
+
+    static QString path(const QString &key);
+
+private:
+    QString            m_key;
+    QList<MqttInbound> m_messages;
+    int                m_capacity;
+    bool               m_dirty;
+};
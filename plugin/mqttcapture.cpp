@@ -0,0 +1,390 @@
+#include "mqttcapture.h"
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QUrl>
+#include <QtEndian>
+#include <cmath>
+
+namespace {
+constexpr char      kMagic[4] = { 'M', 'Q', 'R', 'C' };
+constexpr quint8    kVersion = 1;
+constexpr quint8    kFlagCompressed = 0x01;
+constexpr qsizetype kHeaderBytes = 16;
+constexpr qsizetype kBlockBytes = 64 * 1024;
+constexpr quint32   kBlockCompressed = 0x80000000u;
+constexpr quint32   kMaxBlockBytes = 1u << 30;
+
+void putVarint(QByteArray &out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.append(char(quint8(v) | 0x80));
+        v >>= 7;
+    }
+    out.append(char(v));
+}
+
+// End of the last complete block (or header) of a capture file, so a block
+// torn by a crash can be cut off before a new session is appended behind
+// it. -1 when the file is not a capture file.
+qint64 completeLength(QFile &file)
+{
+    const qint64 size = file.size();
+    qint64 pos = 0;
+    while (pos < size) {
+        if (!file.seek(pos)) return -1;
+        const QByteArray word = file.read(sizeof(kMagic));
+        if (word.size() < qsizetype(sizeof(kMagic))) break;
+        if (word == QByteArray(kMagic, sizeof(kMagic))) {
+            if (size - pos < kHeaderBytes) break;
+            pos += kHeaderBytes;
+            continue;
+        }
+        if (pos == 0) return -1;
+
+        const quint32 bytes = qFromLittleEndian<quint32>(word.constData()) & ~kBlockCompressed;
+        if (bytes >= kMaxBlockBytes || size - pos - 4 < qint64(bytes)) break;
+        pos += 4 + qint64(bytes);
+    }
+    return pos;
+}
+
+bool getVarint(const QByteArray &in, qsizetype &pos, quint64 *v)
+{
+    quint64 result = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        const quint8 b = quint8(in.at(pos++));
+        result |= quint64(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+}
+
+QString MqttCapture::localPath(const QString &pathOrUrl)
+{
+    QString path = pathOrUrl.trimmed();
+    if (path.startsWith(QLatin1String("file:")))
+        path = QUrl(path).toLocalFile();
+    if (path == u'~' || path.startsWith(QLatin1String("~/")))
+        path = QDir::homePath() + path.mid(1);
+    return path;
+}
+
+// ===== Writer =====
+
+MqttCaptureWriter::MqttCaptureWriter()
+    : m_lastUs(0)
+    , m_compress(false)
+    , m_messages(0)
+{
+}
+
+MqttCaptureWriter::~MqttCaptureWriter()
+{
+    close();
+}
+
+bool MqttCaptureWriter::open(const QString &path, bool compress, QString *error)
+{
+    close();
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    m_file.setFileName(path);
+
+    // Cut a torn tail first: the reader stops at it and would never reach
+    // the session appended after it
+    if (m_file.size() > 0 && m_file.open(QIODevice::ReadWrite)) {
+        const qint64 end = completeLength(m_file);
+        if (end >= 0 && end < m_file.size()) {
+            qWarning() << "⚠️ capture: dropping torn block at the end of" << path;
+            m_file.resize(end);
+        }
+        m_file.close();
+    }
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        *error = m_file.errorString();
+        return false;
+    }
+
+    QByteArray header(kMagic, sizeof(kMagic));
+    header.append(char(kVersion));
+    header.append(char(compress ? kFlagCompressed : 0));
+    header.append(2, '\0');
+    header.resize(kHeaderBytes);
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header.data() + 8);
+    if (m_file.write(header) != header.size() || !m_file.flush()) {
+        *error = m_file.errorString();
+        m_file.close();
+        return false;
+    }
+
+    m_topicIds.clear();
+    m_block.clear();
+    m_block.reserve(kBlockBytes + 1024);
+    m_clock.start();
+    m_lastUs = 0;
+    m_compress = compress;
+    m_messages = 0;
+    return true;
+}
+
+void MqttCaptureWriter::close()
+{
+    if (!m_file.isOpen()) return;
+    flush();
+    m_file.close();
+    m_topicIds.clear();
+}
+
+void MqttCaptureWriter::append(const QString &topic, const QByteArray &payload)
+{
+    if (!m_file.isOpen()) return;
+
+    const qint64 us = m_clock.nsecsElapsed() / 1000;
+    putVarint(m_block, quint64(qMax<qint64>(0, us - m_lastUs)));
+    m_lastUs = us;
+
+    const auto it = m_topicIds.constFind(topic);
+    if (it != m_topicIds.constEnd()) {
+        putVarint(m_block, *it);
+    } else {
+        const QByteArray utf8 = topic.toUtf8();
+        putVarint(m_block, 0);
+        putVarint(m_block, quint64(utf8.size()));
+        m_block.append(utf8);
+        m_topicIds.insert(topic, quint32(m_topicIds.size() + 1));
+    }
+
+    putVarint(m_block, quint64(payload.size()));
+    m_block.append(payload);
+    ++m_messages;
+
+    if (m_block.size() >= kBlockBytes)
+        flush();
+}
+
+void MqttCaptureWriter::flush()
+{
+    if (!m_file.isOpen() || m_block.isEmpty()) return;
+
+    QByteArray data = m_block;
+    quint32 tag = quint32(m_block.size());
+    if (m_compress) {
+        // Level 1: the connection thread has better things to do
+        const QByteArray packed = qCompress(m_block, 1);
+        if (packed.size() < m_block.size()) {
+            data = packed;
+            tag = quint32(packed.size()) | kBlockCompressed;
+        }
+    }
+    m_block.clear();
+
+    if (quint32(data.size()) >= kMaxBlockBytes) {
+        qWarning() << "⚠️ capture: block too large, dropped" << data.size() << "bytes";
+        return;
+    }
+
+    char size[4];
+    qToLittleEndian<quint32>(tag, size);
+    // One write per block: a reader never sees a size without its data
+    data.prepend(size, sizeof(size));
+    if (m_file.write(data) != data.size() || !m_file.flush()) {
+        qWarning() << "⚠️ capture write failed:" << m_file.fileName() << m_file.errorString();
+        m_file.close();
+    }
+}
+
+// ===== Reader =====
+
+MqttCaptureReader::MqttCaptureReader()
+    : m_binary(false)
+    , m_lineNo(0)
+    , m_lastUs(0)
+    , m_blockPos(0)
+    , m_sessionUs(0)
+    , m_sessionBaseUs(0)
+    , m_firstStartMs(-1)
+    , m_firstStampUs(-1)
+{
+}
+
+bool MqttCaptureReader::open(const QString &path, QString *error)
+{
+    close();
+    m_file.setFileName(path);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        *error = m_file.errorString();
+        return false;
+    }
+    m_binary = m_file.peek(sizeof(kMagic)) == QByteArray(kMagic, sizeof(kMagic));
+    if (!rewind()) {
+        *error = m_error;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MqttCaptureReader::close()
+{
+    m_file.close();
+    m_topics.clear();
+    m_textTopics.clear();
+    m_block.clear();
+}
+
+bool MqttCaptureReader::rewind()
+{
+    m_error.clear();
+    m_lineNo = 0;
+    m_lastUs = 0;
+    m_topics.clear();
+    m_block.clear();
+    m_blockPos = 0;
+    m_sessionUs = 0;
+    m_sessionBaseUs = 0;
+    m_firstStartMs = -1;
+    m_firstStampUs = -1;
+
+    if (!m_file.isOpen() || !m_file.seek(0))
+        return fail(QStringLiteral("not open"));
+    return !m_binary || readHeader();
+}
+
+bool MqttCaptureReader::fail(const QString &error)
+{
+    m_error = error;
+    return false;
+}
+
+bool MqttCaptureReader::next(MqttCaptureRecord *record)
+{
+    if (!m_file.isOpen() || !m_error.isEmpty()) return false;
+    if (!(m_binary ? nextBinary(record) : nextText(record))) return false;
+
+    record->atUs = qMax(m_lastUs, record->atUs);
+    m_lastUs = record->atUs;
+    return true;
+}
+
+bool MqttCaptureReader::nextText(MqttCaptureRecord *record)
+{
+    while (!m_file.atEnd()) {
+        QByteArray line = m_file.readLine();
+        ++m_lineNo;
+        if (line.endsWith('\n')) line.chop(1);
+        if (line.endsWith('\r')) line.chop(1);
+        if (line.trimmed().isEmpty()) continue;
+
+        const qsizetype s1 = line.indexOf(' ');
+        const qsizetype s2 = s1 < 0 ? -1 : line.indexOf(' ', s1 + 1);
+        bool ok = false;
+        const double seconds = s1 < 0 ? 0 : line.left(s1).toDouble(&ok);
+        if (!ok || s2 < 0)
+            return fail(QStringLiteral("line %1: expected \"<unix time> <topic> <payload>\"").arg(m_lineNo));
+
+        const qint64 us = qint64(std::llround(seconds * 1e6));
+        if (m_firstStampUs < 0) m_firstStampUs = us;
+
+        const QString topic = QString::fromUtf8(line.mid(s1 + 1, s2 - s1 - 1));
+        auto it = m_textTopics.constFind(topic);
+        if (it == m_textTopics.constEnd())
+            it = m_textTopics.insert(topic, topic);
+
+        record->atUs    = us - m_firstStampUs;
+        record->topic   = *it;
+        record->payload = line.mid(s2 + 1);
+        return true;
+    }
+    return false;
+}
+
+bool MqttCaptureReader::readHeader()
+{
+    const QByteArray header = m_file.read(kHeaderBytes);
+    if (header.size() < kHeaderBytes || !header.startsWith(QByteArray(kMagic, sizeof(kMagic))))
+        return fail(QStringLiteral("not a capture file"));
+    if (quint8(header.at(4)) != kVersion)
+        return fail(QStringLiteral("unsupported capture version %1").arg(quint8(header.at(4))));
+
+    // Sessions are laid out by their wall-clock start, never overlapping
+    const qint64 startMs = qFromLittleEndian<qint64>(header.constData() + 8);
+    if (m_firstStartMs < 0) m_firstStartMs = startMs;
+    m_sessionBaseUs = qMax(m_lastUs, (startMs - m_firstStartMs) * 1000);
+    m_sessionUs = 0;
+    m_topics.clear();
+    return true;
+}
+
+bool MqttCaptureReader::readBlock()
+{
+    for (;;) {
+        const QByteArray peek = m_file.peek(sizeof(kMagic));
+        if (peek.size() < qsizetype(sizeof(kMagic)))
+            return false;   // clean end (or a torn size word)
+        if (peek == QByteArray(kMagic, sizeof(kMagic))) {
+            if (!readHeader()) return false;
+            continue;
+        }
+
+        const qint64 at = m_file.pos();
+        char size[4];
+        m_file.read(size, sizeof(size));
+        const quint32 tag = qFromLittleEndian<quint32>(size);
+        const quint32 bytes = tag & ~kBlockCompressed;
+        if (bytes >= kMaxBlockBytes)
+            return fail(QStringLiteral("corrupt block at offset %1").arg(at));
+
+        QByteArray data = m_file.read(bytes);
+        if (data.size() < qsizetype(bytes)) {
+            qWarning() << "⚠️ capture: ignoring torn block at the end of" << m_file.fileName();
+            return false;
+        }
+        if (tag & kBlockCompressed) {
+            data = qUncompress(data);
+            if (data.isEmpty())
+                return fail(QStringLiteral("corrupt compressed block at offset %1").arg(at));
+        }
+        m_block = data;
+        m_blockPos = 0;
+        return true;
+    }
+}
+
+bool MqttCaptureReader::nextBinary(MqttCaptureRecord *record)
+{
+    if (m_blockPos >= m_block.size() && !readBlock())
+        return false;
+
+    auto corrupt = [this]() { return fail(QStringLiteral("corrupt record in %1").arg(m_file.fileName())); };
+
+    quint64 deltaUs = 0, topicId = 0, length = 0;
+    if (!getVarint(m_block, m_blockPos, &deltaUs) || !getVarint(m_block, m_blockPos, &topicId))
+        return corrupt();
+
+    if (topicId == 0) {
+        if (!getVarint(m_block, m_blockPos, &length) || length > quint64(m_block.size() - m_blockPos))
+            return corrupt();
+        m_topics.append(QString::fromUtf8(m_block.constData() + m_blockPos, qsizetype(length)));
+        m_blockPos += qsizetype(length);
+        topicId = quint64(m_topics.size());
+    } else if (topicId > quint64(m_topics.size())) {
+        return corrupt();
+    }
+
+    if (!getVarint(m_block, m_blockPos, &length) || length > quint64(m_block.size() - m_blockPos))
+        return corrupt();
+
+    m_sessionUs += qint64(deltaUs);
+    record->atUs    = m_sessionBaseUs + m_sessionUs;
+    record->topic   = m_topics.at(qsizetype(topicId - 1));
+    record->payload = m_block.mid(m_blockPos, qsizetype(length));
+    m_blockPos += qsizetype(length);
+    return true;
+}
@@ -0,0 +1,118 @@
+#pragma once
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Recorded MQTT traffic for replay (MqttReplay, mqttrain-bench).
+//
+// A capture file is a sequence of sessions, one per MqttCaptureWriter
+// open(); an existing file is appended to, never rewritten. All integers
+// are little-endian:
+//
+//   header   "MQRC"  u8 version  u8 flags  u16 0  i64 start (ms since epoch)
+//   block    u32 size (bit 31: zlib via qCompress)  then size bytes
+//   block    ...
+//
+// A block holds whole records, each
+//
+//   varint   µs since the previous record of the session
+//   varint   topic id; 0 introduces a new topic (varint length + UTF-8)
+//            which takes the next id, starting at 1
+//   varint   payload length, then the payload bytes
+//
+// so a topic is spelled out once per session and costs one or two bytes
+// per message afterwards. Blocks are written whole, at most once a second
+// or every 64 KiB: a crash loses the block being filled; a torn block at
+// the end of the file is ignored on reading and cut off by the next
+// open() before it appends a session. Blocks are capped at
+// 1 GiB, which keeps the magic of a following session distinguishable
+// from a block size.
+namespace MqttCapture {
+// Accepts file:// URLs and a leading "~/"
+QString localPath(const QString &pathOrUrl);
+}
+
+// Appends one capture session. Not thread-safe; MqttConnection drives it
+// on the connection thread.
+class MqttCaptureWriter
+{
+public:
+    MqttCaptureWriter();
+    ~MqttCaptureWriter();
+
+    bool open(const QString &path, bool compress, QString *error);
+    void close();
+    bool isOpen() const { return m_file.isOpen(); }
+    QString fileName() const { return m_file.fileName(); }
+
+    void append(const QString &topic, const QByteArray &payload);
+    // Writes the pending block, if any
+    void flush();
+
+    quint64 messages() const { return m_messages; }
+
+private:
+    QFile                   m_file;
+    QHash<QString, quint32> m_topicIds;
+    QByteArray              m_block;
+    QElapsedTimer           m_clock;
+    qint64                  m_lastUs;
+    bool                    m_compress;
+    quint64                 m_messages;
+};
+
+struct MqttCaptureRecord
+{
+    qint64     atUs = 0;   // since the first record of the file
+    QString    topic;      // shared between records of the same topic
+    QByteArray payload;
+};
+
+// Reads a capture file record by record. Also accepts the text form
+// written by
+//   mosquitto_sub -v -F '%U %t %p' -t '#'
+// one "<unix seconds[.fraction]> <topic> <payload>" per line, so existing
+// recordings keep working. Timestamps never go backwards: out-of-order
+// stamps and session gaps in the past are played at once.
+class MqttCaptureReader
+{
+public:
+    MqttCaptureReader();
+
+    bool open(const QString &path, QString *error);
+    void close();
+    // Back to the first record
+    bool rewind();
+    bool isBinary() const { return m_binary; }
+
+    // false at the end of the file or on a malformed record; errorString()
+    // tells which
+    bool next(MqttCaptureRecord *record);
+    QString errorString() const { return m_error; }
+
+private:
+    bool nextText(MqttCaptureRecord *record);
+    bool nextBinary(MqttCaptureRecord *record);
+    bool readHeader();
+    bool readBlock();
+    bool fail(const QString &error);
+
+    QFile          m_file;
+    bool           m_binary;
+    QString        m_error;
+    qint64         m_lineNo;
+    qint64         m_lastUs;      // of the previous record
+    // Binary sessions
+    QList<QString> m_topics;      // by id - 1, current session
+    QByteArray     m_block;
+    qsizetype      m_blockPos;
+    qint64         m_sessionUs;   // current session clock
+    qint64         m_sessionBaseUs;
+    qint64         m_firstStartMs;
+    // Text lines
+    qint64         m_firstStampUs;
+    QHash<QString, QString> m_textTopics;   // interned
+};
@@ -1,54 +1,167 @@
 #include "mqttclient.h"
+#include "mqttconnection.h"
+#include "memoryledger.h"
+#include "mqttconnectionpool.h"
 #include <QDebug>
-#include <QTcpSocket>
-#include <QTimer>
+#include <QSet>
+#include <algorithm>
+
+namespace {
+// Distinct topics remembered while suspended; messages on further topics
+// are counted as dropped
+constexpr qsizetype kMaxHeldTopics = 4096;
+// The snapshot on disk lags what is shown by at most this much
+constexpr int kSnapshotSaveMs = 10000;
+}
 
 MQTTClient::MQTTClient(QObject *parent)
     : QObject(parent)
-    , m_client(new QMqttClient(this))
-    , m_subscription(nullptr)
+    , m_ingestStats(new MqttIngestStats)
+    , m_subscriber(new MqttSubscriber(m_ingestStats, this))
+    , m_thread(nullptr)
+    , m_batchTimer(new QTimer(this))
+    , m_hitsTimer(new QTimer(this))
     , m_port(1883)
-    , m_connackTimer(new QTimer(this))
-    , m_reconnectTimer(new QTimer(this))
-    , m_socket(nullptr)
+    , m_transport(Tcp)
+    , m_path(QStringLiteral("/"))
+    , m_persistentSession(true)
+    , m_filterHitsTotal(0)
     , m_reconnectInterval(30000)
+    , m_workerThread(true)
+    , m_sharedConnection(true)
+    , m_connected(false)
     , m_shouldBeConnected(false)
+    , m_maxBatchSize(32)
+    , m_dropPolicy(KeepNewestPerTopic)
+    , m_droppedMessages(0)
+    , m_coalesce(false)
+    , m_coalescedMessages(0)
+    , m_maxDisplayLength(1024)
+    , m_maxPayloadBytes(0)
+    , m_oversizedMessages(0)
+    , m_discovery(false)
+    , m_discoveryPrefix(QStringLiteral("homeassistant"))
+    , m_discoveredEntities(0)
+    , m_captureCompressed(true)
+    , m_snapshotTimer(new QTimer(this))
+    , m_suspended(false)
+    , m_heldSeq(0)
+    , m_heldBytes(0)
 {
-    connect(m_client, &QMqttClient::connected,    this, &MQTTClient::onConnected);
-    connect(m_client, &QMqttClient::disconnected, this, &MQTTClient::onDisconnected);
-    connect(m_client, &QMqttClient::errorChanged, this, &MQTTClient::onErrorChanged);
-    connect(m_client, &QMqttClient::stateChanged, this, [](QMqttClient::ClientState s) {
-        qDebug() << "📊 MQTT state:" << s;
-    });
+    m_batchTimer->setSingleShot(true);
+    m_batchTimer->setInterval(20);
+    connect(m_batchTimer, &QTimer::timeout, this, &MQTTClient::flushBatch);
 
-    m_connackTimer->setSingleShot(true);
-    m_connackTimer->setInterval(5000);
-    connect(m_connackTimer, &QTimer::timeout, this, [this]() {
-        qWarning() << "⏰ CONNACK timeout!";
-        emit connectionError("CONNACK timeout");
-        // Preserve reconnect intent: disconnectFromHost() sets m_shouldBeConnected=false,
-        // so we save and restore the flag to keep reconnection scheduled.
-        bool wasConnecting = m_shouldBeConnected;
-        disconnectFromHost();
-        if (wasConnecting) {
-            m_shouldBeConnected = true;
-            qDebug() << "🔄 CONNACK timeout, scheduling reconnection in" << m_reconnectInterval << "ms...";
-            emit reconnecting();
-            m_reconnectTimer->start();
-        }
-    });
+    // Filtered messages never reach the GUI thread, so hit counters are polled
+    m_hitsTimer->setInterval(1000);
+    connect(m_hitsTimer, &QTimer::timeout, this, &MQTTClient::refreshFilterHits);
 
-    // Configurazione timer di riconnessione
-    m_reconnectTimer->setSingleShot(true);
-    m_reconnectTimer->setInterval(m_reconnectInterval);
-    connect(m_reconnectTimer, &QTimer::timeout, this, &MQTTClient::attemptReconnect);
+    m_snapshotTimer->setSingleShot(true);
+    m_snapshotTimer->setInterval(kSnapshotSaveMs);
+    connect(m_snapshotTimer, &QTimer::timeout, this, [this]() { m_snapshot.save(); });
 
     qDebug() << "MQTTClient initialized, Qt:" << qVersion();
 }
 
 MQTTClient::~MQTTClient()
 {
-    disconnectFromHost();
+    destroyConnection();
+    MemoryLedger::instance().credit(m_heldBytes);
+}
+
+template <typename F>
+void MQTTClient::post(F &&f)
+{
+    if (m_connection)
+        QMetaObject::invokeMethod(m_connection, std::forward<F>(f));
+}
+
+void MQTTClient::createConnection(const QString &poolKey)
+{
+    MqttConnection *conn;
+    if (!poolKey.isEmpty()) {
+        conn = MqttConnectionPool::instance().acquire(poolKey);
+    } else {
+        conn = new MqttConnection;
+        if (m_workerThread) {
+            m_thread = new QThread(this);
+            m_thread->setObjectName(QStringLiteral("MQTTRain-io"));
+            conn->moveToThread(m_thread);
+            m_thread->start();
+        }
+    }
+    m_connection = conn;
+    m_poolKey = poolKey;
+
+    MqttSubscriber *sub = m_subscriber;
+    connect(sub, &MqttSubscriber::connectedChanged,  this, &MQTTClient::onConnectionStateChanged, Qt::QueuedConnection);
+    connect(sub, &MqttSubscriber::reconnecting,      this, &MQTTClient::reconnecting,             Qt::QueuedConnection);
+    connect(sub, &MqttSubscriber::connectionError,   this, &MQTTClient::connectionError,          Qt::QueuedConnection);
+    connect(sub, &MqttSubscriber::messagesAvailable, this, &MQTTClient::scheduleFlush,            Qt::QueuedConnection);
+    connect(sub, &MqttSubscriber::discoveredEntitiesChanged, this, &MQTTClient::onDiscoveredEntitiesChanged, Qt::QueuedConnection);
+
+    const int interval = m_reconnectInterval;
+    const QList<MqttTopicSpec> topics = m_topicSpecs;
+    const TopicFilterPtr filter = m_filter;
+    const PayloadExtractorPtr extractor = m_extractor;
+    const bool discovery = m_discovery;
+    const QString prefix = m_discoveryPrefix;
+    const bool coalesce = m_coalesce;
+    const int displayLength = m_maxDisplayLength;
+    const int maxBytes = m_maxPayloadBytes;
+    const QString capturePath = m_captureFile;
+    const bool captureCompressed = m_captureCompressed;
+    post([conn, sub, interval, topics, filter, extractor, discovery, prefix, coalesce, displayLength, maxBytes,
+          capturePath, captureCompressed]() {
+        // Filtering and limits first: attaching may deliver cached values
+        sub->setFilter(filter);
+        sub->setExtractor(extractor);
+        sub->setCoalesce(coalesce);
+        sub->setPayloadLimits(displayLength, maxBytes);
+        conn->setDiscovery(discovery, prefix);
+        conn->attach(sub);
+        conn->setTopics(sub, topics);
+        conn->setReconnectInterval(sub, interval);
+        conn->setCapture(sub, capturePath, captureCompressed);
+    });
+
+    qDebug() << "MQTT connection" << (m_poolKey.isEmpty() ? "private" : "shared") << "on"
+             << (m_poolKey.isEmpty() && !m_thread ? "GUI thread" : "worker thread");
+}
+
+void MQTTClient::destroyConnection()
+{
+    MqttConnection *conn = m_connection;
+    if (!conn) return;
+
+    disconnect(m_subscriber, nullptr, this, nullptr);
+    m_connection = nullptr;
+    m_batchTimer->stop();   // whatever is still queued goes with the connection
+
+    if (!m_poolKey.isEmpty()) {
+        // Others may stay on it: detach before returning so nothing more is
+        // pushed for us, then drop our reference
+        MqttSubscriber *sub = m_subscriber;
+        QMetaObject::invokeMethod(conn, [conn, sub]() { conn->detach(sub); }, Qt::BlockingQueuedConnection);
+        MqttConnectionPool::instance().release(conn);
+        m_poolKey.clear();
+    } else if (m_thread) {
+        // Tear down on the owning thread: QMqttClient and the socket are not
+        // thread-safe and their destructors send DISCONNECT.
+        QMetaObject::invokeMethod(conn, [conn]() { delete conn; }, Qt::BlockingQueuedConnection);
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    } else {
+        delete conn;
+    }
+    m_subscriber->clearInbound();
+
+    if (m_connected) {
+        m_connected = false;
+        emit connectedChanged();
+    }
 }
 
 void MQTTClient::setHost(const QString &host)
@@ -57,7 +170,6 @@ void MQTTClient::setHost(const QString &host)
     if (m_host != v) {
         qDebug() << "setHost:" << v;
         m_host = v;
-        m_client->setHostname(v);
         emit hostChanged();
     }
 }
@@ -67,18 +179,36 @@ void MQTTClient::setPort(int port)
     if (m_port != port) {
         qDebug() << "setPort:" << port;
         m_port = port;
-        m_client->setPort(static_cast<quint16>(port));
         emit portChanged();
     }
 }
 
+void MQTTClient::setTransport(Transport transport)
+{
+    if (m_transport != transport) {
+        qDebug() << "setTransport:" << transport;
+        m_transport = transport;
+        emit transportChanged();
+    }
+}
+
+void MQTTClient::setPath(const QString &path)
+{
+    QString v = path.trimmed();
+    if (!v.startsWith(u'/')) v.prepend(u'/');
+    if (m_path != v) {
+        qDebug() << "setPath:" << v;
+        m_path = v;
+        emit transportChanged();
+    }
+}
+
 void MQTTClient::setUsername(const QString &username)
 {
     QString v = username.trimmed();
     if (m_username != v) {
         qDebug() << "setUsername:" << v;
         m_username = v;
-        m_client->setUsername(v);
         emit usernameChanged();
     }
 }
@@ -87,20 +217,153 @@ void MQTTClient::setPassword(const QString &password)
 {
     if (m_password != password) {
         m_password = password;
-        m_client->setPassword(password);
         emit passwordChanged();
     }
 }
 
+void MQTTClient::setClientId(const QString &clientId)
+{
+    QString v = clientId.trimmed();
+    if (m_clientId != v) {
+        qDebug() << "setClientId:" << v;
+        m_clientId = v;
+        emit clientIdChanged();
+    }
+}
+
+void MQTTClient::setPersistentSession(bool persistent)
+{
+    if (m_persistentSession != persistent) {
+        qDebug() << "setPersistentSession:" << persistent;
+        m_persistentSession = persistent;
+        emit persistentSessionChanged();
+    }
+}
+
 void MQTTClient::setTopic(const QString &topic)
 {
-    QString v = topic.trimmed();
-    if (m_topic != v) {
-        qDebug() << "setTopic: [" << v << "]";
-        m_topic = v;
-        emit topicChanged();
-        updateSubscription();
+    setTopics(topic.split(u',', Qt::SkipEmptyParts));
+}
+
+void MQTTClient::setTopics(const QStringList &topics)
+{
+    QStringList entries;
+    QList<MqttTopicSpec> specs;
+
+    for (const QString &raw : topics) {
+        const QString entry = raw.trimmed();
+        if (entry.isEmpty()) continue;
+
+        MqttTopicSpec spec;
+        spec.filter = entry;
+        const qsizetype at = entry.lastIndexOf(u'@');
+        if (at > 0 && at == entry.size() - 2 && entry.back() >= u'0' && entry.back() <= u'2') {
+            spec.filter = entry.left(at).trimmed();
+            spec.qos    = quint8(entry.back().unicode() - u'0');
+        }
+
+        if (!TopicTrie::isValidFilter(spec.filter)) {
+            qWarning() << "⚠️ Ignoring malformed topic filter:" << entry;
+            continue;
+        }
+
+        // Same filter twice: the later entry wins
+        const auto dup = std::find_if(specs.begin(), specs.end(),
+                                      [&](const MqttTopicSpec &s) { return s.filter == spec.filter; });
+        if (dup != specs.end()) {
+            entries.removeAt(dup - specs.begin());
+            specs.erase(dup);
+        }
+        entries.append(spec.qos ? spec.filter + u'@' + QString::number(spec.qos) : spec.filter);
+        specs.append(spec);
     }
+
+    if (m_topics == entries) return;
+
+    qDebug() << "setTopics:" << entries;
+    m_topics = entries;
+    m_topicSpecs = specs;
+    emit topicChanged();
+
+    MqttConnection *conn = m_connection;
+    MqttSubscriber *sub = m_subscriber;
+    post([conn, sub, specs]() { conn->setTopics(sub, specs); });
+}
+
+void MQTTClient::setBlacklist(const QString &blacklist)
+{
+    QString v = blacklist.trimmed();
+    if (m_blacklist != v) {
+        qDebug() << "setBlacklist: [" << v << "]";
+        m_blacklist = v;
+        emit blacklistChanged();
+        rebuildFilter();
+    }
+}
+
+void MQTTClient::setWhitelist(const QString &whitelist)
+{
+    QString v = whitelist.trimmed();
+    if (m_whitelist != v) {
+        qDebug() << "setWhitelist: [" << v << "]";
+        m_whitelist = v;
+        emit whitelistChanged();
+        rebuildFilter();
+    }
+}
+
+void MQTTClient::rebuildFilter()
+{
+    const QStringList white = TopicFilter::parseList(m_whitelist);
+    const QStringList black = TopicFilter::parseList(m_blacklist);
+
+    // Counters restart with the new rule set
+    if (white.isEmpty() && black.isEmpty()) {
+        m_filter.reset();
+        m_hitsTimer->stop();
+    } else {
+        m_filter = TopicFilterPtr(new TopicFilter(white, black));
+        m_hitsTimer->start();
+    }
+    m_filterHitsTotal = 0;
+    m_filterHits = m_filter ? m_filter->hitsSnapshot() : QVariantList();
+    emit filterHitsChanged();
+
+    MqttSubscriber *sub = m_subscriber;
+    const TopicFilterPtr filter = m_filter;
+    post([sub, filter]() { sub->setFilter(filter); });
+}
+
+void MQTTClient::setExtractors(const QString &rules)
+{
+    const QString v = rules.trimmed();
+    if (m_extractors == v) return;
+    m_extractors = v;
+
+    if (v.isEmpty()) {
+        m_extractor.reset();
+    } else {
+        m_extractor = PayloadExtractorPtr(new PayloadExtractor(v));
+        qDebug() << "🧩 Payload extractors:" << m_extractor->ruleCount() << "rule(s)";
+        if (m_extractor->isEmpty()) m_extractor.reset();
+    }
+    emit extractorsChanged();
+
+    MqttSubscriber *sub = m_subscriber;
+    const PayloadExtractorPtr extractor = m_extractor;
+    post([sub, extractor]() { sub->setExtractor(extractor); });
+}
+
+void MQTTClient::refreshFilterHits()
+{
+    if (!m_filter) return;
+
+    const quint64 total = m_filter->totalHits();
+    if (total == m_filterHitsTotal) return;
+
+    m_filterHitsTotal = total;
+    m_filterHits = m_filter->hitsSnapshot();
+    emit filterHitsChanged();
 }
 
 void MQTTClient::setReconnectInterval(int interval)
@@ -108,172 +371,495 @@ void MQTTClient::setReconnectInterval(int interval)
     if (m_reconnectInterval != interval) {
         qDebug() << "setReconnectInterval:" << interval << "ms";
         m_reconnectInterval = interval;
-        m_reconnectTimer->setInterval(interval);
         emit reconnectIntervalChanged();
+        MqttConnection *conn = m_connection;
+        MqttSubscriber *sub = m_subscriber;
+        post([conn, sub, interval]() { conn->setReconnectInterval(sub, interval); });
     }
 }
 
-bool MQTTClient::connected() const
+void MQTTClient::setWorkerThread(bool enabled)
 {
-    return m_client->state() == QMqttClient::Connected;
+    if (m_workerThread == enabled) return;
+
+    qDebug() << "setWorkerThread:" << enabled;
+    m_workerThread = enabled;
+    emit workerThreadChanged();
+
+    // Rebuild the connection on the requested thread, keeping the intent
+    destroyConnection();
+    if (m_shouldBeConnected) connectToHost();
 }
 
-void MQTTClient::connectToHost()
+void MQTTClient::setSharedConnection(bool enabled)
 {
-    if (m_host.isEmpty()) {
-        qWarning() << "Cannot connect: host is empty";
-        emit connectionError("Host is empty");
+    if (m_sharedConnection == enabled) return;
+
+    qDebug() << "setSharedConnection:" << enabled;
+    m_sharedConnection = enabled;
+    emit sharedConnectionChanged();
+
+    destroyConnection();
+    if (m_shouldBeConnected) connectToHost();
+}
+
+void MQTTClient::setDiscovery(bool enabled)
+{
+    if (m_discovery == enabled) return;
+
+    qDebug() << "setDiscovery:" << enabled;
+    m_discovery = enabled;
+    emit discoveryChanged();
+    applyDiscovery();
+}
+
+void MQTTClient::setDiscoveryPrefix(const QString &prefix)
+{
+    QString v = prefix.trimmed();
+    while (v.endsWith(u'/')) v.chop(1);
+    if (v.isEmpty()) v = QStringLiteral("homeassistant");
+    if (m_discoveryPrefix == v) return;
+
+    qDebug() << "setDiscoveryPrefix:" << v;
+    m_discoveryPrefix = v;
+    emit discoveryChanged();
+    applyDiscovery();
+}
+
+void MQTTClient::applyDiscovery()
+{
+    // Discovery is part of the pool key: move to the matching connection
+    if (!m_poolKey.isEmpty()) {
+        if (m_shouldBeConnected) connectToHost();
         return;
     }
 
-    m_shouldBeConnected = true;
-    m_reconnectTimer->stop();
+    MqttConnection *conn = m_connection;
+    const bool discovery = m_discovery;
+    const QString prefix = m_discoveryPrefix;
+    post([conn, discovery, prefix]() { conn->setDiscovery(discovery, prefix); });
+}
 
-    qDebug() << "==== connectToHost ==== host:" << m_host << "port:" << m_port << "user:" << m_username;
+void MQTTClient::onDiscoveredEntitiesChanged(int count)
+{
+    if (m_discoveredEntities != count) {
+        m_discoveredEntities = count;
+        emit discoveredEntitiesChanged();
+    }
+}
 
-    if (m_socket) {
-        m_socket->disconnect();
-        m_socket->abort();
-        m_socket->deleteLater();
-        m_socket = nullptr;
+void MQTTClient::setBatchInterval(int interval)
+{
+    interval = qMax(0, interval);
+    if (m_batchTimer->interval() != interval) {
+        qDebug() << "setBatchInterval:" << interval << "ms";
+        m_batchTimer->setInterval(interval);
+        emit batchIntervalChanged();
     }
+}
 
-    m_socket = new QTcpSocket(this);
+void MQTTClient::setMaxBatchSize(int size)
+{
+    size = qMax(1, size);
+    if (m_maxBatchSize != size) {
+        qDebug() << "setMaxBatchSize:" << size;
+        m_maxBatchSize = size;
+        emit maxBatchSizeChanged();
+    }
+}
 
-    connect(m_socket, &QTcpSocket::stateChanged, [](QAbstractSocket::SocketState s) {
-        qDebug() << "🔄 TCP:" << s;
-    });
-    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::errorOccurred),
-            this, [this](QAbstractSocket::SocketError e) {
-        qWarning() << "🔴 TCP error:" << e << m_socket->errorString();
-        emit connectionError("TCP: " + m_socket->errorString());
-    });
+void MQTTClient::setDropPolicy(DropPolicy policy)
+{
+    if (m_dropPolicy != policy) {
+        qDebug() << "setDropPolicy:" << policy;
+        m_dropPolicy = policy;
+        emit dropPolicyChanged();
+    }
+}
 
-    // Once TCP connects, attach as IODevice and send MQTT CONNECT
-    connect(m_socket, &QTcpSocket::connected, this, [this]() {
-        qDebug() << "✅ TCP connected — attaching IODevice transport";
-        m_client->setHostname(m_host);
-        m_client->setPort(static_cast<quint16>(m_port));
-        m_client->setUsername(m_username);
-        m_client->setPassword(m_password);
-        m_client->setTransport(m_socket, QMqttClient::IODevice);
-        m_connackTimer->start();
-        m_client->connectToHost();
-        qDebug() << "  MQTT state:" << m_client->state();
-    });
+void MQTTClient::setSuspended(bool suspended)
+{
+    if (m_suspended == suspended) return;
+
+    qDebug() << "setSuspended:" << suspended;
+    m_suspended = suspended;
+    emit suspendedChanged();
+    if (suspended) return;
+
+    // Latest value per topic, newest topics first in line for the cap
+    QList<HeldMessage> held;
+    held.reserve(m_held.size());
+    for (auto it = m_held.begin(); it != m_held.end(); ++it)
+        held.append(std::move(it.value()));
+    m_held.clear();
+    MemoryLedger::instance().credit(m_heldBytes);
+    m_heldBytes = 0;
+    std::sort(held.begin(), held.end(),
+              [](const HeldMessage &a, const HeldMessage &b) { return a.seq < b.seq; });
+
+    QList<MqttInbound> batch;
+    const qsizetype first = qMax<qsizetype>(0, held.size() - m_maxBatchSize);
+    batch.reserve(held.size() - first);
+    for (qsizetype i = first; i < held.size(); ++i)
+        batch.append(std::move(held[i].message));
+
+    qDebug() << "▶️ Resuming with" << batch.size() << "of" << held.size() << "held topics";
+    emitBatch(batch);
+}
+
+void MQTTClient::hold(QList<MqttInbound> &incoming)
+{
+    MemoryLedger &ledger = MemoryLedger::instance();
+    qint64 dropped = 0;
+    for (MqttInbound &m : incoming) {
+        const qint64 bytes = m.footprint();
+        auto it = m_held.find(m.topic);
+        if (it == m_held.end()) {
+            if (m_held.size() >= kMaxHeldTopics || !ledger.tryCharge(bytes)) { ++dropped; continue; }
+            m_heldBytes += bytes;
+            const QString topic = m.topic;
+            m_held.insert(topic, HeldMessage { std::move(m), ++m_heldSeq });
+        } else {
+            // Replacing a topic's message never grows the count
+            ledger.credit(it->message.footprint());
+            ledger.charge(bytes);
+            m_heldBytes += bytes - it->message.footprint();
+            it->message = std::move(m);
+            it->seq = ++m_heldSeq;
+        }
+    }
 
-    qDebug() << "  Connecting TCP...";
-    m_socket->connectToHost(m_host, static_cast<quint16>(m_port));
+    countShed(dropped, 0);
 }
 
-void MQTTClient::disconnectFromHost()
+void MQTTClient::setCoalesceByTopic(bool enabled)
 {
-    m_shouldBeConnected = false;
-    m_reconnectTimer->stop();
-    m_connackTimer->stop();
+    if (m_coalesce == enabled) return;
 
-    if (m_subscription) {
-        m_subscription->unsubscribe();
-        m_subscription = nullptr;
-    }
-    m_client->disconnectFromHost();
-    if (m_socket)
-        m_socket->abort();
+    qDebug() << "setCoalesceByTopic:" << enabled;
+    m_coalesce = enabled;
+    emit coalesceByTopicChanged();
+    MqttSubscriber *sub = m_subscriber;
+    post([sub, enabled]() { sub->setCoalesce(enabled); });
 }
 
-void MQTTClient::onConnected()
+void MQTTClient::setMaxDisplayLength(int length)
 {
-    m_connackTimer->stop();
-    qDebug() << "🎉 MQTT connected!";
-    emit connectedChanged();
-    updateSubscription();
+    length = qMax(1, length);
+    if (m_maxDisplayLength == length) return;
+
+    qDebug() << "setMaxDisplayLength:" << length;
+    m_maxDisplayLength = length;
+    emit payloadLimitsChanged();
+    applyPayloadLimits();
+}
+
+void MQTTClient::setMaxPayloadBytes(int bytes)
+{
+    bytes = qMax(0, bytes);
+    if (m_maxPayloadBytes == bytes) return;
+
+    qDebug() << "setMaxPayloadBytes:" << bytes;
+    m_maxPayloadBytes = bytes;
+    emit payloadLimitsChanged();
+    applyPayloadLimits();
+}
+
+void MQTTClient::applyPayloadLimits()
+{
+    MqttSubscriber *sub = m_subscriber;
+    const int displayLength = m_maxDisplayLength;
+    const int maxBytes = m_maxPayloadBytes;
+    post([sub, displayLength, maxBytes]() { sub->setPayloadLimits(displayLength, maxBytes); });
+}
+
+void MQTTClient::setCaptureFile(const QString &path)
+{
+    const QString v = MqttCapture::localPath(path);
+    if (m_captureFile == v) return;
+
+    qDebug() << "setCaptureFile:" << v;
+    m_captureFile = v;
+    emit captureChanged();
+    applyCapture();
+}
+
+void MQTTClient::setCaptureCompressed(bool compressed)
+{
+    if (m_captureCompressed == compressed) return;
+
+    qDebug() << "setCaptureCompressed:" << compressed;
+    m_captureCompressed = compressed;
+    emit captureChanged();
+    if (!m_captureFile.isEmpty()) applyCapture();
+}
+
+void MQTTClient::applyCapture()
+{
+    MqttConnection *conn = m_connection;
+    MqttSubscriber *sub = m_subscriber;
+    const QString path = m_captureFile;
+    const bool compress = m_captureCompressed;
+    post([conn, sub, path, compress]() { conn->setCapture(sub, path, compress); });
+}
+
+void MQTTClient::setSnapshotSize(int size)
+{
+    size = qMax(0, size);
+    if (m_snapshot.capacity() == size) return;
+
+    qDebug() << "setSnapshotSize:" << size;
+    m_snapshot.setCapacity(size);
+    emit snapshotSizeChanged();
 }
 
-void MQTTClient::onDisconnected()
+qint64 MQTTClient::memoryCap() const
 {
-    m_connackTimer->stop();
-    qDebug() << "❌ MQTT disconnected";
+    return MemoryLedger::instance().cap();
+}
 
-    if (m_subscription)
-        m_subscription = nullptr;
+void MQTTClient::setMemoryCap(qint64 bytes)
+{
+    bytes = qMax<qint64>(0, bytes);
+    if (memoryCap() == bytes) return;
 
-    emit connectedChanged();
+    qDebug() << "setMemoryCap:" << bytes;
+    MemoryLedger::instance().setCap(bytes);
+    emit memoryCapChanged();
+}
 
-    // Avvia tentativi di riconnessione se necessario
-    if (m_shouldBeConnected) {
-        qDebug() << "🔄 Scheduling reconnection attempt in" << m_reconnectInterval << "ms...";
-        emit reconnecting();
-        m_reconnectTimer->start();
+void MQTTClient::restoreSnapshot()
+{
+    // One snapshot per broker and topic list: other topics are not wanted now
+    const QString key = m_host.toLower() + u':' + QString::number(m_port) + u'|' + m_topics.join(u',');
+    if (m_snapshot.key() == key) return;
+    m_snapshot.load(key);
+
+    QList<MqttInbound> restored;
+    for (const MqttInbound &m : m_snapshot.messages()) {
+        if (!m_filter || m_filter->accepts(m.topic))
+            restored.append(m);
     }
+    if (restored.isEmpty()) return;
+
+    qDebug() << "♻️ Restoring" << restored.size() << "message(s) from the last session";
+    emit messagesRestored(toVariantList(restored));
 }
 
-void MQTTClient::onMessageReceived(const QMqttMessage &message)
+QVariantList MQTTClient::recentMessages() const
 {
-    emit messageReceived(message.topic().name(),
-                         QString::fromUtf8(message.payload()));
+    return toVariantList(m_snapshot.messages());
 }
 
-void MQTTClient::onErrorChanged(QMqttClient::ClientError error)
+void MQTTClient::countShed(qint64 dropped, qint64 coalesced)
 {
-    if (error == QMqttClient::NoError) return;
+    dropped   += qint64(m_subscriber->takeOverflowed());
+    coalesced += qint64(m_subscriber->takeDuplicates());
+    const qint64 oversized = qint64(m_subscriber->takeOversized());
+
+    if (oversized > 0) {
+        m_oversizedMessages += oversized;
+        emit oversizedMessagesChanged();
+    }
+    if (dropped > 0) {
+        m_droppedMessages += dropped;
+        emit droppedMessagesChanged();
+    }
+    if (coalesced > 0) {
+        m_coalescedMessages += coalesced;
+        emit coalescedMessagesChanged();
+    }
+}
 
-    static const QMap<QMqttClient::ClientError, QString> errors = {
-        { QMqttClient::InvalidProtocolVersion, "Invalid protocol version" },
-        { QMqttClient::IdRejected,             "Client ID rejected" },
-        { QMqttClient::ServerUnavailable,      "Server unavailable" },
-        { QMqttClient::BadUsernameOrPassword,  "Bad username or password" },
-        { QMqttClient::NotAuthorized,          "Not authorized" },
-        { QMqttClient::TransportInvalid,       "Transport invalid" },
-        { QMqttClient::ProtocolViolation,      "Protocol violation" },
+QVariantMap MQTTClient::ingestStats() const
+{
+    const MqttIngestStats &s = *m_ingestStats;
+    auto load = [](const std::atomic<quint64> &v) { return qint64(v.load(std::memory_order_relaxed)); };
+    return QVariantMap {
+        { QStringLiteral("received"),   load(s.received) },
+        { QStringLiteral("filtered"),   load(s.filtered) },
+        { QStringLiteral("dropped"),    m_droppedMessages + m_oversizedMessages },
+        { QStringLiteral("coalesced"),  m_coalescedMessages },
+        { QStringLiteral("bytes"),      load(s.bytes) },
+        { QStringLiteral("tokenized"),  load(s.tokenized) },
+        { QStringLiteral("tokenizeNs"), load(s.tokenizeNs) },
+        { QStringLiteral("extracted"),  load(s.extracted) },
+        { QStringLiteral("reconnects"), load(s.reconnects) },
+        { QStringLiteral("connackMs"),  s.connackMs.load(std::memory_order_relaxed) },
+        { QStringLiteral("memoryBytes"), MemoryLedger::instance().bytes() },
+        { QStringLiteral("memoryPeak"),  MemoryLedger::instance().peak() },
+        { QStringLiteral("memoryCap"),   MemoryLedger::instance().cap() },
     };
+}
 
-    QString msg = errors.value(error, "Unknown error");
-    qWarning() << "⚠️ MQTT Error:" << msg;
-    emit connectionError(msg);
+void MQTTClient::connectToHost()
+{
+    if (m_host.isEmpty()) {
+        qWarning() << "Cannot connect: host is empty";
+        emit connectionError("Host is empty");
+        return;
+    }
+
+    m_shouldBeConnected = true;
 
-    // Avvia riconnessione per errori non legati a credenziali
-    if (m_shouldBeConnected &&
-        error != QMqttClient::BadUsernameOrPassword &&
-        error != QMqttClient::NotAuthorized) {
-        qDebug() << "🔄 Error detected, scheduling reconnection attempt in" << m_reconnectInterval << "ms...";
-        emit reconnecting();
-        m_reconnectTimer->start();
+    MqttConnectionSettings settings;
+    settings.host     = m_host;
+    settings.port     = m_port;
+    settings.transport = MqttConnectionSettings::Transport(m_transport);
+    settings.path     = m_path;
+    settings.username = m_username;
+    settings.password = m_password;
+    settings.persistentSession = m_persistentSession;
+
+    if (m_snapshot.capacity() > 0) restoreSnapshot();
+
+    // Shared connections are keyed by broker and discovery; another key
+    // (or a private connection wanted) means another connection
+    const QString poolKey = m_sharedConnection && m_workerThread
+        ? MqttConnectionPool::key(settings, m_discovery, m_discoveryPrefix) : QString();
+    settings.clientId = poolKey.isEmpty()
+        ? m_clientId : MqttConnectionPool::sharedClientId(settings, m_discovery, m_discoveryPrefix);
+    if (!m_connection || poolKey != m_poolKey) {
+        destroyConnection();
+        createConnection(poolKey);
     }
+
+    MqttConnection *conn = m_connection;
+    post([conn, settings]() { conn->connectToHost(settings); });
 }
 
-void MQTTClient::attemptReconnect()
+void MQTTClient::disconnectFromHost()
 {
-    if (!m_shouldBeConnected) {
-        qDebug() << "⏸️ Reconnection canceled (shouldBeConnected=false)";
+    m_shouldBeConnected = false;
+    // A shared connection stays up for the other clients
+    if (!m_poolKey.isEmpty()) {
+        destroyConnection();
         return;
     }
+    MqttConnection *conn = m_connection;
+    post([conn]() { conn->disconnectFromHost(); });
+}
 
-    if (connected()) {
-        qDebug() << "✅ Already connected, skipping reconnection";
-        return;
+void MQTTClient::injectMessage(const QString &topic, const QByteArray &payload)
+{
+    // Replay runs without a broker: a private connection suffices
+    if (!m_connection) createConnection(QString());
+    MqttConnection *conn = m_connection;
+    MqttSubscriber *sub = m_subscriber;
+    post([conn, sub, topic, payload]() { conn->inject(sub, topic, payload); });
+}
+
+void MQTTClient::onConnectionStateChanged(bool connected)
+{
+    if (m_connected != connected) {
+        m_connected = connected;
+        emit connectedChanged();
     }
+}
 
-    qDebug() << "🔄 Attempting reconnection to" << m_host << ":" << m_port;
-    connectToHost();
+void MQTTClient::scheduleFlush()
+{
+    // First message of a batch opens the window; later ones just queue up
+    if (!m_batchTimer->isActive())
+        m_batchTimer->start();
 }
 
-void MQTTClient::updateSubscription()
+void MQTTClient::flushBatch()
 {
-    if (!connected() || m_topic.isEmpty()) return;
+    if (!m_connection) return;
+
+    // Re-arm first so a message pushed while draining schedules the next batch
+    m_subscriber->acknowledgeInbound();
+
+    SpscQueue<MqttInbound> &queue = m_subscriber->inbound();
+    QList<MqttInbound> incoming;
+    incoming.reserve(qsizetype(queue.size()));
+    MqttInbound item;
+    // Bounded so a fast producer cannot keep this loop spinning
+    for (size_t n = queue.capacity(); n > 0 && m_subscriber->pop(item); --n)
+        incoming.append(std::move(item));
+    if (queue.size() > 0)
+        scheduleFlush();   // leftovers go in the next window
+
+    if (m_suspended) {
+        hold(incoming);
+        return;
+    }
 
-    if (m_subscription) {
-        m_subscription->unsubscribe();
-        m_subscription = nullptr;
+    const qsizetype drained = incoming.size();
+
+    // Coalescing keeps only the newest message per topic, cap or not
+    qint64 coalesced = 0;
+    if (m_coalesce) {
+        QList<MqttInbound> newest;
+        newest.reserve(incoming.size());
+        QSet<QString> seenTopics;
+        for (qsizetype i = incoming.size() - 1; i >= 0; --i) {
+            if (seenTopics.contains(incoming[i].topic)) continue;
+            seenTopics.insert(incoming[i].topic);
+            newest.append(std::move(incoming[i]));
+        }
+        std::reverse(newest.begin(), newest.end());
+        coalesced = qint64(drained - newest.size());
+        incoming = std::move(newest);
     }
 
-    qDebug() << "📡 subscribing to:" << m_topic;
-    m_subscription = m_client->subscribe(m_topic, 0);
+    // Back-pressure only past the cap: superseded messages of a topic go
+    // first (oldest first) under KeepNewestPerTopic, then the oldest
+    if (incoming.size() > m_maxBatchSize) {
+        qsizetype excess = incoming.size() - m_maxBatchSize;
+        if (m_dropPolicy == KeepNewestPerTopic) {
+            QList<bool> superseded(incoming.size(), false);
+            QSet<QString> seenTopics;
+            for (qsizetype i = incoming.size() - 1; i >= 0; --i) {
+                superseded[i] = seenTopics.contains(incoming[i].topic);
+                seenTopics.insert(incoming[i].topic);
+            }
+            QList<MqttInbound> kept;
+            kept.reserve(qsizetype(m_maxBatchSize));
+            for (qsizetype i = 0; i < incoming.size(); ++i) {
+                if (excess > 0 && superseded[i]) {
+                    --excess;
+                    continue;
+                }
+                kept.append(std::move(incoming[i]));
+            }
+            incoming = std::move(kept);
+        }
+        if (incoming.size() > m_maxBatchSize)
+            incoming.remove(0, incoming.size() - m_maxBatchSize);
+    }
+    const QList<MqttInbound> &batch = incoming;
 
-    if (m_subscription) {
-        connect(m_subscription, &QMqttSubscription::messageReceived,
-                this, &MQTTClient::onMessageReceived);
-        qDebug() << "✅ subscribed";
-    } else {
-        qWarning() << "❌ subscribe failed:" << m_topic;
+    // Only what the cap shed counts as dropped; coalescing is counted apart
+    countShed(qint64(drained - batch.size()) - coalesced, coalesced);
+
+    emitBatch(batch);
+}
+
+void MQTTClient::emitBatch(const QList<MqttInbound> &batch)
+{
+    if (batch.isEmpty()) return;
+
+    if (m_snapshot.capacity() > 0) {
+        for (const MqttInbound &m : batch)
+            m_snapshot.record(m);
+        if (m_snapshot.isDirty() && !m_snapshotTimer->isActive())
+            m_snapshotTimer->start();
+    }
+    emit messagesReceived(toVariantList(batch));
+}
+
+QVariantList MQTTClient::toVariantList(const QList<MqttInbound> &batch)
+{
+    QVariantList messages;
+    messages.reserve(batch.size());
+    for (const MqttInbound &m : batch) {
+        messages.append(QVariantMap {
+            { QStringLiteral("topic"),   m.topic },
+            { QStringLiteral("payload"), QVariant::fromValue(m.payload) },
+            { QStringLiteral("display"), m.display.toVariant() },
+        });
     }
+    return messages;
 }
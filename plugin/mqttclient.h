@@ -1,75 +1,349 @@
 #pragma once
+#include <QHash>
 #include <QObject>
-#include <QMqttClient>
-#include <QMqttSubscription>
-#include <QTcpSocket>
+#include <QPointer>
+#include <QStringList>
+#include <QThread>
 #include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+#include "mqttconnection.h"
+#include "messagesnapshot.h"
+#include "mqttsubscriber.h"
+#include "topicfilter.h"
 
+// QML-facing MQTT client.
+//
+// Holds the configuration and exposes the signals main.qml listens to;
+// the transport and per-message work live in MqttConnection. With
+// workerThread enabled (default) the connection runs on a private
+// QThread, so socket reads, topic filtering, UTF-8 decoding and
+// tokenisation stay off the GUI/render thread; finished messages come
+// back through a lock-free queue.
+//
+// With sharedConnection as well (default), every MQTTClient on the same
+// broker, credentials and discovery settings shares one connection from
+// MqttConnectionPool on a common thread: one socket and one session
+// (under a client ID derived from machine, user and pool key) for all
+// screens. Topics, filters, limits and the queue stay per client. The
+// connection is only created by connectToHost() (or by injectMessage()
+// for a private one) and released by disconnectFromHost().
+//
+// Messages are not emitted one by one: the queue is drained at most once
+// per batchInterval (bound to the animation frame interval) and delivered
+// as a single messagesReceived(list). Under back-pressure the batch is
+// capped at maxBatchSize according to dropPolicy; everything shed here or
+// by a full queue is counted in droppedMessages.
+//
+// maxDisplayLength caps how much of each payload is decoded and
+// tokenised (the rest could never be shown); payloads over
+// maxPayloadBytes are skipped before decoding and counted in
+// oversizedMessages.
+//
+// extractors selects fields per topic filter (PayloadExtractor): on a
+// matching topic the display form is only those fields, built on the
+// connection thread, and JSON with none of them is dropped (counted as
+// filtered). The payload handle still carries the whole message.
+//
+// coalesceByTopic delivers only changed topics: within a batch only the
+// newest message per topic survives whatever the drop policy, and a
+// payload identical to the topic's previous one is dropped on the
+// connection thread before decoding. Both are counted in
+// coalescedMessages, not droppedMessages.
+//
+// discovery turns on Home Assistant MQTT discovery under discoveryPrefix:
+// config topics are consumed by the connection and the state topics they
+// announce are subscribed on top of topics.
+//
+// captureFile records the live traffic to a compact binary log (see
+// mqttcapture.h), appending a session when the file exists; MqttReplay
+// plays such a log back through injectMessage() without a broker.
+//
+// snapshotSize keeps the latest message of that many topics shown, on
+// disk per broker and topic list (MessageSnapshot). The first
+// connectToHost() to a broker emits them as messagesRestored() before
+// the connection is up; recentMessages() returns them at any time.
+//
+// While suspended (wallpaper not visible) nothing is emitted: the queue
+// keeps being drained, but only the latest message per topic is held.
+// Resuming emits those as one batch, newest maxBatchSize topics, so the
+// renderers start from current values instead of a replayed backlog.
+//
+// memoryCap bounds the process-wide MemoryLedger (every instance sets the
+// same one; the last value set wins): queued, held and shared-latest
+// messages are charged to it, and at the cap new ones are shed as drops.
+// ingestStats() reports the ledger's bytes, peak and cap.
 class MQTTClient : public QObject
 {
     Q_OBJECT
     Q_PROPERTY(QString host     READ host     WRITE setHost     NOTIFY hostChanged)
     Q_PROPERTY(int     port     READ port     WRITE setPort     NOTIFY portChanged)
+    Q_PROPERTY(Transport transport READ transport WRITE setTransport NOTIFY transportChanged)
+    Q_PROPERTY(QString path     READ path     WRITE setPath     NOTIFY transportChanged)
     Q_PROPERTY(QString username READ username WRITE setUsername NOTIFY usernameChanged)
     Q_PROPERTY(QString password READ password WRITE setPassword NOTIFY passwordChanged)
+    Q_PROPERTY(QString clientId READ clientId WRITE setClientId NOTIFY clientIdChanged)
+    Q_PROPERTY(bool    persistentSession READ persistentSession WRITE setPersistentSession NOTIFY persistentSessionChanged)
     Q_PROPERTY(QString topic    READ topic    WRITE setTopic    NOTIFY topicChanged)
+    Q_PROPERTY(QStringList topics READ topics WRITE setTopics   NOTIFY topicChanged)
+    Q_PROPERTY(QString blacklist READ blacklist WRITE setBlacklist NOTIFY blacklistChanged)
+    Q_PROPERTY(QString whitelist READ whitelist WRITE setWhitelist NOTIFY whitelistChanged)
+    Q_PROPERTY(QVariantList filterHits READ filterHits          NOTIFY filterHitsChanged)
+    Q_PROPERTY(QString extractors READ extractors WRITE setExtractors NOTIFY extractorsChanged)
     Q_PROPERTY(bool    connected READ connected               NOTIFY connectedChanged)
     Q_PROPERTY(int     reconnectInterval READ reconnectInterval WRITE setReconnectInterval NOTIFY reconnectIntervalChanged)
+    Q_PROPERTY(bool    workerThread READ workerThread WRITE setWorkerThread NOTIFY workerThreadChanged)
+    Q_PROPERTY(bool    sharedConnection READ sharedConnection WRITE setSharedConnection NOTIFY sharedConnectionChanged)
+    Q_PROPERTY(int     batchInterval READ batchInterval WRITE setBatchInterval NOTIFY batchIntervalChanged)
+    Q_PROPERTY(int     maxBatchSize  READ maxBatchSize  WRITE setMaxBatchSize  NOTIFY maxBatchSizeChanged)
+    Q_PROPERTY(DropPolicy dropPolicy READ dropPolicy   WRITE setDropPolicy    NOTIFY dropPolicyChanged)
+    Q_PROPERTY(qint64  droppedMessages READ droppedMessages                    NOTIFY droppedMessagesChanged)
+    Q_PROPERTY(bool    coalesceByTopic READ coalesceByTopic WRITE setCoalesceByTopic NOTIFY coalesceByTopicChanged)
+    Q_PROPERTY(qint64  coalescedMessages READ coalescedMessages                  NOTIFY coalescedMessagesChanged)
+    Q_PROPERTY(int     maxDisplayLength READ maxDisplayLength WRITE setMaxDisplayLength NOTIFY payloadLimitsChanged)
+    Q_PROPERTY(int     maxPayloadBytes  READ maxPayloadBytes  WRITE setMaxPayloadBytes  NOTIFY payloadLimitsChanged)
+    Q_PROPERTY(qint64  oversizedMessages READ oversizedMessages                      NOTIFY oversizedMessagesChanged)
+    Q_PROPERTY(bool    discovery       READ discovery       WRITE setDiscovery       NOTIFY discoveryChanged)
+    Q_PROPERTY(QString discoveryPrefix READ discoveryPrefix WRITE setDiscoveryPrefix NOTIFY discoveryChanged)
+    Q_PROPERTY(int     discoveredEntities READ discoveredEntities                   NOTIFY discoveredEntitiesChanged)
+    Q_PROPERTY(QString captureFile       READ captureFile       WRITE setCaptureFile       NOTIFY captureChanged)
+    Q_PROPERTY(bool    captureCompressed READ captureCompressed WRITE setCaptureCompressed NOTIFY captureChanged)
+    Q_PROPERTY(int     snapshotSize    READ snapshotSize    WRITE setSnapshotSize    NOTIFY snapshotSizeChanged)
+    Q_PROPERTY(bool    suspended       READ suspended       WRITE setSuspended       NOTIFY suspendedChanged)
+    Q_PROPERTY(qint64  memoryCap       READ memoryCap       WRITE setMemoryCap       NOTIFY memoryCapChanged)
 
 public:
+    enum DropPolicy {
+        KeepNewestPerTopic,   // superseded messages of a topic are dropped first
+        DropOldest            // plain FIFO: the oldest messages over the cap go
+    };
+    Q_ENUM(DropPolicy)
+
+    // Same order as MqttConnectionSettings::Transport
+    enum Transport {
+        Tcp,              // mqtt://
+        Tls,              // mqtts://, session tickets reused on reconnect
+        WebSocket,        // ws://host:port/path
+        SecureWebSocket   // wss://host:port/path
+    };
+    Q_ENUM(Transport)
+
     explicit MQTTClient(QObject *parent = nullptr);
     ~MQTTClient();
 
     QString host()     const { return m_host; }
     int     port()     const { return m_port; }
+    Transport transport() const { return m_transport; }
+    QString path()     const { return m_path; }
     QString username() const { return m_username; }
     QString password() const { return m_password; }
-    QString topic()    const { return m_topic; }
-    bool    connected() const;
+    QString clientId() const { return m_clientId; }
+    bool    persistentSession() const { return m_persistentSession; }
+    QString topic()    const { return m_topics.join(u','); }
+    QStringList topics() const { return m_topics; }
+    QString blacklist() const { return m_blacklist; }
+    QString whitelist() const { return m_whitelist; }
+    QVariantList filterHits() const { return m_filterHits; }
+    QString extractors() const { return m_extractors; }
+    bool    connected() const { return m_connected; }
     int     reconnectInterval() const { return m_reconnectInterval; }
+    bool    workerThread() const { return m_workerThread; }
+    bool    sharedConnection() const { return m_sharedConnection; }
+    int     batchInterval() const { return m_batchTimer->interval(); }
+    int     maxBatchSize() const { return m_maxBatchSize; }
+    DropPolicy dropPolicy() const { return m_dropPolicy; }
+    qint64  droppedMessages() const { return m_droppedMessages; }
+    bool    coalesceByTopic() const { return m_coalesce; }
+    qint64  coalescedMessages() const { return m_coalescedMessages; }
+    int     maxDisplayLength() const { return m_maxDisplayLength; }
+    int     maxPayloadBytes() const { return m_maxPayloadBytes; }
+    qint64  oversizedMessages() const { return m_oversizedMessages; }
+    bool    discovery() const { return m_discovery; }
+    QString discoveryPrefix() const { return m_discoveryPrefix; }
+    int     discoveredEntities() const { return m_discoveredEntities; }
+    QString captureFile() const { return m_captureFile; }
+    bool    captureCompressed() const { return m_captureCompressed; }
+    int     snapshotSize() const { return m_snapshot.capacity(); }
+    bool    suspended() const { return m_suspended; }
+    qint64  memoryCap() const;
+
+    // Cumulative pipeline counters for RainStats: received, filtered,
+    // dropped (incl. oversized), coalesced, bytes, tokenized, tokenizeNs,
+    // extracted (of tokenized, reduced to fields by the extractors),
+    // reconnects, connackMs (-1 before the first CONNACK) and the
+    // MemoryLedger's memoryBytes, memoryPeak and memoryCap
+    Q_INVOKABLE QVariantMap ingestStats() const;
+    // Snapshot, oldest first, in the form of messagesReceived()
+    Q_INVOKABLE QVariantList recentMessages() const;
 
 public slots:
     void setHost(const QString &host);
     void setPort(int port);
+    // Both applied on the next connectToHost(); path only for WebSockets
+    void setTransport(Transport transport);
+    void setPath(const QString &path);
     void setUsername(const QString &username);
     void setPassword(const QString &password);
+    // Applied on the next connectToHost(); an empty ID lets QMqttClient
+    // pick a random one and forces a clean session
+    void setClientId(const QString &clientId);
+    void setPersistentSession(bool persistent);
+    // Comma-separated form of setTopics()
     void setTopic(const QString &topic);
+    // One subscription per entry, "filter" or "filter@qos" (QoS 0–2,
+    // default 0). Edits only touch the entries that changed.
+    void setTopics(const QStringList &topics);
+    // Comma-separated entries: MQTT filters when they contain '+'/'#',
+    // substrings otherwise. Rejected topics are dropped before decoding.
+    void setBlacklist(const QString &blacklist);
+    void setWhitelist(const QString &whitelist);
+    // PayloadExtractor rules, one "filter = fields" per line or ';'
+    void setExtractors(const QString &rules);
     void setReconnectInterval(int interval);
+    void setWorkerThread(bool enabled);
+    // Only with workerThread; clientId is ignored while shared
+    void setSharedConnection(bool enabled);
+    void setBatchInterval(int interval);
+    void setMaxBatchSize(int size);
+    void setDropPolicy(DropPolicy policy);
+    void setCoalesceByTopic(bool enabled);
+    // UTF-16 units per payload, at least 1
+    void setMaxDisplayLength(int length);
+    // 0 = no limit
+    void setMaxPayloadBytes(int bytes);
+    void setDiscovery(bool enabled);
+    void setDiscoveryPrefix(const QString &prefix);
+    // Path or file:// URL, empty = off
+    void setCaptureFile(const QString &path);
+    // zlib per 64 KiB block; restarts a running capture as a new session
+    void setCaptureCompressed(bool compressed);
+    // Topics remembered for a warm start, 0 = off
+    void setSnapshotSize(int size);
+    void setSuspended(bool suspended);
+    // Bytes, 0 = no cap
+    void setMemoryCap(qint64 bytes);
     void connectToHost();
     void disconnectFromHost();
+    // Feeds a message into the pipeline as if the broker had sent it,
+    // connected or not (traffic replay, mqttrain-bench)
+    void injectMessage(const QString &topic, const QByteArray &payload);
 
 signals:
     void hostChanged();
     void portChanged();
+    void transportChanged();
     void usernameChanged();
     void passwordChanged();
+    void clientIdChanged();
+    void persistentSessionChanged();
     void topicChanged();
+    void blacklistChanged();
+    void whitelistChanged();
+    void filterHitsChanged();
+    void extractorsChanged();
     void connectedChanged();
     void reconnectIntervalChanged();
-    void reconnecting();
-    void messageReceived(const QString &topic, const QString &payload);
+    void workerThreadChanged();
+    void sharedConnectionChanged();
+    void batchIntervalChanged();
+    void maxBatchSizeChanged();
+    void dropPolicyChanged();
+    void droppedMessagesChanged();
+    void coalesceByTopicChanged();
+    void coalescedMessagesChanged();
+    void payloadLimitsChanged();
+    void oversizedMessagesChanged();
+    void discoveryChanged();
+    void discoveredEntitiesChanged();
+    void captureChanged();
+    void snapshotSizeChanged();
+    void suspendedChanged();
+    void memoryCapChanged();
+    void reconnecting(int delayMs);
+    // Oldest first; each entry is {topic, payload, display} where payload is
+    // an MqttPayload handle (size, truncated, text preview) and display is
+    // {text, flags} from PayloadTokenizer, ready for the renderers
+    void messagesReceived(const QVariantList &messages);
+    // Same form, from the snapshot of the last session; not live traffic
+    void messagesRestored(const QVariantList &messages);
     void connectionError(const QString &error);
 
 private slots:
-    void onConnected();
-    void onDisconnected();
-    void onMessageReceived(const QMqttMessage &message);
-    void onErrorChanged(QMqttClient::ClientError error);
-    void attemptReconnect();
+    void onConnectionStateChanged(bool connected);
+    void scheduleFlush();
+    void flushBatch();
+    void refreshFilterHits();
+    void onDiscoveredEntitiesChanged(int count);
 
 private:
-    void updateSubscription();
+    struct HeldMessage
+    {
+        MqttInbound message;
+        quint64     seq;   // arrival order across topics
+    };
+
+    // Empty poolKey: a private connection
+    void createConnection(const QString &poolKey);
+    void destroyConnection();
+    void rebuildFilter();
+    void applyDiscovery();
+    void applyPayloadLimits();
+    void applyCapture();
+    void hold(QList<MqttInbound> &incoming);
+    void emitBatch(const QList<MqttInbound> &batch);
+    void restoreSnapshot();
+    static QVariantList toVariantList(const QList<MqttInbound> &messages);
+    // Adds the connection's own shed counts to those of the caller
+    void countShed(qint64 dropped, qint64 coalesced);
+    // Runs f on the connection's thread (queued when threaded)
+    template <typename F> void post(F &&f);
 
-    QMqttClient       *m_client;
-    QMqttSubscription *m_subscription;
-    QTimer            *m_connackTimer;
-    QTimer            *m_reconnectTimer;
-    QTcpSocket        *m_socket;
+    QPointer<MqttConnection> m_connection;
+    QString            m_poolKey;          // non-empty while on a shared connection
+    MqttIngestStatsPtr m_ingestStats;
+    MqttSubscriber    *m_subscriber;
+    QThread           *m_thread;
+    QTimer            *m_batchTimer;
+    QTimer            *m_hitsTimer;
     QString            m_host;
     int                m_port;
+    Transport          m_transport;
+    QString            m_path;
     QString            m_username;
     QString            m_password;
-    QString            m_topic;
+    QString            m_clientId;
+    bool               m_persistentSession;
+    QStringList        m_topics;
+    QList<MqttTopicSpec> m_topicSpecs;
+    QString            m_blacklist;
+    QString            m_whitelist;
+    TopicFilterPtr     m_filter;
+    QVariantList       m_filterHits;
+    quint64            m_filterHitsTotal;
+    QString            m_extractors;
+    PayloadExtractorPtr m_extractor;
     int                m_reconnectInterval;
+    bool               m_workerThread;
+    bool               m_sharedConnection;
+    bool               m_connected;
     bool               m_shouldBeConnected;
+    int                m_maxBatchSize;
+    DropPolicy         m_dropPolicy;
+    qint64             m_droppedMessages;
+    bool               m_coalesce;
+    qint64             m_coalescedMessages;
+    int                m_maxDisplayLength;
+    int                m_maxPayloadBytes;
+    qint64             m_oversizedMessages;
+    bool               m_discovery;
+    QString            m_discoveryPrefix;
+    int                m_discoveredEntities;
+    QString            m_captureFile;
+    bool               m_captureCompressed;
+    MessageSnapshot    m_snapshot;
+    QTimer            *m_snapshotTimer;
+    bool               m_suspended;
+    QHash<QString, HeldMessage> m_held;   // by topic, while suspended
+    quint64            m_heldSeq;
+    qint64             m_heldBytes;       // charged to the MemoryLedger
 };
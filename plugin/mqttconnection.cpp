@@ -0,0 +1,890 @@
+#include "mqttconnection.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+#include <QRandomGenerator>
+#include <algorithm>
+#include <climits>
+#include "memoryledger.h"
+#ifdef MQTTRAIN_HAVE_WEBSOCKETS
+#include "mqttwebsocketdevice.h"
+#endif
+
+namespace {
+// Backoff: 250 ms, 500 ms, 1 s, ... up to the reconnect interval
+constexpr int kFirstRetryMs = 250;
+// Latest payloads kept by a shared connection for clients attaching later;
+// bigger ones (bridge dumps) are not worth holding on to
+constexpr qsizetype kMaxLatestTopics = 16384;
+constexpr qsizetype kMaxLatestPayloadBytes = 16 * 1024;
+// A capture lags the broker by at most this much
+constexpr int kCaptureFlushMs = 1000;
+
+// Filters of the persistent session of one client ID on one broker
+QString sessionPath(const QString &key)
+{
+    const QByteArray id = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+         + QStringLiteral("/mqttrain/session-") + QString::fromLatin1(id) + QStringLiteral(".txt");
+}
+}
+
+template <typename Signal, typename... Args>
+void MqttConnection::notifyAll(Signal signal, const Args &...args)
+{
+    for (MqttSubscriber *s : std::as_const(m_subscribers))
+        emit (s->*signal)(args...);
+}
+
+MqttConnection::MqttConnection(QObject *parent)
+    : QObject(parent)
+    , m_client(new QMqttClient(this))
+    , m_connackTimer(new QTimer(this))
+    , m_reconnectTimer(new QTimer(this))
+    , m_resyncTimer(new QTimer(this))
+    , m_captureTimer(new QTimer(this))
+    , m_captureCompressed(true)
+    , m_discovery(new DiscoveryRegistry(this))
+    , m_discoveryEnabled(false)
+    , m_socket(nullptr)
+#ifdef MQTTRAIN_HAVE_WEBSOCKETS
+    , m_webSocket(nullptr)
+#endif
+    , m_reconnectInterval(30000)
+    , m_reconnectAttempts(0)
+    , m_shouldBeConnected(false)
+    , m_connackMs(-1)
+    , m_shared(false)
+    , m_latestBytes(0)
+{
+    connect(m_client, &QMqttClient::connected,    this, &MqttConnection::onConnected);
+    connect(m_client, &QMqttClient::disconnected, this, &MqttConnection::onDisconnected);
+    connect(m_client, &QMqttClient::errorChanged, this, &MqttConnection::onErrorChanged);
+    // Client-level signal: one emission per PUBLISH even when several of
+    // our filters overlap (QMqttSubscription would emit once per match).
+    connect(m_client, &QMqttClient::messageReceived, this, &MqttConnection::onMessageReceived);
+    connect(m_client, &QMqttClient::stateChanged, this, [](QMqttClient::ClientState s) {
+        qDebug() << "📊 MQTT state:" << s;
+    });
+
+    m_connackTimer->setSingleShot(true);
+    m_connackTimer->setInterval(5000);
+    connect(m_connackTimer, &QTimer::timeout, this, [this]() {
+        qWarning() << "⏰ CONNACK timeout!";
+        notifyAll(&MqttSubscriber::connectionError, "CONNACK timeout");
+        // Preserve reconnect intent: disconnectFromHost() sets m_shouldBeConnected=false,
+        // so we save and restore the flag to keep reconnection scheduled.
+        bool wasConnecting = m_shouldBeConnected;
+        disconnectFromHost();
+        if (wasConnecting) {
+            m_shouldBeConnected = true;
+            scheduleReconnect("CONNACK timeout");
+        }
+    });
+
+    // Configurazione timer di riconnessione
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &MqttConnection::attemptReconnect);
+
+    // Discovery adds/removes state topics in bursts; subscribe once it settles
+    m_resyncTimer->setSingleShot(true);
+    m_resyncTimer->setInterval(250);
+    connect(m_resyncTimer, &QTimer::timeout, this, &MqttConnection::syncSubscriptions);
+    connect(m_discovery, &DiscoveryRegistry::stateTopicsChanged, m_resyncTimer, qOverload<>(&QTimer::start));
+    connect(m_discovery, &DiscoveryRegistry::entitiesChanged, this, [this](int count) {
+        notifyAll(&MqttSubscriber::discoveredEntitiesChanged, count);
+    });
+
+    m_captureTimer->setInterval(kCaptureFlushMs);
+    connect(m_captureTimer, &QTimer::timeout, this, [this]() {
+        m_capture.flush();
+        if (!m_capture.isOpen()) {   // write failed, already logged
+            m_captureTimer->stop();
+            notifyAll(&MqttSubscriber::connectionError, QStringLiteral("Capture stopped: write failed"));
+        }
+    });
+}
+
+MqttConnection::~MqttConnection()
+{
+    disconnectFromHost();
+    clearLatest();
+}
+
+void MqttConnection::setShared(bool shared)
+{
+    m_shared = shared;
+    if (!shared) clearLatest();
+}
+
+void MqttConnection::rememberLatest(const QString &topic, const QByteArray &payload)
+{
+    MemoryLedger &ledger = MemoryLedger::instance();
+    auto it = m_latest.find(topic);
+    if (it != m_latest.end()) {
+        ledger.credit(it->size());
+        ledger.charge(payload.size());
+        m_latestBytes += payload.size() - it->size();
+        *it = payload;
+        return;
+    }
+    // A new topic is only worth remembering while there is room for it
+    if (m_latest.size() >= kMaxLatestTopics || !ledger.tryCharge(payload.size())) return;
+    m_latestBytes += payload.size();
+    m_latest.insert(topic, payload);
+}
+
+void MqttConnection::clearLatest()
+{
+    MemoryLedger::instance().credit(m_latestBytes);
+    m_latestBytes = 0;
+    m_latest.clear();
+}
+
+void MqttConnection::attach(MqttSubscriber *subscriber)
+{
+    if (m_subscribers.contains(subscriber)) return;
+    m_subscribers.append(subscriber);
+    subscriber->resetPayloadHistory();
+
+    emit subscriber->connectedChanged(connected());
+    if (m_discoveryEnabled)
+        emit subscriber->discoveredEntitiesChanged(m_discovery->entityCount());
+    if (m_connackMs >= 0)
+        subscriber->stats().connackMs.store(m_connackMs, std::memory_order_relaxed);
+
+    // Its own topics follow with setTopics(); discovered state topics are
+    // everybody's, so their latest values come now
+    if (m_discoveryEnabled) {
+        Decoded decoded;
+        for (auto it = m_latest.cbegin(); it != m_latest.cend(); ++it) {
+            if (!m_discovery->isStateTopic(it.key())) continue;
+            decoded.length = -1;
+            deliver(subscriber, it.key(), it.value(), decoded);
+        }
+    }
+
+    applyReconnectInterval();
+    applyCapture();
+}
+
+void MqttConnection::detach(MqttSubscriber *subscriber)
+{
+    if (!m_subscribers.removeOne(subscriber)) return;
+    subscriber->resetPayloadHistory();
+
+    applyReconnectInterval();
+    applyCapture();
+    syncSubscriptions();
+
+    // Topics nobody follows any more need not be remembered
+    for (auto it = m_latest.begin(); it != m_latest.end();) {
+        const QString &topic = it.key();
+        const bool wanted = (m_discoveryEnabled && m_discovery->isStateTopic(topic))
+            || std::any_of(m_subscribers.cbegin(), m_subscribers.cend(),
+                           [&topic](const MqttSubscriber *s) { return s->wants(topic); });
+        if (wanted) {
+            ++it;
+            continue;
+        }
+        MemoryLedger::instance().credit(it->size());
+        m_latestBytes -= it->size();
+        it = m_latest.erase(it);
+    }
+}
+
+void MqttConnection::setTopics(MqttSubscriber *subscriber, const QList<MqttTopicSpec> &topics)
+{
+    const QList<MqttTopicSpec> before = subscriber->topics();
+    subscriber->setTopics(topics);
+    syncSubscriptions();
+
+    // What the other subscribers have been shown on the new topics, as the
+    // broker's retained replay would (it only replays for new filters)
+    if (!m_shared || m_latest.isEmpty()) return;
+    TopicTrie old;
+    for (qsizetype i = 0; i < before.size(); ++i)
+        old.insert(before[i].filter, int(i));
+    Decoded decoded;
+    qsizetype replayed = 0;
+    for (auto it = m_latest.cbegin(); it != m_latest.cend(); ++it) {
+        const QString &topic = it.key();
+        if (!subscriber->wants(topic) || old.match(topic) >= 0) continue;
+        // Discovered state topics went to every subscriber on attach
+        if (m_discoveryEnabled && m_discovery->isStateTopic(topic)) continue;
+        decoded.length = -1;
+        deliver(subscriber, topic, it.value(), decoded);
+        ++replayed;
+    }
+    if (replayed > 0)
+        qDebug() << "🔗 Replayed" << replayed << "latest value(s) to a shared-connection subscriber";
+}
+
+void MqttConnection::setDiscovery(bool enabled, const QString &prefix)
+{
+    m_discovery->setPrefix(prefix);
+    if (m_discoveryEnabled == enabled) {
+        m_resyncTimer->start();   // the prefix may have changed the filters
+        return;
+    }
+
+    m_discoveryEnabled = enabled;
+    if (enabled && !m_settings.host.isEmpty())
+        m_discovery->loadCache(brokerKey());
+    notifyAll(&MqttSubscriber::discoveredEntitiesChanged, enabled ? m_discovery->entityCount() : 0);
+    syncSubscriptions();
+}
+
+QString MqttConnection::brokerKey() const
+{
+    return m_settings.host + u':' + QString::number(m_settings.port);
+}
+
+void MqttConnection::setReconnectInterval(MqttSubscriber *subscriber, int interval)
+{
+    subscriber->setReconnectInterval(interval);
+    applyReconnectInterval();
+}
+
+void MqttConnection::applyReconnectInterval()
+{
+    // The most impatient subscriber decides
+    int interval = m_subscribers.isEmpty() ? 30000 : INT_MAX;
+    for (const MqttSubscriber *s : std::as_const(m_subscribers))
+        interval = qMin(interval, s->reconnectInterval());
+    m_reconnectInterval = qMax(kFirstRetryMs, interval);
+}
+
+void MqttConnection::setCapture(MqttSubscriber *subscriber, const QString &path, bool compress)
+{
+    subscriber->setCapture(path, compress);
+    applyCapture();
+}
+
+void MqttConnection::applyCapture()
+{
+    // One capture per socket: the first subscriber asking for one
+    const MqttSubscriber *owner = nullptr;
+    for (const MqttSubscriber *s : std::as_const(m_subscribers)) {
+        if (!s->capturePath().isEmpty()) {
+            owner = s;
+            break;
+        }
+    }
+    const QString path = owner ? owner->capturePath() : QString();
+    const bool compress = owner && owner->captureCompressed();
+    if (path == m_capturePath && compress == m_captureCompressed && m_capture.isOpen() == !path.isEmpty())
+        return;
+    m_capturePath = path;
+    m_captureCompressed = compress;
+
+    if (m_capture.isOpen()) {
+        qDebug() << "⏺️ Capture closed:" << m_capture.messages() << "message(s) in" << m_capture.fileName();
+        m_capture.close();
+    }
+    m_captureTimer->stop();
+    if (path.isEmpty()) return;
+
+    QString error;
+    if (!m_capture.open(path, compress, &error)) {
+        qWarning() << "⚠️ capture not writable:" << path << error;
+        notifyAll(&MqttSubscriber::connectionError, QStringLiteral("Capture: ") + error);
+        return;
+    }
+    qDebug() << "⏺️ Capturing to" << path << (compress ? "(compressed)" : "");
+    m_captureTimer->start();
+}
+
+bool MqttConnection::connected() const
+{
+    return m_client->state() == QMqttClient::Connected;
+}
+
+void MqttConnection::connectToHost(const MqttConnectionSettings &settings)
+{
+    // Another client of a shared connection asking for the same broker
+    if (m_shouldBeConnected && settings == m_settings) return;
+
+    // Payload hashes are only comparable within one broker
+    if (settings.host != m_settings.host || settings.port != m_settings.port) {
+        m_tlsSession.clear();
+        clearLatest();
+        for (MqttSubscriber *s : std::as_const(m_subscribers))
+            s->resetPayloadHistory();
+    }
+
+    m_settings = settings;
+    m_shouldBeConnected = true;
+    m_reconnectAttempts = 0;
+    openConnection();
+}
+
+void MqttConnection::openConnection()
+{
+    m_reconnectTimer->stop();
+
+    // Known state topics are subscribed right after CONNACK, before any replay
+    if (m_discoveryEnabled)
+        m_discovery->loadCache(brokerKey());
+
+    qDebug() << "==== connectToHost ==== host:" << m_settings.host << "port:" << m_settings.port
+             << "user:" << m_settings.username;
+
+    closeTransport();
+    switch (m_settings.transport) {
+    case MqttConnectionSettings::Tcp:
+    case MqttConnectionSettings::Tls:
+        openSocket();
+        break;
+    case MqttConnectionSettings::WebSocket:
+    case MqttConnectionSettings::SecureWebSocket:
+        openWebSocket();
+        break;
+    }
+}
+
+void MqttConnection::closeTransport()
+{
+    if (m_socket) {
+        m_socket->disconnect();
+        m_socket->abort();
+        m_socket->deleteLater();
+        m_socket = nullptr;
+    }
+#ifdef MQTTRAIN_HAVE_WEBSOCKETS
+    if (m_webSocket) {
+        m_webSocket->disconnect();
+        m_webSocket->abort();
+        m_webSocket->deleteLater();
+        m_webSocket = nullptr;
+    }
+#endif
+}
+
+void MqttConnection::openSocket()
+{
+    const bool tls = m_settings.transport == MqttConnectionSettings::Tls;
+    QSslSocket *ssl = nullptr;
+    if (tls) {
+        ssl = new QSslSocket(this);
+        QSslConfiguration config = ssl->sslConfiguration();
+        // Session tickets are what lets a reconnect skip the full handshake
+        config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+        if (!m_tlsSession.isEmpty())
+            config.setSessionTicket(m_tlsSession);
+        ssl->setSslConfiguration(config);
+        m_socket = ssl;
+    } else {
+        m_socket = new QTcpSocket(this);
+    }
+
+    connect(m_socket, &QTcpSocket::stateChanged, [](QAbstractSocket::SocketState s) {
+        qDebug() << "🔄 TCP:" << s;
+    });
+    connect(m_socket, QOverload<QAbstractSocket::SocketError>::of(&QTcpSocket::errorOccurred),
+            this, [this](QAbstractSocket::SocketError e) {
+        qWarning() << "🔴 TCP error:" << e << m_socket->errorString();
+        if (e == QAbstractSocket::SslHandshakeFailedError)
+            m_tlsSession.clear();   // a rejected ticket must not be offered again
+        onTransportError("TCP: " + m_socket->errorString());
+    });
+
+    // Latency over throughput: MQTT packets are small and often alone
+    connect(m_socket, &QTcpSocket::connected, this, [this]() {
+        m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        m_socket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
+    });
+
+    if (!tls) {
+        // Once TCP connects, attach as IODevice and send MQTT CONNECT
+        connect(m_socket, &QTcpSocket::connected, this, [this]() {
+            qDebug() << "✅ TCP connected — attaching IODevice transport";
+            startSession(m_socket);
+        });
+        qDebug() << "  Connecting TCP...";
+        m_socket->connectToHost(m_settings.host, static_cast<quint16>(m_settings.port));
+        return;
+    }
+
+    connect(ssl, &QSslSocket::sslErrors, this, [](const QList<QSslError> &errors) {
+        for (const QSslError &e : errors)
+            qWarning() << "🔴 TLS:" << e.errorString();
+    });
+    connect(ssl, &QSslSocket::encrypted, this, [this, ssl]() {
+        const QByteArray ticket = ssl->sslConfiguration().sessionTicket();
+        qDebug() << "🔒 TLS" << ssl->sessionProtocol() << ssl->sessionCipher().name()
+                 << (!m_tlsSession.isEmpty() && m_tlsSession == ticket ? "(resumed)" : "");
+        if (!ticket.isEmpty()) m_tlsSession = ticket;
+        startSession(ssl);
+    });
+    // TLS 1.3 tickets may arrive after the handshake
+    connect(ssl, &QSslSocket::newSessionTicketReceived, this, [this, ssl]() {
+        m_tlsSession = ssl->sslConfiguration().sessionTicket();
+    });
+
+    qDebug() << "  Connecting TLS...";
+    ssl->connectToHostEncrypted(m_settings.host, static_cast<quint16>(m_settings.port));
+}
+
+void MqttConnection::openWebSocket()
+{
+#ifdef MQTTRAIN_HAVE_WEBSOCKETS
+    const bool secure = m_settings.transport == MqttConnectionSettings::SecureWebSocket;
+    QString path = m_settings.path.trimmed();
+    if (!path.startsWith(u'/')) path.prepend(u'/');
+
+    QUrl url;
+    url.setScheme(secure ? QStringLiteral("wss") : QStringLiteral("ws"));
+    url.setHost(m_settings.host);
+    url.setPort(m_settings.port);
+    url.setPath(path);
+
+    m_webSocket = new MqttWebSocketDevice(this);
+    if (secure) {
+        QSslConfiguration config = m_webSocket->sslConfiguration();
+        config.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+        if (!m_tlsSession.isEmpty())
+            config.setSessionTicket(m_tlsSession);
+        m_webSocket->setSslConfiguration(config);
+    }
+
+    connect(m_webSocket, &MqttWebSocketDevice::errorOccurred, this, [this](QAbstractSocket::SocketError e) {
+        qWarning() << "🔴 WebSocket error:" << e << m_webSocket->errorString();
+        if (e == QAbstractSocket::SslHandshakeFailedError)
+            m_tlsSession.clear();
+        onTransportError("WebSocket: " + m_webSocket->errorString());
+    });
+    connect(m_webSocket, &MqttWebSocketDevice::sslErrors, this, [](const QList<QSslError> &errors) {
+        for (const QSslError &e : errors)
+            qWarning() << "🔴 TLS:" << e.errorString();
+    });
+    connect(m_webSocket, &MqttWebSocketDevice::connected, this, [this, secure]() {
+        qDebug() << "✅ WebSocket connected — attaching IODevice transport";
+        if (secure) {
+            const QByteArray ticket = m_webSocket->sslConfiguration().sessionTicket();
+            if (!ticket.isEmpty()) m_tlsSession = ticket;
+        }
+        startSession(m_webSocket);
+    });
+
+    qDebug() << "  Connecting" << url.toString();
+    m_webSocket->open(url);
+#else
+    qWarning() << "❌ MQTT over WebSocket needs a build with Qt WebSockets";
+    notifyAll(&MqttSubscriber::connectionError, QStringLiteral("WebSocket transport not available in this build"));
+#endif
+}
+
+void MqttConnection::onTransportError(const QString &error)
+{
+    notifyAll(&MqttSubscriber::connectionError, error);
+    // Refused/unreachable before the MQTT client took over the transport
+    if (m_shouldBeConnected && m_client->state() == QMqttClient::Disconnected)
+        scheduleReconnect("transport error");
+}
+
+void MqttConnection::startSession(QIODevice *transport)
+{
+    m_client->setHostname(m_settings.host);
+    m_client->setPort(static_cast<quint16>(m_settings.port));
+    m_client->setUsername(m_settings.username);
+    m_client->setPassword(m_settings.password);
+    // A persistent session needs an ID the broker can recognise next time
+    const bool persistent = m_settings.persistentSession && !m_settings.clientId.isEmpty();
+    if (!m_settings.clientId.isEmpty())
+        m_client->setClientId(m_settings.clientId);
+    m_client->setCleanSession(!persistent);
+    m_client->setTransport(transport, QMqttClient::IODevice);
+    m_connackTimer->start();
+    m_sinceConnect.start();
+    m_client->connectToHost();
+    qDebug() << "  MQTT state:" << m_client->state();
+}
+
+void MqttConnection::disconnectFromHost()
+{
+    m_shouldBeConnected = false;
+    m_reconnectTimer->stop();
+    m_connackTimer->stop();
+
+    dropSubscriptions(true);
+    m_client->disconnectFromHost();
+    if (m_socket)
+        m_socket->abort();
+#ifdef MQTTRAIN_HAVE_WEBSOCKETS
+    if (m_webSocket)
+        m_webSocket->abort();
+#endif
+}
+
+void MqttConnection::onConnected()
+{
+    m_connackTimer->stop();
+    qDebug() << "🎉 MQTT connected!" << "client ID:" << m_client->clientId()
+             << (m_client->cleanSession() ? "(clean session)" : "(persistent session)");
+    if (m_sinceConnect.isValid())
+        m_connackMs = m_sinceConnect.elapsed();
+    for (MqttSubscriber *s : std::as_const(m_subscribers)) {
+        s->stats().connackMs.store(m_connackMs, std::memory_order_relaxed);
+        if (m_reconnectAttempts > 0) {
+            s->stats().reconnects.fetch_add(1, std::memory_order_relaxed);
+            // Only a re-connection replays retained messages already shown
+            s->startReplayWindow();
+        }
+    }
+    m_reconnectAttempts = 0;
+    notifyAll(&MqttSubscriber::connectedChanged, true);
+    loadSessionFilters();
+    syncSubscriptions();
+}
+
+void MqttConnection::onDisconnected()
+{
+    m_connackTimer->stop();
+    qDebug() << "❌ MQTT disconnected";
+
+    dropSubscriptions(false);
+
+    notifyAll(&MqttSubscriber::connectedChanged, false);
+
+    // Avvia tentativi di riconnessione se necessario
+    if (m_shouldBeConnected)
+        scheduleReconnect("Disconnected");
+}
+
+void MqttConnection::onMessageReceived(const QByteArray &payload, const QMqttTopicName &topic)
+{
+    const QString name = m_topicNames.intern(topic.name());
+    if (m_capture.isOpen())
+        m_capture.append(name, payload);
+    if (consumeDiscovery(name, payload))
+        return;
+
+    // Only a subscriber's own topics, and the discovered state topics
+    // everybody follows: a persistent session can still carry filters
+    // nobody asked for this run
+    Decoded decoded;
+    const bool everybody = m_discoveryEnabled && m_discovery->isStateTopic(name);
+    bool wanted = everybody;
+    for (MqttSubscriber *s : std::as_const(m_subscribers)) {
+        if (everybody || s->wants(name)) {
+            deliver(s, name, payload, decoded);
+            wanted = true;
+        }
+    }
+
+    if (wanted && m_shared && payload.size() <= kMaxLatestPayloadBytes)
+        rememberLatest(name, payload);
+}
+
+void MqttConnection::inject(MqttSubscriber *subscriber, const QString &topic, const QByteArray &payload)
+{
+    if (consumeDiscovery(topic, payload))
+        return;
+    Decoded decoded;
+    deliver(subscriber, m_topicNames.intern(topic), payload, decoded);
+}
+
+bool MqttConnection::consumeDiscovery(const QString &topic, const QByteArray &payload)
+{
+    // Discovery configs are metadata: they feed the registry, not the rain
+    if (!m_discoveryEnabled || !m_discovery->isDiscoveryTopic(topic))
+        return false;
+    for (MqttSubscriber *s : std::as_const(m_subscribers)) {
+        s->stats().received.fetch_add(1, std::memory_order_relaxed);
+        s->stats().bytes.fetch_add(quint64(payload.size()), std::memory_order_relaxed);
+    }
+    m_discovery->handleMessage(topic, payload);
+    return true;
+}
+
+void MqttConnection::deliver(MqttSubscriber *subscriber, const QString &topic, const QByteArray &payload,
+                             Decoded &decoded)
+{
+    if (!subscriber->admit(topic, payload))
+        return;
+
+    // Subscribers showing the same length and fields share one decode
+    const int displayLength = subscriber->displayLength();
+    const PayloadExtractor *extractor = subscriber->extractor();
+    if (decoded.length != displayLength || decoded.extractor != extractor) {
+        QElapsedTimer tokenizeClock;
+        tokenizeClock.start();
+        decoded.length = displayLength;
+        decoded.extractor = extractor;
+        decoded.empty = false;
+
+        const PayloadExtractor::Result extracted = extractor
+            ? extractor->extract(topic, payload, displayLength, &decoded.display)
+            : PayloadExtractor::Unmatched;
+        if (extracted == PayloadExtractor::Unmatched)
+            decoded.display = tokenizeDisplay(payload, displayLength);
+        else if (extracted == PayloadExtractor::Empty)
+            decoded.empty = true;
+        else
+            subscriber->stats().extracted.fetch_add(1, std::memory_order_relaxed);
+        subscriber->stats().tokenized.fetch_add(1, std::memory_order_relaxed);
+        subscriber->stats().tokenizeNs.fetch_add(quint64(tokenizeClock.nsecsElapsed()), std::memory_order_relaxed);
+    }
+
+    // Nothing worth showing: counted with the filtered ones
+    if (decoded.empty) {
+        subscriber->stats().filtered.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    MqttInbound item;
+    item.topic   = topic;
+    item.payload = MqttPayload(payload);
+    item.display = decoded.display;
+    subscriber->push(std::move(item));
+}
+
+TokenizedPayload MqttConnection::tokenizeDisplay(const QByteArray &payload, int displayLength)
+{
+    // Decode only what can be shown: a UTF-16 unit takes at most 3 UTF-8
+    // bytes (4 bytes make a surrogate pair), then trim to the exact length
+    const qsizetype prefix = MqttPayload::utf8Prefix(payload, qsizetype(displayLength) * 3);
+    QString text = QString::fromUtf8(QByteArrayView(payload).first(prefix));
+    bool truncated = prefix < payload.size();
+    if (text.size() > displayLength) {
+        qsizetype n = displayLength;
+        if (text.at(n - 1).isHighSurrogate()) --n;
+        text.truncate(n);
+        truncated = true;
+    }
+    return PayloadTokenizer::tokenize(text, truncated);
+}
+
+void MqttConnection::onErrorChanged(QMqttClient::ClientError error)
+{
+    if (error == QMqttClient::NoError) return;
+
+    static const QMap<QMqttClient::ClientError, QString> errors = {
+        { QMqttClient::InvalidProtocolVersion, "Invalid protocol version" },
+        { QMqttClient::IdRejected,             "Client ID rejected" },
+        { QMqttClient::ServerUnavailable,      "Server unavailable" },
+        { QMqttClient::BadUsernameOrPassword,  "Bad username or password" },
+        { QMqttClient::NotAuthorized,          "Not authorized" },
+        { QMqttClient::TransportInvalid,       "Transport invalid" },
+        { QMqttClient::ProtocolViolation,      "Protocol violation" },
+    };
+
+    QString msg = errors.value(error, "Unknown error");
+    qWarning() << "⚠️ MQTT Error:" << msg;
+    notifyAll(&MqttSubscriber::connectionError, msg);
+
+    // Avvia riconnessione per errori non legati a credenziali
+    if (m_shouldBeConnected &&
+        error != QMqttClient::BadUsernameOrPassword &&
+        error != QMqttClient::NotAuthorized) {
+        scheduleReconnect("MQTT error");
+    }
+}
+
+void MqttConnection::attemptReconnect()
+{
+    if (!m_shouldBeConnected) {
+        qDebug() << "⏸️ Reconnection canceled (shouldBeConnected=false)";
+        return;
+    }
+
+    if (connected()) {
+        qDebug() << "✅ Already connected, skipping reconnection";
+        return;
+    }
+
+    qDebug() << "🔄 Attempting reconnection to" << m_settings.host << ":" << m_settings.port;
+    openConnection();
+}
+
+void MqttConnection::scheduleReconnect(const char *reason)
+{
+    // Socket error, MQTT error and disconnect often arrive for one failure
+    if (m_reconnectTimer->isActive()) return;
+
+    // Exponential growth capped at the interval, then equal jitter: half
+    // of the delay is fixed, the other half random
+    const int shift = qMin(m_reconnectAttempts, 16);
+    const int base = int(qMin<qint64>(qint64(kFirstRetryMs) << shift, m_reconnectInterval));
+    const int delay = base / 2 + int(QRandomGenerator::global()->bounded(base / 2 + 1));
+    ++m_reconnectAttempts;
+
+    qDebug() << "🔄" << reason << "- reconnection attempt" << m_reconnectAttempts << "in" << delay << "ms...";
+    notifyAll(&MqttSubscriber::reconnecting, delay);
+    m_reconnectTimer->start(delay);
+}
+
+void MqttConnection::dropSubscriptions(bool unsubscribe)
+{
+    // QMqttClient owns the QMqttSubscription objects and may hand the same
+    // one back on a later subscribe(), so only our connections are dropped
+    for (const ActiveSubscription &a : std::as_const(m_subscriptions)) {
+        disconnect(a.subscription, nullptr, this, nullptr);
+        if (unsubscribe && connected() && !a.leaving)
+            a.subscription->unsubscribe();
+    }
+    m_subscriptions.clear();
+}
+
+QList<MqttTopicSpec> MqttConnection::wantedSubscriptions() const
+{
+    // Union of the subscribers' topics; a filter asked for twice gets the
+    // higher QoS
+    QList<MqttTopicSpec> wanted;
+    auto add = [&wanted](const MqttTopicSpec &spec) {
+        for (MqttTopicSpec &t : wanted) {
+            if (t.filter == spec.filter) {
+                t.qos = qMax(t.qos, spec.qos);
+                return;
+            }
+        }
+        wanted.append(spec);
+    };
+    for (const MqttSubscriber *s : std::as_const(m_subscribers)) {
+        for (const MqttTopicSpec &t : s->topics()) add(t);
+    }
+    if (!m_discoveryEnabled) return wanted;
+
+    auto addIfMissing = [&wanted](const QString &filter) {
+        for (const MqttTopicSpec &t : std::as_const(wanted)) {
+            if (t.filter == filter) return;
+        }
+        wanted.append({ filter, 0 });
+    };
+    for (const QString &f : m_discovery->discoveryFilters()) addIfMissing(f);
+    for (const QString &t : m_discovery->stateTopics())      addIfMissing(t);
+    return wanted;
+}
+
+void MqttConnection::syncSubscriptions()
+{
+    m_resyncTimer->stop();
+    if (!connected()) return;
+
+    const QList<MqttTopicSpec> wanted = wantedSubscriptions();
+
+    // Drop filters that were removed or changed QoS. QMqttClient hands
+    // back its existing object for a filter it still holds, so a new QoS
+    // is only subscribed once the old one is confirmed gone (leave())
+    for (auto it = m_subscriptions.begin(); it != m_subscriptions.end(); ++it) {
+        if (it->leaving) continue;
+        const auto match = std::find_if(wanted.cbegin(), wanted.cend(),
+                                         [&](const MqttTopicSpec &t) { return t.filter == it.key(); });
+        if (match == wanted.cend() || match->qos != it->qos)
+            leave(it.key(), *it);
+    }
+
+    // Subscribe what is new (or left, at its old QoS, already)
+    const bool persistent = !m_client->cleanSession();
+    bool sessionChanged = false;
+    for (const MqttTopicSpec &t : wanted) {
+        if (m_subscriptions.contains(t.filter)) continue;
+
+        qDebug() << "📡 subscribing to:" << t.filter << "QoS" << t.qos;
+        QMqttSubscription *s = m_client->subscribe(t.filter, t.qos);
+        if (!s) {
+            qWarning() << "❌ subscribe failed:" << t.filter;
+            continue;
+        }
+
+        const QString filter = t.filter;
+        connect(s, &QMqttSubscription::stateChanged, this, [this, filter](QMqttSubscription::SubscriptionState state) {
+            if (state == QMqttSubscription::Subscribed) {
+                qDebug() << "✅ subscribed:" << filter;
+            } else if (state == QMqttSubscription::Error) {
+                qWarning() << "❌ subscribe rejected:" << filter;
+                notifyAll(&MqttSubscriber::connectionError, "Subscription rejected: " + filter);
+            }
+        });
+        m_subscriptions.insert(t.filter, { s, t.qos });
+        if (persistent && !m_sessionFilters.contains(t.filter)) {
+            m_sessionFilters.insert(t.filter);
+            sessionChanged = true;
+        }
+    }
+    if (sessionChanged) saveSessionFilters();
+
+    // What the session still holds from an earlier run, or from topics
+    // removed while offline. QMqttClient only unsubscribes filters it
+    // knows, so each is subscribed and left again at once; whatever the
+    // broker sends for it meanwhile goes to nobody (onMessageReceived)
+    if (!persistent) return;
+    const QSet<QString> session = m_sessionFilters;
+    for (const QString &filter : session) {
+        if (m_subscriptions.contains(filter)) continue;
+        QMqttSubscription *s = m_client->subscribe(filter, 0);
+        if (!s) continue;
+        qDebug() << "🧹 stale session filter:" << filter;
+        leave(filter, *m_subscriptions.insert(filter, { s, 0 }));
+    }
+}
+
+void MqttConnection::loadSessionFilters()
+{
+    const QString key = m_client->clientId() + u'@' + brokerKey();
+    if (key != m_sessionKey) {
+        m_sessionKey = key;
+        m_sessionFilters.clear();
+        QFile file(sessionPath(key));
+        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            while (!file.atEnd()) {
+                const QString filter = QString::fromUtf8(file.readLine()).trimmed();
+                if (!filter.isEmpty()) m_sessionFilters.insert(filter);
+            }
+        }
+    }
+
+    // A clean session starts from nothing on the broker as well
+    if (m_client->cleanSession() && !m_sessionFilters.isEmpty()) {
+        m_sessionFilters.clear();
+        saveSessionFilters();
+    }
+}
+
+void MqttConnection::saveSessionFilters() const
+{
+    if (m_sessionKey.isEmpty()) return;
+    const QString path = sessionPath(m_sessionKey);
+    if (m_sessionFilters.isEmpty()) {
+        QFile::remove(path);
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        qWarning() << "⚠️ session filters not writable:" << path << file.errorString();
+        return;
+    }
+    for (const QString &filter : m_sessionFilters)
+        file.write(filter.toUtf8() + '\n');
+    if (!file.commit())
+        qWarning() << "⚠️ session filters write failed:" << path << file.errorString();
+}
+
+void MqttConnection::leave(const QString &filter, ActiveSubscription &active)
+{
+    qDebug() << "📴 unsubscribing from:" << filter;
+    QMqttSubscription *subscription = active.subscription;
+    disconnect(subscription, nullptr, this, nullptr);
+    active.leaving = true;
+    connect(subscription, &QMqttSubscription::stateChanged, this,
+            [this, filter, subscription](QMqttSubscription::SubscriptionState state) {
+        // Going down takes every subscription with it; dropSubscriptions() handles that
+        if (state != QMqttSubscription::Unsubscribed || !connected()) return;
+        const auto it = m_subscriptions.constFind(filter);
+        if (it == m_subscriptions.cend() || it->subscription != subscription) return;
+        disconnect(subscription, nullptr, this, nullptr);
+        m_subscriptions.erase(it);
+        if (m_sessionFilters.remove(filter)) saveSessionFilters();
+        // Still wanted (at another QoS): subscribe it again now
+        m_resyncTimer->start();
+    });
+    subscription->unsubscribe();
+}
@@ -0,0 +1,228 @@
+#pragma once
+#include <QObject>
+#include <QMqttClient>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QList>
+#include <QSet>
+#include <QMqttSubscription>
+#include <QSslSocket>
+#include <QTcpSocket>
+#include <QTimer>
+#include "discoveryregistry.h"
+#include "mqttcapture.h"
+#include "mqttsubscriber.h"
+#include "topicinterner.h"
+
+#ifdef MQTTRAIN_HAVE_WEBSOCKETS
+class MqttWebSocketDevice;
+#endif
+
+struct MqttConnectionSettings
+{
+    // Same order as MQTTClient::Transport
+    enum Transport { Tcp, Tls, WebSocket, SecureWebSocket };
+
+    QString host;
+    int     port = 1883;
+    Transport transport = Tcp;
+    QString path = QStringLiteral("/");   // WebSocket transports only
+    QString username;
+    QString password;
+    // Stable per wallpaper instance (per machine and broker when shared);
+    // required for a persistent session
+    QString clientId;
+    bool    persistentSession = true;
+
+    bool operator==(const MqttConnectionSettings &o) const
+    {
+        return host == o.host && port == o.port && transport == o.transport && path == o.path
+            && username == o.username && password == o.password
+            && clientId == o.clientId && persistentSession == o.persistentSession;
+    }
+    bool operator!=(const MqttConnectionSettings &o) const { return !(*this == o); }
+};
+
+// Transport half of MQTTClient: QMqttClient, its socket and the
+// CONNACK/reconnect timers, plus the per-message work (topic filtering,
+// then UTF-8 decoding and tokenisation of what passes) for each attached
+// MqttSubscriber.
+//
+// A private connection serves one MQTTClient. A shared one (from
+// MqttConnectionPool) serves every MQTTClient on the same broker: the
+// subscriptions are the union of the subscribers' topics, each PUBLISH
+// is routed to the subscribers whose own topics match, and filtering,
+// dedup and the queue stay per subscriber. Tokenisation runs once per
+// message and display length, not once per subscriber. A shared
+// connection also remembers the latest payload per topic, so a client
+// attaching later (a screen plugged in) starts from current values
+// without a new retained replay from the broker.
+//
+// The transport is plain TCP, TLS, or MQTT over ws:// or wss:// (the
+// latter only when built with Qt WebSockets), always handed to
+// QMqttClient as an IODevice. Sockets get TCP_NODELAY, so a small
+// PUBLISH is not held back waiting for an ACK (Nagle), and SO_KEEPALIVE;
+// TLS session tickets are kept per connection so a reconnect resumes the
+// session instead of a full handshake.
+//
+// Reconnects back off exponentially from a near-immediate first retry up
+// to the (smallest subscriber's) interval, with jitter so desktops
+// restarted together do not hit the broker in lockstep. With a client ID
+// the session is persistent (cleanSession=false) and the broker queues
+// QoS 1/2 traffic across short outages; the retained replay that follows
+// resubscribing is cut short by dropping unchanged payloads right after
+// CONNACK. The filters such a session holds are kept on disk per client
+// ID and broker, so ones left from an earlier run (or removed while
+// offline) are unsubscribed after CONNACK; until then a message reaches
+// a subscriber only on a topic it wants.
+//
+// Topic names are interned on receipt (TopicInterner), and queued
+// messages and the latest payloads are charged to the process-wide
+// MemoryLedger: at its cap new messages are shed instead of queued.
+//
+// Payloads larger than the byte limit are dropped before decoding; the
+// rest are decoded and tokenised only up to the display length, so a
+// multi-hundred-KB bridge dump costs no more than what one column shows.
+// Topics with a PayloadExtractor rule get only the selected fields as
+// their display form instead, and are dropped when none is present.
+//
+// With coalescing enabled, a payload identical to the last one seen on
+// its topic is always dropped, before decoding and tokenisation (not
+// only during the post-reconnect replay window).
+//
+// With a capture file set (the first subscriber's that has one), every
+// PUBLISH from the broker is appended to it (MqttCaptureWriter) before
+// discovery or filtering, so a replay sees the traffic exactly as the
+// broker sent it; injected messages are not recorded.
+//
+// With discovery enabled, Home Assistant config topics are routed to a
+// DiscoveryRegistry instead of the renderers, and every state topic it
+// knows about becomes an extra QoS 0 subscription delivered to all
+// subscribers.
+//
+// Lives either on the GUI thread, on MQTTClient's worker thread or on the
+// pool thread; all public methods must be called on the thread the object
+// lives on (MQTTClient posts them with QMetaObject::invokeMethod).
+// Finished messages are pushed into each subscriber's lock-free queue,
+// drained by its MQTTClient on the GUI thread.
+class MqttConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MqttConnection(QObject *parent = nullptr);
+    ~MqttConnection() override;
+
+    // Shared connections keep the latest payload per topic for late attachers
+    void setShared(bool shared);
+
+    // A new subscriber gets the connection state (and, shared, the latest
+    // payloads) right away; detaching drops its subscriptions
+    void attach(MqttSubscriber *subscriber);
+    void detach(MqttSubscriber *subscriber);
+    int  subscriberCount() const { return int(m_subscribers.size()); }
+
+    // Repeating the settings of a connection already up is a no-op
+    void connectToHost(const MqttConnectionSettings &settings);
+    void disconnectFromHost();
+    // Diffed against the live subscriptions: only added, removed or
+    // QoS-changed filters are (un)subscribed, the session stays up.
+    void setTopics(MqttSubscriber *subscriber, const QList<MqttTopicSpec> &topics);
+    // Upper bound of the reconnect backoff
+    void setReconnectInterval(MqttSubscriber *subscriber, int interval);
+    void setDiscovery(bool enabled, const QString &prefix);
+    // Empty path stops capturing; an existing file gets a new session
+    void setCapture(MqttSubscriber *subscriber, const QString &path, bool compress);
+    // Runs one message through the same path as a PUBLISH from the broker
+    // (discovery, filter, dedup, tokenise, queue), for this subscriber
+    // only; used for replay
+    void inject(MqttSubscriber *subscriber, const QString &topic, const QByteArray &payload);
+
+private slots:
+    void onConnected();
+    void onDisconnected();
+    void onMessageReceived(const QByteArray &payload, const QMqttTopicName &topic);
+    void onErrorChanged(QMqttClient::ClientError error);
+    void attemptReconnect();
+
+private:
+    struct ActiveSubscription
+    {
+        QMqttSubscription *subscription;
+        quint8             qos;
+        bool               leaving = false;   // UNSUBSCRIBE sent, UNSUBACK pending
+    };
+
+    // Display form of one payload, decoded once per display length and
+    // extractor; empty when the extractor found none of its fields
+    struct Decoded
+    {
+        int              length = -1;
+        const PayloadExtractor *extractor = nullptr;
+        bool             empty = false;
+        TokenizedPayload display;
+    };
+
+    // Emits signal on every attached subscriber
+    template <typename Signal, typename... Args>
+    void notifyAll(Signal signal, const Args &...args);
+
+    bool connected() const;
+    void openConnection();
+    void openSocket();
+    void openWebSocket();
+    void closeTransport();
+    // Transport is up: MQTT CONNECT over it
+    void startSession(QIODevice *transport);
+    void onTransportError(const QString &error);
+    void scheduleReconnect(const char *reason);
+    // Discovery configs are consumed here; returns true when topic was one
+    bool consumeDiscovery(const QString &topic, const QByteArray &payload);
+    void deliver(MqttSubscriber *subscriber, const QString &topic, const QByteArray &payload, Decoded &decoded);
+    // UTF-8 decode of the displayable prefix, then PayloadTokenizer
+    static TokenizedPayload tokenizeDisplay(const QByteArray &payload, int displayLength);
+    void syncSubscriptions();
+    // Sends UNSUBSCRIBE; the entry stays until the broker confirms it
+    void leave(const QString &filter, ActiveSubscription &active);
+    void applyReconnectInterval();
+    void applyCapture();
+    QList<MqttTopicSpec> wantedSubscriptions() const;
+    QString brokerKey() const;
+    void dropSubscriptions(bool unsubscribe);
+    // m_latest with its MemoryLedger charge
+    void rememberLatest(const QString &topic, const QByteArray &payload);
+    void clearLatest();
+    // Filters the broker may hold for this client ID, from the last run
+    void loadSessionFilters();
+    void saveSessionFilters() const;
+
+    QMqttClient            *m_client;
+    QTimer                 *m_connackTimer;
+    QTimer                 *m_reconnectTimer;
+    QTimer                 *m_resyncTimer;
+    QTimer                 *m_captureTimer;
+    MqttCaptureWriter       m_capture;
+    QString                 m_capturePath;      // open (or last attempted) capture
+    bool                    m_captureCompressed;
+    DiscoveryRegistry      *m_discovery;
+    bool                    m_discoveryEnabled;
+    QTcpSocket             *m_socket;           // QSslSocket for TLS
+#ifdef MQTTRAIN_HAVE_WEBSOCKETS
+    MqttWebSocketDevice    *m_webSocket;
+#endif
+    QByteArray              m_tlsSession;       // ticket of the last TLS session
+    MqttConnectionSettings  m_settings;
+    QList<MqttSubscriber *> m_subscribers;
+    QHash<QString, ActiveSubscription> m_subscriptions;   // by filter
+    int                     m_reconnectInterval;
+    int                     m_reconnectAttempts;
+    bool                    m_shouldBeConnected;
+    QElapsedTimer           m_sinceConnect;     // CONNECT sent, until CONNACK
+    qint64                  m_connackMs;
+    bool                    m_shared;
+    QHash<QString, QByteArray> m_latest;        // shared only: topic → last payload
+    qint64                  m_latestBytes;      // charged to the MemoryLedger
+    TopicInterner           m_topicNames;
+    QString                 m_sessionKey;       // client ID @ broker of m_sessionFilters
+    QSet<QString>           m_sessionFilters;   // subscribed in a persistent session
+};
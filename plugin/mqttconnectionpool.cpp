@@ -0,0 +1,103 @@
+#include "mqttconnectionpool.h"
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QStringList>
+#include <QSysInfo>
+#include <QThread>
+
+MqttConnectionPool &MqttConnectionPool::instance()
+{
+    static MqttConnectionPool pool;
+    return pool;
+}
+
+MqttConnectionPool::MqttConnectionPool()
+    : m_thread(nullptr)
+{
+}
+
+MqttConnectionPool::~MqttConnectionPool()
+{
+    // Every client released its connection before the application went
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+QString MqttConnectionPool::key(const MqttConnectionSettings &settings, bool discovery, const QString &prefix)
+{
+    return identity(settings, discovery, prefix) + u'|' + settings.password;
+}
+
+QString MqttConnectionPool::identity(const MqttConnectionSettings &settings, bool discovery, const QString &prefix)
+{
+    return QStringList {
+        settings.host.toLower(),
+        QString::number(settings.port),
+        QString::number(int(settings.transport)),
+        settings.transport >= MqttConnectionSettings::WebSocket ? settings.path : QString(),
+        settings.username,
+        settings.persistentSession ? QStringLiteral("persistent") : QStringLiteral("clean"),
+        discovery ? prefix : QString(),
+    }.join(u'|');
+}
+
+QString MqttConnectionPool::sharedClientId(const MqttConnectionSettings &settings, bool discovery, const QString &prefix)
+{
+    // The password stays out: the ID goes to the broker in the clear
+    const QString key = identity(settings, discovery, prefix);
+
+    QByteArray machine = QSysInfo::machineUniqueId();
+    if (machine.isEmpty()) machine = QSysInfo::machineHostName().toUtf8();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(machine);
+    hash.addData(qgetenv("USER"));
+    hash.addData(key.toUtf8());
+    return QStringLiteral("mqttrain-") + QString::fromLatin1(hash.result().toHex().left(12));
+}
+
+MqttConnection *MqttConnectionPool::acquire(const QString &key)
+{
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        ++it->refs;
+        qDebug() << "🔗 Sharing MQTT connection," << it->refs << "client(s)";
+        return it->connection;
+    }
+
+    if (!m_thread) {
+        m_thread = new QThread;
+        m_thread->setObjectName(QStringLiteral("MQTTRain-io"));
+        m_thread->start();
+    }
+    auto *conn = new MqttConnection;
+    conn->setShared(true);
+    conn->moveToThread(m_thread);
+    m_entries.insert(key, Entry { conn, 1 });
+    qDebug() << "🔗 New shared MQTT connection," << m_entries.size() << "in the pool";
+    return conn;
+}
+
+void MqttConnectionPool::release(MqttConnection *connection)
+{
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        if (it->connection != connection) continue;
+        if (--it->refs > 0) return;
+        m_entries.erase(it);
+
+        // Tear down on the owning thread: QMqttClient and the socket are not
+        // thread-safe and their destructors send DISCONNECT.
+        QMetaObject::invokeMethod(connection, [connection]() { delete connection; }, Qt::BlockingQueuedConnection);
+        if (m_entries.isEmpty()) {
+            m_thread->quit();
+            m_thread->wait();
+            delete m_thread;
+            m_thread = nullptr;
+        }
+        return;
+    }
+    qWarning() << "⚠️ Releasing an MQTT connection the pool does not own";
+}
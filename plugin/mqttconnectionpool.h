@@ -0,0 +1,48 @@
+#pragma once
+#include <QHash>
+#include <QString>
+#include "mqttconnection.h"
+
+class QThread;
+
+// One MqttConnection per broker for every MQTTClient in the process, so a
+// multi-monitor desktop (one wallpaper instance per screen) keeps a single
+// socket, session and retained replay instead of one per screen.
+//
+// Connections are keyed by broker (transport and path included), credentials, session kind and discovery
+// settings, reference-counted, and live on one shared "MQTTRain-io"
+// thread that stops when the last of them goes. GUI thread only.
+class MqttConnectionPool
+{
+public:
+    static MqttConnectionPool &instance();
+    ~MqttConnectionPool();
+
+    // Clients with the same key share a connection
+    static QString key(const MqttConnectionSettings &settings, bool discovery, const QString &prefix);
+    // Stable per machine, user and pool key minus the password: the shared
+    // session outlives any one wallpaper instance and its per-instance
+    // client ID, and two connections to different brokers, users, session
+    // kinds or discovery prefixes never take over each other's session
+    static QString sharedClientId(const MqttConnectionSettings &settings, bool discovery, const QString &prefix);
+
+    MqttConnection *acquire(const QString &key);
+    // The last release tears the connection down (DISCONNECT included) on
+    // its thread before returning
+    void release(MqttConnection *connection);
+
+private:
+    MqttConnectionPool();
+
+    // key() without the password
+    static QString identity(const MqttConnectionSettings &settings, bool discovery, const QString &prefix);
+
+    struct Entry
+    {
+        MqttConnection *connection;
+        int             refs;
+    };
+
+    QHash<QString, Entry> m_entries;
+    QThread              *m_thread;
+};
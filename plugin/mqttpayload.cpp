@@ -0,0 +1,25 @@
+#include "mqttpayload.h"
+
+MqttPayload::MqttPayload(const QByteArray &bytes, qsizetype previewBytes)
+    : m_bytes(bytes)
+    , m_preview(utf8Prefix(bytes, previewBytes))
+{
+}
+
+QString MqttPayload::toString() const
+{
+    QString s = text();
+    if (truncated()) s.append(u'…');
+    return s;
+}
+
+qsizetype MqttPayload::utf8Prefix(QByteArrayView bytes, qsizetype maxBytes)
+{
+    if (maxBytes < 0 || bytes.size() <= maxBytes) return bytes.size();
+
+    // Back up over continuation bytes (10xxxxxx) to the lead byte of the
+    // sequence that crosses the cut, and cut before it
+    qsizetype n = maxBytes;
+    while (n > 0 && (quint8(bytes[n]) & 0xC0) == 0x80) --n;
+    return n;
+}
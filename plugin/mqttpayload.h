@@ -0,0 +1,46 @@
+#pragma once
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QMetaType>
+#include <QString>
+
+// Raw bytes of one MQTT payload, implicitly shared with the QMqttMessage
+// they arrived in: moving it through the inbound queue, the batch and the
+// QML message list never copies the payload.
+//
+// The renderers draw the tokenised display form, so QML only ever needs
+// a short preview (history, debug log, message pool). text is the UTF-8
+// prefix of at most previewBytes, cut on a character boundary and decoded
+// on demand; toString() marks a cut preview with "…". The full payload is
+// never turned into a QString here.
+class MqttPayload
+{
+    Q_GADGET
+    Q_PROPERTY(int     size      READ size)
+    Q_PROPERTY(bool    truncated READ truncated)
+    Q_PROPERTY(QString text      READ text)
+
+public:
+    static constexpr qsizetype kPreviewBytes = 256;
+
+    MqttPayload() = default;
+    explicit MqttPayload(const QByteArray &bytes, qsizetype previewBytes = kPreviewBytes);
+
+    const QByteArray &bytes() const { return m_bytes; }
+    int  size()      const { return int(m_bytes.size()); }
+    bool truncated() const { return m_preview < m_bytes.size(); }
+    bool isEmpty()   const { return m_bytes.isEmpty(); }
+
+    QByteArrayView previewBytes() const { return QByteArrayView(m_bytes).first(m_preview); }
+    QString text() const { return QString::fromUtf8(previewBytes()); }
+    Q_INVOKABLE QString toString() const;
+
+    // Longest prefix of at most maxBytes that does not split a UTF-8 sequence
+    static qsizetype utf8Prefix(QByteArrayView bytes, qsizetype maxBytes);
+
+private:
+    QByteArray m_bytes;
+    qsizetype  m_preview = 0;
+};
+
+Q_DECLARE_METATYPE(MqttPayload)
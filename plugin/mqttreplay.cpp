@@ -0,0 +1,199 @@
+#include "mqttreplay.h"
+#include "mqttclient.h"
+#include <QDebug>
+
+namespace {
+// Messages injected per event loop pass at speed 0
+constexpr int kBurst = 256;
+}
+
+MqttReplay::MqttReplay(QObject *parent)
+    : QObject(parent)
+    , m_hasPending(false)
+    , m_timer(new QTimer(this))
+    , m_speed(1)
+    , m_loop(false)
+    , m_running(false)
+    , m_complete(true)
+    , m_passStartUs(0)
+    , m_positionUs(0)
+    , m_injected(0)
+    , m_injectedBytes(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &MqttReplay::pump);
+}
+
+void MqttReplay::setClient(MQTTClient *client)
+{
+    if (m_client == client) return;
+    m_client = client;
+    emit clientChanged();
+}
+
+void MqttReplay::setSource(const QString &source)
+{
+    if (m_source == source) return;
+    m_source = source;
+    emit sourceChanged();
+    if (!m_running || !m_complete) return;
+    if (source.isEmpty()) stop();
+    else                  start();
+}
+
+void MqttReplay::setSpeed(qreal speed)
+{
+    speed = qMax<qreal>(0, speed);
+    if (qFuzzyCompare(m_speed + 1, speed + 1)) return;
+    if (!m_complete) {
+        m_speed = speed;
+        emit speedChanged();
+        return;
+    }
+
+    // Keep the position: re-base the pass on the new clock
+    if (m_running && m_speed > 0 && speed > 0) {
+        const qint64 at = nowUs() - m_passStartUs;
+        m_speed = speed;
+        m_passStartUs = nowUs() - at;
+    } else {
+        m_speed = speed;
+        if (m_running) start();
+    }
+    emit speedChanged();
+    if (m_running) scheduleNext();
+}
+
+void MqttReplay::setLoop(bool loop)
+{
+    if (m_loop == loop) return;
+    m_loop = loop;
+    emit loopChanged();
+}
+
+void MqttReplay::setRunning(bool running)
+{
+    if (!m_complete) {
+        if (m_running != running) {
+            m_running = running;
+            emit runningChanged();
+        }
+        return;
+    }
+    if (running == m_running) return;
+    if (running) start();
+    else         stop();
+}
+
+void MqttReplay::componentComplete()
+{
+    m_complete = true;
+    if (m_running) start();
+}
+
+void MqttReplay::start()
+{
+    m_timer->stop();
+    m_hasPending = false;
+    m_injected = 0;
+    m_injectedBytes = 0;
+    m_positionUs = 0;
+
+    QString error;
+    const QString path = MqttCapture::localPath(m_source);
+    if (path.isEmpty() || !m_reader.open(path, &error)) {
+        abort(path.isEmpty() ? QStringLiteral("no source") : path + QStringLiteral(": ") + error);
+        return;
+    }
+    qDebug() << "⏯️ Replaying" << path << (m_reader.isBinary() ? "(capture)" : "(text)")
+             << "at" << m_speed << "x" << (m_loop ? "looped" : "");
+
+    m_passStartUs = 0;
+    m_clock.start();
+    if (!m_running) {
+        m_running = true;
+        emit runningChanged();
+    }
+    emit progressChanged();
+
+    if (!fetch()) {
+        abort(m_reader.errorString().isEmpty() ? QStringLiteral("no messages") : m_reader.errorString());
+        return;
+    }
+    m_timer->start(0);
+}
+
+void MqttReplay::stop()
+{
+    m_timer->stop();
+    m_reader.close();
+    m_hasPending = false;
+    if (m_running) {
+        m_running = false;
+        emit runningChanged();
+    }
+}
+
+void MqttReplay::abort(const QString &error)
+{
+    qWarning() << "⚠️ replay:" << error;
+    stop();
+    emit replayError(error);
+}
+
+bool MqttReplay::fetch()
+{
+    m_hasPending = m_reader.next(&m_pending);
+    return m_hasPending;
+}
+
+void MqttReplay::pump()
+{
+    if (!m_running) return;
+
+    const qint64 now = m_speed == 0 ? 0 : nowUs();
+    for (int n = 0; m_hasPending; ++n) {
+        if (m_speed == 0 ? n >= kBurst : m_passStartUs + m_pending.atUs > now)
+            break;
+        if (m_client) {
+            m_client->injectMessage(m_pending.topic, m_pending.payload);
+            ++m_injected;
+            m_injectedBytes += quint64(m_pending.payload.size());
+        }
+        m_positionUs = m_pending.atUs;
+        fetch();
+    }
+    emit progressChanged();
+
+    if (!m_hasPending) {
+        if (!m_reader.errorString().isEmpty()) {
+            abort(m_reader.errorString());
+            return;
+        }
+        if (!m_loop) {
+            stop();
+            emit finished();
+            return;
+        }
+        // Next pass starts where this one ended
+        m_passStartUs = m_speed == 0 ? 0 : nowUs();
+        if (!m_reader.rewind() || !fetch()) {
+            abort(m_reader.errorString());
+            return;
+        }
+    }
+
+    scheduleNext();
+}
+
+void MqttReplay::scheduleNext()
+{
+    if (!m_hasPending) return;
+    if (m_speed == 0) {
+        m_timer->start(0);
+        return;
+    }
+    const qint64 dueUs = m_passStartUs + m_pending.atUs;
+    m_timer->start(int(qMax<qint64>(0, dueUs - nowUs()) / 1000 / m_speed));
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QQmlParserStatus>
+#include <QString>
+#include <QTimer>
+#include "mqttcapture.h"
+
+class MQTTClient;
+
+// Plays a recorded session (MQTTClient.captureFile, or mosquitto_sub
+// text, see MqttCaptureReader) into an MQTTClient in place of the live
+// broker: every message goes through MQTTClient::injectMessage(), so
+// discovery, filtering, coalescing, tokenisation and batching all run as
+// they would for socket traffic. The client is not connected for this;
+// main.qml leaves it disconnected while a replay file is set.
+//
+// The file is streamed, not loaded: a capture of a large broker replays
+// in constant memory. speed 1 keeps the recorded spacing, 2 halves it;
+// speed 0 injects as fast as the event loop allows, in bursts so timers
+// and rendering still get a turn. With loop set the recording starts over
+// when it runs out, otherwise finished() is emitted and running drops.
+class MqttReplay : public QObject, public QQmlParserStatus
+{
+    Q_OBJECT
+    Q_INTERFACES(QQmlParserStatus)
+    Q_PROPERTY(MQTTClient *client READ client WRITE setClient NOTIFY clientChanged)
+    Q_PROPERTY(QString source  READ source  WRITE setSource  NOTIFY sourceChanged)
+    Q_PROPERTY(qreal   speed   READ speed   WRITE setSpeed   NOTIFY speedChanged)
+    Q_PROPERTY(bool    loop    READ loop    WRITE setLoop    NOTIFY loopChanged)
+    Q_PROPERTY(bool    running READ running WRITE setRunning NOTIFY runningChanged)
+    Q_PROPERTY(qint64  injectedMessages READ injectedMessages NOTIFY progressChanged)
+    Q_PROPERTY(qint64  position READ position NOTIFY progressChanged)   // ms into the recording
+
+public:
+    explicit MqttReplay(QObject *parent = nullptr);
+
+    MQTTClient *client() const { return m_client; }
+    QString source() const { return m_source; }
+    qreal   speed() const { return m_speed; }
+    bool    loop() const { return m_loop; }
+    bool    running() const { return m_running; }
+    qint64  injectedMessages() const { return qint64(m_injected); }
+    quint64 injectedBytes() const { return m_injectedBytes; }
+    qint64  position() const { return m_positionUs / 1000; }
+
+    // running set in QML waits for the other properties
+    void classBegin() override { m_complete = false; }
+    void componentComplete() override;
+
+public slots:
+    void setClient(MQTTClient *client);
+    // Path or file:// URL; a leading "~/" is the home directory
+    void setSource(const QString &source);
+    void setSpeed(qreal speed);
+    void setLoop(bool loop);
+    void setRunning(bool running);
+    // Reopens the source and plays it from the start
+    void start();
+    void stop();
+
+signals:
+    void clientChanged();
+    void sourceChanged();
+    void speedChanged();
+    void loopChanged();
+    void runningChanged();
+    void progressChanged();
+    void finished();
+    void replayError(const QString &error);
+
+private slots:
+    void pump();
+
+private:
+    // Replay time now, on the recording's clock
+    qint64 nowUs() const { return qint64(m_clock.nsecsElapsed() / 1000 * m_speed); }
+    bool fetch();
+    void scheduleNext();
+    void abort(const QString &error);
+
+    MqttCaptureReader    m_reader;
+    MqttCaptureRecord    m_pending;       // next record to inject
+    bool                 m_hasPending;
+    QPointer<MQTTClient> m_client;
+    QTimer              *m_timer;
+    QElapsedTimer        m_clock;
+    QString              m_source;
+    qreal                m_speed;
+    bool                 m_loop;
+    bool                 m_running;
+    bool                 m_complete;
+    qint64               m_passStartUs;   // replay time at which the current pass began
+    qint64               m_positionUs;
+    quint64              m_injected;
+    quint64              m_injectedBytes;
+};
@@ -0,0 +1,140 @@
+#include "mqttsubscriber.h"
+#include <QDebug>
+#include "memoryledger.h"
+
+namespace {
+// Enough for a Home Assistant restart replaying its retained configs.
+constexpr size_t kInboundCapacity = 4096;
+// Retained messages re-sent after SUBSCRIBE arrive within this window
+constexpr qint64 kReplayWindowMs = 5000;
+constexpr qsizetype kMaxTrackedTopics = 16384;
+}
+
+MqttSubscriber::MqttSubscriber(const MqttIngestStatsPtr &stats, QObject *parent)
+    : QObject(parent)
+    , m_coalesce(false)
+    , m_displayLength(1024)
+    , m_maxPayloadBytes(0)
+    , m_reconnectInterval(30000)
+    , m_captureCompressed(true)
+    , m_replaySkipped(0)
+    , m_stats(stats)
+    , m_inbound(kInboundCapacity)
+    , m_notifyPending(false)
+    , m_overflowPending(0)
+    , m_duplicatesPending(0)
+    , m_oversizedPending(0)
+    , m_overflowed(0)
+{
+}
+
+MqttSubscriber::~MqttSubscriber()
+{
+    // Whatever is still queued gives its bytes back to the ledger
+    clearInbound();
+}
+
+void MqttSubscriber::clearInbound()
+{
+    MqttInbound item;
+    while (pop(item)) {}
+    acknowledgeInbound();
+}
+
+bool MqttSubscriber::pop(MqttInbound &item)
+{
+    if (!m_inbound.pop(item)) return false;
+    MemoryLedger::instance().credit(item.footprint());
+    return true;
+}
+
+void MqttSubscriber::setTopics(const QList<MqttTopicSpec> &topics)
+{
+    m_topics = topics;
+    m_routes.clear();
+    for (qsizetype i = 0; i < topics.size(); ++i)
+        m_routes.insert(topics[i].filter, int(i));
+}
+
+void MqttSubscriber::setPayloadLimits(int displayLength, int maxBytes)
+{
+    m_displayLength = qMax(1, displayLength);
+    m_maxPayloadBytes = qMax(0, maxBytes);
+}
+
+void MqttSubscriber::startReplayWindow()
+{
+    if (!m_lastPayloads.isEmpty())
+        m_sinceReconnect.start();
+}
+
+void MqttSubscriber::resetPayloadHistory()
+{
+    m_lastPayloads.clear();
+    m_sinceReconnect.invalidate();
+}
+
+bool MqttSubscriber::admit(const QString &topic, const QByteArray &payload)
+{
+    m_stats->received.fetch_add(1, std::memory_order_relaxed);
+    m_stats->bytes.fetch_add(quint64(payload.size()), std::memory_order_relaxed);
+
+    // Rejected topics never get their payload decoded
+    if (m_filter && !m_filter->accepts(topic)) {
+        m_stats->filtered.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Too big to be worth decoding at all; checked before hashing it
+    if (m_maxPayloadBytes > 0 && payload.size() > m_maxPayloadBytes) {
+        m_oversizedPending.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Unchanged payloads were shown already: always when coalescing,
+    // otherwise only the retained replay right after a reconnect
+    if (isUnchangedPayload(topic, payload)) {
+        if (m_coalesce)
+            m_duplicatesPending.fetch_add(1, std::memory_order_relaxed);
+        else if ((m_replaySkipped++ % 256) == 0)
+            qDebug() << "♻️ Skipped" << m_replaySkipped << "replayed retained message(s)";
+        return false;
+    }
+    return true;
+}
+
+bool MqttSubscriber::isUnchangedPayload(const QString &topic, const QByteArray &payload)
+{
+    const size_t hash = qHash(payload);
+    auto it = m_lastPayloads.find(topic);
+    if (it == m_lastPayloads.end()) {
+        if (m_lastPayloads.size() >= kMaxTrackedTopics) m_lastPayloads.clear();
+        m_lastPayloads.insert(topic, hash);
+        return false;
+    }
+
+    const bool replay = m_sinceReconnect.isValid()
+                     && !m_sinceReconnect.hasExpired(kReplayWindowMs);
+    const bool unchanged = *it == hash && (m_coalesce || replay);
+    *it = hash;
+    return unchanged;
+}
+
+void MqttSubscriber::push(MqttInbound &&item)
+{
+    MemoryLedger &ledger = MemoryLedger::instance();
+    const qint64 bytes = item.footprint();
+    const bool charged = ledger.tryCharge(bytes);
+    if (!charged || !m_inbound.push(std::move(item))) {
+        // GUI thread is not keeping up; shed the newest rather than block the socket
+        if (charged) ledger.credit(bytes);
+        m_overflowPending.fetch_add(1, std::memory_order_relaxed);
+        if ((m_overflowed++ % 256) == 0)
+            qWarning() << (charged ? "⚠️ Inbound queue full, dropped" : "⚠️ Memory cap reached, dropped")
+                       << m_overflowed << "message(s) so far";
+        return;
+    }
+
+    if (!m_notifyPending.exchange(true, std::memory_order_acq_rel))
+        emit messagesAvailable();
+}
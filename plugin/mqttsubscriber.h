@@ -0,0 +1,154 @@
+#pragma once
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QSharedPointer>
+#include <QString>
+#include <atomic>
+#include "mqttpayload.h"
+#include "payloadextractor.h"
+#include "payloadtokenizer.h"
+#include "spscqueue.h"
+#include "topicfilter.h"
+#include "topictrie.h"
+
+// One filtered and tokenised message, ready for QML. The payload stays
+// in its received bytes; only the display form is decoded.
+struct MqttInbound
+{
+    QString          topic;
+    MqttPayload      payload;
+    TokenizedPayload display;
+
+    // Bytes charged to the MemoryLedger while it sits in a queue or a
+    // map; the topic is interned and charged once by TopicInterner
+    qint64 footprint() const
+    {
+        return payload.size() + qint64(display.text.size()) * 2 + display.flags.size();
+    }
+};
+
+// One entry of MQTTClient.topics: a topic filter and its subscription QoS.
+struct MqttTopicSpec
+{
+    QString filter;
+    quint8  qos = 0;
+};
+
+// Cumulative ingest counters for the debug overlay. Written on the
+// connection thread and polled by MQTTClient as relaxed atomics; owned
+// by MQTTClient so the totals survive rebuilding the connection.
+struct MqttIngestStats
+{
+    std::atomic<quint64> received { 0 };     // every PUBLISH for us, before filtering
+    std::atomic<quint64> filtered { 0 };     // rejected by the topic filter, or no extracted field
+    std::atomic<quint64> bytes { 0 };        // payload bytes of received
+    std::atomic<quint64> tokenized { 0 };    // payloads decoded and tokenised
+    std::atomic<quint64> tokenizeNs { 0 };   // time spent on those
+    std::atomic<quint64> extracted { 0 };    // of those, reduced to fields by a PayloadExtractor
+    std::atomic<quint64> reconnects { 0 };   // successful re-connections
+    std::atomic<qint64>  connackMs { -1 };   // CONNECT → CONNACK, last connection
+};
+using MqttIngestStatsPtr = QSharedPointer<MqttIngestStats>;
+
+// One MQTTClient's share of an MqttConnection: the topics it subscribed
+// to, how it filters, dedups and decodes what arrives on them, and the
+// queue its finished messages go back through. A private connection has
+// one subscriber; a shared one (MqttConnectionPool) has one per
+// wallpaper instance on the same broker.
+//
+// Created and owned by MQTTClient on the GUI thread and attached to at
+// most one connection at a time. The ingest state is only touched on the
+// connection's thread, by MqttConnection; the GUI side drains inbound()
+// and takes the counters. Signals are emitted on the connection's thread
+// and reach MQTTClient queued.
+class MqttSubscriber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MqttSubscriber(const MqttIngestStatsPtr &stats, QObject *parent = nullptr);
+    ~MqttSubscriber() override;
+
+    // Consumer side, GUI thread only.
+    SpscQueue<MqttInbound> &inbound() { return m_inbound; }
+    // Pops from inbound() and credits the MemoryLedger; use instead of
+    // inbound().pop()
+    bool pop(MqttInbound &item);
+    // Re-arms messagesAvailable(); call before draining inbound().
+    void acknowledgeInbound() { m_notifyPending.store(false, std::memory_order_release); }
+    // Messages shed because inbound() was full since the last call.
+    quint64 takeOverflowed() { return m_overflowPending.exchange(0, std::memory_order_acq_rel); }
+    // Unchanged payloads dropped by coalescing since the last call.
+    quint64 takeDuplicates() { return m_duplicatesPending.exchange(0, std::memory_order_acq_rel); }
+    // Payloads over the byte limit skipped since the last call.
+    quint64 takeOversized() { return m_oversizedPending.exchange(0, std::memory_order_acq_rel); }
+    // Drops whatever is still queued; only while detached
+    void clearInbound();
+
+    // Connection thread only (or any thread while detached).
+    const QList<MqttTopicSpec> &topics() const { return m_topics; }
+    void setTopics(const QList<MqttTopicSpec> &topics);
+    // True when one of topics() matches
+    bool wants(QStringView topic) const { return m_routes.match(topic) >= 0; }
+    void setFilter(const TopicFilterPtr &filter) { m_filter = filter; }
+    // Field selection per topic, in place of tokenising whole payloads
+    void setExtractor(const PayloadExtractorPtr &extractor) { m_extractor = extractor; }
+    const PayloadExtractor *extractor() const { return m_extractor.data(); }
+    // Drop unchanged payloads per topic at all times
+    void setCoalesce(bool enabled) { m_coalesce = enabled; }
+    // displayLength in UTF-16 units (>= 1); maxBytes 0 accepts any size
+    void setPayloadLimits(int displayLength, int maxBytes);
+    int  displayLength() const { return m_displayLength; }
+    int  reconnectInterval() const { return m_reconnectInterval; }
+    void setReconnectInterval(int interval) { m_reconnectInterval = interval; }
+    QString capturePath() const { return m_capturePath; }
+    bool    captureCompressed() const { return m_captureCompressed; }
+    void setCapture(const QString &path, bool compress) { m_capturePath = path; m_captureCompressed = compress; }
+    MqttIngestStats &stats() { return *m_stats; }
+
+    // The broker's retained replay after a re-connection shows nothing new
+    void startReplayWindow();
+    // Forget what was shown: another broker, or a fresh attach
+    void resetPayloadHistory();
+    // Topic filter and payload limits, in that order. Returns false (and
+    // counts why) when the message goes no further.
+    bool admit(const QString &topic, const QByteArray &payload);
+    // Hands a finished message to the GUI thread; shed when the queue is
+    // full or the MemoryLedger is at its cap
+    void push(MqttInbound &&item);
+
+signals:
+    void connectedChanged(bool connected);
+    void reconnecting(int delayMs);
+    void connectionError(const QString &error);
+    void messagesAvailable();
+    void discoveredEntitiesChanged(int count);
+
+private:
+    bool isUnchangedPayload(const QString &topic, const QByteArray &payload);
+
+    QList<MqttTopicSpec>    m_topics;
+    TopicTrie               m_routes;
+    TopicFilterPtr          m_filter;
+    PayloadExtractorPtr     m_extractor;
+    bool                    m_coalesce;
+    int                     m_displayLength;
+    int                     m_maxPayloadBytes;
+    int                     m_reconnectInterval;
+    QString                 m_capturePath;
+    bool                    m_captureCompressed;
+    QHash<QString, size_t>  m_lastPayloads;     // topic → payload hash
+    QElapsedTimer           m_sinceReconnect;   // valid after a re-connection
+    quint64                 m_replaySkipped;
+
+    MqttIngestStatsPtr      m_stats;
+    SpscQueue<MqttInbound>  m_inbound;
+    std::atomic<bool>       m_notifyPending;
+    std::atomic<quint64>    m_overflowPending;
+    std::atomic<quint64>    m_duplicatesPending;
+    std::atomic<quint64>    m_oversizedPending;
+    quint64                 m_overflowed;       // connection-side total, for logging
+};
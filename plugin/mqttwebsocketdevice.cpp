@@ -0,0 +1,55 @@
+#include "mqttwebsocketdevice.h"
+#include <QNetworkRequest>
+#include <cstring>
+
+MqttWebSocketDevice::MqttWebSocketDevice(QObject *parent)
+    : QIODevice(parent)
+    , m_socket(QString(), QWebSocketProtocol::VersionLatest, this)
+{
+    connect(&m_socket, &QWebSocket::connected, this, [this]() {
+        QIODevice::open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+        emit connected();
+    });
+    connect(&m_socket, &QWebSocket::disconnected, this, [this]() {
+        QIODevice::close();
+        emit disconnected();
+    });
+    connect(&m_socket, &QWebSocket::errorOccurred, this, [this](QAbstractSocket::SocketError error) {
+        setErrorString(m_socket.errorString());
+        emit errorOccurred(error);
+    });
+    connect(&m_socket, &QWebSocket::sslErrors, this, &MqttWebSocketDevice::sslErrors);
+    connect(&m_socket, &QWebSocket::binaryMessageReceived, this, [this](const QByteArray &frame) {
+        m_buffer.append(frame);
+        emit readyRead();
+    });
+}
+
+void MqttWebSocketDevice::open(const QUrl &url)
+{
+    QNetworkRequest request(url);
+    request.setRawHeader("Sec-WebSocket-Protocol", "mqtt");
+    m_buffer.clear();
+    m_socket.open(request);
+}
+
+void MqttWebSocketDevice::close()
+{
+    m_socket.close();
+    QIODevice::close();
+}
+
+qint64 MqttWebSocketDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 n = qMin<qint64>(maxSize, m_buffer.size());
+    if (n <= 0) return 0;
+    std::memcpy(data, m_buffer.constData(), size_t(n));
+    m_buffer.remove(0, n);
+    return n;
+}
+
+qint64 MqttWebSocketDevice::writeData(const char *data, qint64 size)
+{
+    // One MQTT packet per write from QMqttClient: one frame each
+    return m_socket.sendBinaryMessage(QByteArray(data, size));
+}
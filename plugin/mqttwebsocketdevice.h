@@ -0,0 +1,46 @@
+#pragma once
+#include <QByteArray>
+#include <QIODevice>
+#include <QSslConfiguration>
+#include <QUrl>
+#include <QWebSocket>
+
+// QIODevice over a QWebSocket, so QMqttClient can speak MQTT over ws://
+// and wss:// through its IODevice transport: each write goes out as one
+// binary frame, received frames are concatenated into the read buffer
+// (MQTT packets may span or share frames). Negotiates the "mqtt"
+// subprotocol, as brokers and reverse proxies expect. Socket errors are
+// copied into QIODevice::errorString() before errorOccurred() is emitted.
+class MqttWebSocketDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    explicit MqttWebSocketDevice(QObject *parent = nullptr);
+
+    // Applies to wss:// only
+    void setSslConfiguration(const QSslConfiguration &config) { m_socket.setSslConfiguration(config); }
+    QSslConfiguration sslConfiguration() const { return m_socket.sslConfiguration(); }
+
+    // Opens the device once the handshake is done, then emits connected()
+    void open(const QUrl &url);
+    void close() override;
+    void abort() { m_socket.abort(); }
+
+    bool isSequential() const override { return true; }
+    qint64 bytesAvailable() const override { return m_buffer.size() + QIODevice::bytesAvailable(); }
+
+signals:
+    void connected();
+    void disconnected();
+    void errorOccurred(QAbstractSocket::SocketError error);
+    void sslErrors(const QList<QSslError> &errors);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 size) override;
+
+private:
+    QWebSocket m_socket;
+    QByteArray m_buffer;
+};
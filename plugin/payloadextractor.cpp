@@ -0,0 +1,166 @@
+#include "payloadextractor.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocale>
+#include <QRegularExpression>
+#include <cmath>
+
+namespace {
+
+// Walks a dotted path: keys into objects, indices into arrays
+QJsonValue lookup(QJsonValue value, const QStringList &path)
+{
+    for (const QString &key : path) {
+        if (value.isObject()) {
+            value = value.toObject().value(key);
+        } else if (value.isArray()) {
+            bool ok = false;
+            const int index = key.toInt(&ok);
+            const QJsonArray array = value.toArray();
+            if (!ok || index < 0 || index >= array.size()) return QJsonValue(QJsonValue::Undefined);
+            value = array.at(index);
+        } else {
+            return QJsonValue(QJsonValue::Undefined);
+        }
+    }
+    return value;
+}
+
+// Strings without their quotes, integral numbers without an exponent
+QString valueText(const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::String:
+        return value.toString();
+    case QJsonValue::Double: {
+        const double d = value.toDouble();
+        if (std::floor(d) == d && std::fabs(d) < 9007199254740992.0)   // 2^53
+            return QString::number(qint64(d));
+        return QString::number(d, 'g', QLocale::FloatingPointShortest);
+    }
+    case QJsonValue::Bool:
+        return value.toBool() ? QStringLiteral("true") : QStringLiteral("false");
+    case QJsonValue::Null:
+        return QStringLiteral("null");
+    case QJsonValue::Array:
+        return QString::fromUtf8(QJsonDocument(value.toArray()).toJson(QJsonDocument::Compact));
+    case QJsonValue::Object:
+        return QString::fromUtf8(QJsonDocument(value.toObject()).toJson(QJsonDocument::Compact));
+    case QJsonValue::Undefined:
+        break;
+    }
+    return QString();
+}
+
+} // namespace
+
+PayloadExtractor::PayloadExtractor(const QString &rules)
+{
+    static const QRegularExpression separators(QStringLiteral("[\\n;]"));
+    for (const QString &line : rules.split(separators, Qt::SkipEmptyParts)) {
+        if (line.trimmed().isEmpty()) continue;
+        Rule rule;
+        if (!parseRule(line, &rule) || !m_trie.insert(rule.filter, int(m_rules.size()))) {
+            qWarning() << "⚠️ payload extractor: ignoring rule" << line.trimmed();
+            continue;
+        }
+        m_rules.append(rule);
+    }
+}
+
+bool PayloadExtractor::parseRule(QStringView line, Rule *rule)
+{
+    const qsizetype eq = line.indexOf(u'=');
+    if (eq <= 0) return false;
+    rule->filter = line.left(eq).trimmed().toString();
+    const QStringView spec = line.mid(eq + 1).trimmed();
+    if (!TopicTrie::isValidFilter(rule->filter) || spec.isEmpty()) return false;
+
+    auto splitPath = [](QStringView path) {
+        return path.trimmed().toString().split(u'.', Qt::SkipEmptyParts);
+    };
+
+    rule->labelled = !spec.contains(u'{');
+    if (rule->labelled) {
+        for (QStringView name : spec.tokenize(u',')) {
+            Field field;
+            field.path = splitPath(name);
+            if (!field.path.isEmpty()) rule->fields.append(field);
+        }
+        return !rule->fields.isEmpty();
+    }
+
+    // Template: literal text with {path} placeholders
+    qsizetype from = 0;
+    while (from < spec.size()) {
+        const qsizetype open = spec.indexOf(u'{', from);
+        if (open < 0) break;
+        const qsizetype close = spec.indexOf(u'}', open + 1);
+        if (close < 0) return false;
+        Field field;
+        field.literal = spec.mid(from, open - from).toString();
+        field.path = splitPath(spec.mid(open + 1, close - open - 1));
+        if (field.path.isEmpty()) return false;
+        rule->fields.append(field);
+        from = close + 1;
+    }
+    rule->tail = spec.mid(from).toString();
+    return !rule->fields.isEmpty();
+}
+
+PayloadExtractor::Result PayloadExtractor::extract(QStringView topic, const QByteArray &payload,
+                                                   int displayLength, TokenizedPayload *display) const
+{
+    const int id = m_trie.match(topic);
+    if (id < 0) return Unmatched;
+
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(payload, &error);
+    if (error.error != QJsonParseError::NoError || !(doc.isObject() || doc.isArray()))
+        return Unmatched;
+    const QJsonValue root = doc.isObject() ? QJsonValue(doc.object()) : QJsonValue(doc.array());
+
+    const Rule &rule = m_rules[id];
+    QString    text;
+    QByteArray flags;
+    auto append = [&](QStringView s, char flag) {
+        text.append(s);
+        flags.append(s.size(), flag);
+    };
+
+    int found = 0;
+    for (const Field &field : rule.fields) {
+        const QJsonValue value = lookup(root, field.path);
+        const bool present = !value.isUndefined();
+        if (rule.labelled) {
+            if (!present) continue;
+            if (found > 0) append(u" ", 0);
+            append(field.path.last(), 0);
+            append(u":", 0);
+        } else {
+            append(field.literal, 0);
+        }
+        if (present) {
+            append(valueText(value), 1);
+            ++found;
+        }
+    }
+    if (found == 0) return Empty;
+    append(rule.tail, 0);
+
+    if (text.size() > displayLength) {
+        qsizetype n = qMax(1, displayLength);
+        if (text.at(n - 1).isHighSurrogate()) --n;
+        text.truncate(n);
+        flags.truncate(n);
+        append(u"…", 0);
+    }
+    append(u"/", 0);   // separator, tagged as structure
+
+    display->text  = text;
+    display->flags = flags;
+    return Extracted;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QStringView>
+#include "payloadtokenizer.h"
+#include "topictrie.h"
+
+// Compiled field selection for JSON payloads, per topic filter.
+//
+// One rule per line (or ';'-separated), "filter = fields":
+//
+//   zigbee2mqtt/+ = temperature, humidity, state
+//   weather/#     = {main.temp}°C {wind.speed} m/s
+//
+// A comma list shows each field as "key:value", space-separated; a
+// template (anything with "{path}") substitutes the fields into its
+// literal text. Paths are dotted keys, numbers index arrays
+// ("sensors.0.value"). Filters use MQTT wildcards through a TopicTrie;
+// the first rule for a filter wins.
+//
+// The display form is built once at ingest, instead of tokenising the
+// whole payload: values are tagged as values, keys and literal text as
+// structure, and a '/' separator is appended, as PayloadTokenizer does.
+// Payloads that are not a JSON object or array are left to the
+// tokenizer; an object with none of the fields yields Empty and the
+// message is dropped (zigbee2mqtt's linkquality-only updates).
+//
+// Immutable once built: MQTTClient builds a new one on every change and
+// hands it to the connection thread, like TopicFilter.
+class PayloadExtractor
+{
+public:
+    enum Result {
+        Unmatched,   // no rule for the topic, or not JSON: tokenise as usual
+        Extracted,   // display holds the selected fields
+        Empty        // a rule matched, but the payload has none of its fields
+    };
+
+    explicit PayloadExtractor(const QString &rules);
+
+    bool isEmpty() const { return m_rules.isEmpty(); }
+    int  ruleCount() const { return int(m_rules.size()); }
+
+    // displayLength caps the text like the tokenizer's prefix (… marks the cut)
+    Result extract(QStringView topic, const QByteArray &payload, int displayLength,
+                   TokenizedPayload *display) const;
+
+private:
+    struct Field
+    {
+        QStringList path;      // split once, at compile time
+        QString     literal;   // template text before the field
+    };
+
+    struct Rule
+    {
+        QString      filter;
+        QList<Field> fields;
+        QString      tail;      // template text after the last field
+        bool         labelled;  // comma list: "key:value"
+    };
+
+    static bool parseRule(QStringView line, Rule *rule);
+
+    QList<Rule> m_rules;
+    TopicTrie   m_trie;
+};
+
+using PayloadExtractorPtr = QSharedPointer<const PayloadExtractor>;
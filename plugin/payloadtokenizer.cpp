@@ -0,0 +1,127 @@
+#include "payloadtokenizer.h"
+#include <QVarLengthArray>
+#include <cstring>
+
+QVariantMap TokenizedPayload::toVariant() const
+{
+    return QVariantMap {
+        { QStringLiteral("text"),  text  },
+        { QStringLiteral("flags"), flags },
+    };
+}
+
+TokenizedPayload PayloadTokenizer::tokenize(QStringView payload, bool truncated)
+{
+    TokenizedPayload out;
+
+    // Skip empty or whitespace-only payloads
+    const QStringView trimmed = payload.trimmed();
+    if (trimmed.isEmpty()) return out;
+
+    out.text.reserve(payload.size() + 2);
+    out.text.append(payload);
+    if (truncated) out.text.append(u'…');
+    out.text.append(u'/');   // separator, tagged as structure
+    out.flags = QByteArray(out.text.size(), '\0');
+
+    char *flags = out.flags.data();
+    const QChar first = trimmed.front();
+    const bool structured = (first == u'{' || first == u'[');
+
+    // Plain string, scalar or malformed JSON: all as value
+    if (!structured || !colorJson(payload, flags, truncated))
+        std::memset(flags, 1, size_t(payload.size()));
+
+    return out;
+}
+
+// Tags value characters in flags (already zeroed) and reports whether the
+// input is structurally valid JSON (or, when truncated, a valid prefix of
+// it). Tagging rules are identical to the JS state machine, including its
+// treatment of strings inside arrays.
+bool PayloadTokenizer::colorJson(QStringView json, char *flags, bool truncated)
+{
+    enum State { Struct, InKey, InValStr, InValNum };
+
+    State state = Struct;
+    bool  afterColon = false;
+    bool  escaped = false;
+    bool  closed = false;       // top-level container already closed
+    int   arrayDepth = 0;
+    QVarLengthArray<char16_t, 32> open;
+
+    auto close = [&](char16_t expected) {
+        if (open.isEmpty() || open.last() != expected) return false;
+        open.removeLast();
+        closed = open.isEmpty();
+        return true;
+    };
+
+    for (qsizetype i = 0; i < json.size(); ++i) {
+        const char16_t ch = json[i].unicode();
+
+        switch (state) {
+        case Struct:
+            if (ch == u' ' || ch == u'\t' || ch == u'\n' || ch == u'\r')
+                break;
+            if (closed) return false;   // trailing garbage after the document
+
+            if (ch == u'"') {
+                escaped = false;
+                if (afterColon || arrayDepth > 0) {
+                    state = InValStr;
+                    afterColon = false;
+                    flags[i] = 1;
+                } else {
+                    state = InKey;
+                }
+            } else if (ch == u'[') {
+                ++arrayDepth;
+                afterColon = false;
+                open.append(u']');
+            } else if (ch == u']') {
+                if (arrayDepth > 0) --arrayDepth;
+                if (!close(u']')) return false;
+            } else if (ch == u'{') {
+                afterColon = false;
+                open.append(u'}');
+            } else if (ch == u'}') {
+                afterColon = false;
+                if (!close(u'}')) return false;
+            } else if (ch == u',') {
+                afterColon = false;
+            } else if (ch == u':') {
+                afterColon = true;
+            } else if (afterColon || arrayDepth > 0) {
+                state = InValNum;
+                afterColon = false;
+                flags[i] = 1;
+            }
+            break;
+
+        case InKey:
+            if (ch == u'"' && !escaped) state = Struct;
+            escaped = (ch == u'\\' && !escaped);
+            break;
+
+        case InValStr:
+            flags[i] = 1;
+            if (ch == u'"' && !escaped) state = Struct;
+            escaped = (ch == u'\\' && !escaped);
+            break;
+
+        case InValNum:
+            if (ch == u',' || ch == u'}' || ch == u']') {
+                state = Struct;
+                afterColon = false;
+                if (ch == u']' && arrayDepth > 0) --arrayDepth;
+                if (ch != u',' && !close(ch)) return false;
+            } else {
+                flags[i] = 1;
+            }
+            break;
+        }
+    }
+
+    return truncated || (state == Struct && open.isEmpty());
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+#include <QVariantMap>
+
+// Display form of one MQTT payload: the characters to rain down plus one
+// flag byte per UTF-16 unit (1 = JSON value, drawn lightened; 0 = key or
+// structure). Replaces the per-character {ch, isValue} JS objects.
+struct TokenizedPayload
+{
+    QString    text;
+    QByteArray flags;
+
+    bool isEmpty() const { return text.isEmpty(); }
+
+    // {"text": QString, "flags": QByteArray} — arrives in JS as a string
+    // and an ArrayBuffer (see MatrixRainLogic.buildDisplayChars).
+    QVariantMap toVariant() const;
+};
+
+// Single-pass port of MatrixRainLogic.colorJsonChars.
+//
+// JSON objects/arrays get key/value tagging, anything else (scalars,
+// plain text, malformed JSON) is tagged as value throughout, and a '/'
+// separator is appended. Instead of a full JSON.parse up front, the
+// state machine tracks bracket balance and string termination itself
+// and falls back to "all value" when the payload does not hold together.
+//
+// A truncated payload is the prefix of a longer one: containers and
+// strings left open at its end are expected and keep their tagging, and
+// "…" goes before the separator.
+class PayloadTokenizer
+{
+public:
+    static TokenizedPayload tokenize(QStringView payload, bool truncated = false);
+
+private:
+    static bool colorJson(QStringView json, char *flags, bool truncated);
+};
@@ -1,6 +1,5 @@
 #include <QQmlExtensionPlugin>
-#include <QQmlEngine>
-#include "mqttclient.h"
+#include "registertypes.h"
 
 class MQTTRainPlugin : public QQmlExtensionPlugin
 {
@@ -11,7 +10,7 @@ public:
     void registerTypes(const char *uri) override
     {
         Q_ASSERT(uri == QLatin1String("ObsidianReq.MQTTRain"));
-        qmlRegisterType<MQTTClient>(uri, 1, 0, "MQTTClient");
+        registerMqttRainTypes(uri);
     }
 };
 
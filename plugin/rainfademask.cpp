@@ -0,0 +1,105 @@
+#include "rainfademask.h"
+#include <QQuickWindow>
+#include <QRunnable>
+#include <QSGTexture>
+#include <QSGTextureProvider>
+
+class FadeMaskProvider : public QSGTextureProvider
+{
+public:
+    ~FadeMaskProvider() override { delete m_texture; }
+
+    QSGTexture *texture() const override { return m_texture; }
+
+    void setTexture(QSGTexture *texture)
+    {
+        delete m_texture;
+        m_texture = texture;
+        if (m_texture) {
+            m_texture->setFiltering(QSGTexture::Nearest);
+            m_texture->setHorizontalWrapMode(QSGTexture::ClampToEdge);
+            m_texture->setVerticalWrapMode(QSGTexture::ClampToEdge);
+        }
+        emit textureChanged();
+    }
+
+private:
+    QSGTexture *m_texture = nullptr;
+};
+
+RainFadeMask::RainFadeMask(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_mask(1, 1, QImage::Format_Grayscale8)
+    , m_dirty(true)
+    , m_touched(false)
+    , m_provider(nullptr)
+{
+    setFlag(ItemHasContents, true);
+    m_mask.fill(255);
+}
+
+RainFadeMask::~RainFadeMask()
+{
+    // Only reached with a live provider when the item never had a window;
+    // otherwise releaseResources() already handed it to the render thread.
+    delete m_provider;
+}
+
+void RainFadeMask::resizeGrid(int cols, int rows, qreal cellSize)
+{
+    cols = qMax(1, cols);
+    rows = qMax(1, rows);
+    setSize(QSizeF(cols * cellSize, rows * cellSize));
+
+    if (m_mask.width() != cols || m_mask.height() != rows)
+        m_mask = QImage(cols, rows, QImage::Format_Grayscale8);
+    m_mask.fill(255);
+    m_touched = false;
+    m_dirty = true;
+    update();
+}
+
+void RainFadeMask::darken(int col, int row, float keep)
+{
+    if (col < 0 || row < 0 || col >= m_mask.width() || row >= m_mask.height()) return;
+    uchar *texel = m_mask.scanLine(row) + col;
+    *texel = uchar(qBound(0.0f, *texel * keep + 0.5f, 255.0f));
+    m_touched = true;
+    m_dirty = true;
+    update();
+}
+
+void RainFadeMask::reset()
+{
+    if (!m_touched) return;
+    m_mask.fill(255);
+    m_touched = false;
+    m_dirty = true;
+    update();
+}
+
+QSGTextureProvider *RainFadeMask::textureProvider() const
+{
+    if (!m_provider) m_provider = new FadeMaskProvider;
+    return m_provider;
+}
+
+QSGNode *RainFadeMask::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    // Nothing is drawn: the item only feeds its texture to the trail shader.
+    if (m_dirty || !textureProvider()->texture()) {
+        m_provider->setTexture(window()->createTextureFromImage(m_mask));
+        m_dirty = false;
+    }
+    return oldNode;
+}
+
+void RainFadeMask::releaseResources()
+{
+    if (!m_provider) return;
+    FadeMaskProvider *provider = m_provider;
+    m_provider = nullptr;
+    m_dirty = true;
+    window()->scheduleRenderJob(QRunnable::create([provider]() { delete provider; }),
+                                QQuickWindow::BeforeSynchronizingStage);
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <QImage>
+#include <QQuickItem>
+
+class FadeMaskProvider;
+
+// Per-cell fade multipliers for the GPU trail pass, exposed to QML as a
+// texture provider (one Grayscale8 texel per grid cell, 255 = no extra
+// fade). MatrixRainItem writes into it from darkenRect() in GpuFade mode;
+// the trail shader multiplies the previous frame by it, so accelerated
+// fades cost one byte write instead of extra draw calls.
+class RainFadeMask : public QQuickItem
+{
+    Q_OBJECT
+
+public:
+    explicit RainFadeMask(QQuickItem *parent = nullptr);
+    ~RainFadeMask() override;
+
+    // Resizes the mask to cols × rows cells; the item itself is sized to
+    // the covered pixel area so QML can derive the sampling scale from it.
+    void resizeGrid(int cols, int rows, qreal cellSize);
+    void darken(int col, int row, float keep);
+    // Restores every texel to 255 (no-op when nothing was darkened).
+    void reset();
+
+    bool                isTextureProvider() const override { return true; }
+    QSGTextureProvider *textureProvider() const override;
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void     releaseResources() override;
+
+private:
+    QImage                    m_mask;
+    bool                      m_dirty;
+    bool                      m_touched;
+    mutable FadeMaskProvider *m_provider;
+};
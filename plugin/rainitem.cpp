@@ -0,0 +1,680 @@
+#include "rainitem.h"
+#include "columnkernels.h"
+#include "columnstate.h"
+#include "glyphmaterial.h"
+#include "rainfademask.h"
+#include "rainpainter.h"
+#include "tilepool.h"
+#include <QDebug>
+#include <QQmlEngine>
+#include <QQuickWindow>
+#include <QSGGeometryNode>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Cells dimmer than this are dropped from the batch (below one 8-bit step,
+// so they would not be visible anyway).
+constexpr float kMinIntensity = 1.0f / 255.0f;
+
+// Grid columns per TilePool tile: eight tiles at 1080p, sixteen at 4K
+constexpr int kTileColumns = 16;
+// Below this the pool's wake-ups cost more than the pass itself
+constexpr int kMinParallelCells = 16384;
+
+// Bytes of one column array, for a typed-array view in JS
+template <typename T>
+QByteArray columnBytes(const std::vector<T> &v)
+{
+    return QByteArray(reinterpret_cast<const char *>(v.data()), qsizetype(v.size() * sizeof(T)));
+}
+
+class RainNode : public QSGGeometryNode
+{
+public:
+    RainNode()
+        : geometry(GlyphMaterial::attributes(), 0, 0, QSGGeometry::UnsignedIntType)
+        , atlasGeneration(0)
+    {
+        geometry.setDrawingMode(QSGGeometry::DrawTriangles);
+        setGeometry(&geometry);
+        setMaterial(&material);
+    }
+
+    QSGGeometry   geometry;
+    GlyphMaterial material;
+    quint64       atlasGeneration;
+};
+
+} // namespace
+
+MatrixRainItem::MatrixRainItem(QQuickItem *parent)
+    : QQuickItem(parent)
+    , m_frameTimer(new QTimer(this))
+    , m_painter(new RainPainter(this))
+    , m_fadeMask(new RainFadeMask(this))
+    , m_rendererBound(false)
+    , m_loggedJsError(false)
+    , m_skipInactive(false)
+    , m_gridCols(0)
+    , m_gridRows(0)
+    , m_renderThreads(0)
+    , m_rng()
+    , m_seed(0)
+    , m_fontSize(16)
+    , m_speed(50)
+    , m_fadeStrength(0.05)
+    , m_fadeMode(CellFade)
+    , m_running(true)
+    , m_idle(false)
+    , m_stamps(0)
+    , m_quietTicks(0)
+    , m_hadGlyphs(false)
+    , m_tick(0)
+    , m_uploadNs(0)
+    , m_profiling(false)
+{
+    setFlag(ItemHasContents, true);
+    QJSEngine::setObjectOwnership(m_painter, QJSEngine::CppOwnership);
+
+    m_atlas.setFontSize(m_fontSize);
+
+    applyFrameInterval();
+    connect(m_frameTimer, &QTimer::timeout, this, &MatrixRainItem::advanceFrame);
+    m_frameTimer->start();
+}
+
+MatrixRainItem::~MatrixRainItem() = default;
+
+void MatrixRainItem::setFontSize(int size)
+{
+    size = qMax(1, size);
+    if (m_fontSize == size) return;
+    m_fontSize = size;
+    m_atlas.setFontSize(size);
+    // Atlas slots were renumbered; stale glyph indices must not survive.
+    m_cells.fill(Cell{});
+    emit fontSizeChanged();
+    initDrops();
+}
+
+void MatrixRainItem::setSpeed(int speed)
+{
+    speed = qMax(1, speed);
+    if (m_speed == speed) return;
+    m_speed = speed;
+    applyFrameInterval();
+    emit speedChanged();
+}
+
+void MatrixRainItem::setAdaptiveQuality(bool enabled)
+{
+    if (m_governor.enabled() == enabled) return;
+    const int before = m_governor.level();
+    m_governor.setEnabled(enabled);
+    applyFrameInterval();
+    emit adaptiveQualityChanged();
+    if (m_governor.level() != before) emit qualityLevelChanged();
+}
+
+void MatrixRainItem::setRenderThreads(int threads)
+{
+    threads = qMax(0, threads);
+    if (m_renderThreads == threads) return;
+    m_renderThreads = threads;
+    qDebug() << "[MQTTRain] render threads:" << (threads > 0 ? threads : TilePool::instance().maxThreads())
+             << (threads > 0 ? "" : "(one per core)");
+    emit renderThreadsChanged();
+}
+
+void MatrixRainItem::forEachTile(const std::function<void(int, int, int)> &fn) const
+{
+    const int threads = m_cells.size() < kMinParallelCells ? 1 : m_renderThreads;
+    TilePool::instance().run(int(m_tileQuads.size()), threads, [&](int tile) {
+        const int first = tile * kTileColumns;
+        fn(tile, first, qMin(m_gridCols, first + kTileColumns));
+    });
+}
+
+void MatrixRainItem::applyFrameInterval()
+{
+    const int nominal = 1000 / m_speed;
+    m_governor.setIntervalMs(nominal);
+    m_frameTimer->setInterval(int(nominal * m_governor.intervalFactor()));
+}
+
+void MatrixRainItem::setFadeStrength(qreal strength)
+{
+    if (qFuzzyCompare(m_fadeStrength, strength)) return;
+    m_fadeStrength = strength;
+    if (m_renderer && m_renderer->property("fadeStrength").isValid())
+        m_renderer->setProperty("fadeStrength", strength);
+    emit fadeStrengthChanged();
+}
+
+void MatrixRainItem::setRunning(bool running)
+{
+    if (running == m_running) return;
+    m_running = running;
+    if (running && !m_idle) m_frameTimer->start();
+    else                    m_frameTimer->stop();
+    emit runningChanged();
+}
+
+void MatrixRainItem::setActiveRenderer(QObject *renderer)
+{
+    if (m_renderer == renderer) return;
+    m_renderer = renderer;
+    m_rendererBound = false;
+    m_loggedJsError = false;
+    if (m_columnState) disconnect(m_columnState, nullptr, this, nullptr);
+    m_columnState = nullptr;
+    m_skipInactive = false;
+    m_rendererJs = QJSValue();
+    m_fnRenderColumn = QJSValue();
+    m_fnColumnWrap = QJSValue();
+    m_fnInlineChars = QJSValue();
+    emit activeRendererChanged();
+
+    initializeRenderer();
+    wake();
+}
+
+void MatrixRainItem::setFadeMode(FadeMode mode)
+{
+    if (m_fadeMode == mode) return;
+    m_fadeMode = mode;
+    // Neither trail representation can be carried over to the other.
+    m_cells.fill(Cell{});
+    m_fadeMask->reset();
+    emit fadeModeChanged();
+    update();
+    wake();
+}
+
+void MatrixRainItem::setColors(const QVariantList &colors)
+{
+    if (m_colors == colors) return;
+    m_colors = colors;
+    m_painter->setPalette(colors);
+    emit colorsChanged();
+}
+
+void MatrixRainItem::setSeed(int seed)
+{
+    if (m_seed == seed) return;
+    m_seed = seed;
+    emit seedChanged();
+    initDrops();
+}
+
+void MatrixRainItem::setProfiling(bool enabled)
+{
+    if (m_profiling == enabled) return;
+    m_profiling = enabled;
+    m_timings.clear();
+}
+
+// One base seed, one stream per consumer so their sequences never overlap
+void MatrixRainItem::reseed()
+{
+    const quint64 base = m_seed != 0 ? quint64(quint32(m_seed))
+                                     : QRandomGenerator::system()->generate64();
+    m_rng.reseed(base, 0);
+    m_painter->reseed(base, 1);
+    if (m_columnState) m_columnState->reseed(base, 2);
+}
+
+QQuickItem *MatrixRainItem::fadeMask() const
+{
+    return m_fadeMask;
+}
+
+void MatrixRainItem::initDrops()
+{
+    if (width() <= 0 || height() <= 0) return;
+
+    const int cols = int(width() / m_fontSize);
+    const bool changed = cols != columns();
+
+    // Seeded runs restart their sequences with every layout
+    if (m_seed != 0) reseed();
+
+    m_drops.resize(size_t(cols));
+    m_steps.resize(size_t(cols));
+    m_charIndex.resize(size_t(cols));
+    m_wrapped.resize(size_t(cols));
+    for (int j = 0; j < cols; ++j)
+        m_drops[size_t(j)] = float(m_rng.uniform() * height() / m_fontSize);
+
+    resizeGrid();
+    if (changed) emit columnsChanged();
+
+    initializeRenderer();
+    update();
+    wake();
+}
+
+void MatrixRainItem::requestPaint()
+{
+    update();
+    wake();
+}
+
+void MatrixRainItem::wake()
+{
+    m_quietTicks = 0;
+    if (!m_idle) return;
+
+    m_idle = false;
+    emit idleChanged();
+    if (!m_running) return;
+
+    // Queued: wake() may run inside a renderer call (assignMessage)
+    m_frameTimer->start();
+    QMetaObject::invokeMethod(this, &MatrixRainItem::advanceFrame, Qt::QueuedConnection);
+}
+
+void MatrixRainItem::enterIdle()
+{
+    m_idle = true;
+    m_frameTimer->stop();
+    qDebug() << "[MQTTRain] rain idle: nothing to draw, frame timer stopped";
+    emit idleChanged();
+}
+
+// Quiet ticks until a full-brightness glyph has decayed below one 8-bit step
+int MatrixRainItem::ticksToBlack() const
+{
+    if (m_fadeStrength <= 0) return std::numeric_limits<int>::max();
+    if (m_fadeStrength >= 1) return 1;
+    return int(std::ceil(std::log(kMinIntensity) / std::log(1.0 - m_fadeStrength)));
+}
+
+void MatrixRainItem::stampGlyph(QChar ch, QRgb color, qreal x, qreal y)
+{
+    const int col = int(std::floor(x / m_fontSize));
+    const int row = int(std::floor(y / m_fontSize));
+    if (col < 0 || col >= m_gridCols || row < 0 || row >= m_gridRows) return;
+
+    ++m_stamps;
+    Cell &c = m_cells[row * m_gridCols + col];
+    c.x = float(x);
+    c.y = float(y);
+    c.color = color;
+    c.intensity = 1.0f;
+    c.glyph = quint16(m_atlas.glyphIndex(ch));
+}
+
+void MatrixRainItem::darkenRect(const QRectF &rect, qreal alpha)
+{
+    if (alpha <= 0) return;
+    const float keep = float(1.0 - qMin<qreal>(alpha, 1.0));
+    const qreal fs = m_fontSize;
+
+    if (m_fadeMode == GpuFade) {
+        // Mask texels are pixel-aligned cells; darken the one under the
+        // rect's centre (renderers fade exactly one glyph box at a time).
+        const QPointF centre = rect.center();
+        m_fadeMask->darken(int(std::floor(centre.x() / fs)), int(std::floor(centre.y() / fs)), keep);
+        return;
+    }
+
+    // A cell belongs to the rect when its glyph centre lies inside it;
+    // glyphs sit above their baseline, hence the one-row overscan.
+    const int c0 = qMax(0, int(std::floor(rect.left() / fs)));
+    const int c1 = qMin(m_gridCols - 1, int(std::floor(rect.right() / fs)));
+    const int r0 = qMax(0, int(std::floor(rect.top() / fs)));
+    const int r1 = qMin(m_gridRows - 1, int(std::floor(rect.bottom() / fs)) + 1);
+
+    for (int row = r0; row <= r1; ++row) {
+        for (int col = c0; col <= c1; ++col) {
+            Cell &c = m_cells[row * m_gridCols + col];
+            if (c.intensity <= 0) continue;
+            if (!rect.contains(QPointF(c.x + fs * 0.5, c.y - fs * 0.5))) continue;
+            c.intensity *= keep;
+            if (c.intensity < kMinIntensity) c.intensity = 0;
+        }
+    }
+}
+
+void MatrixRainItem::geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry)
+{
+    QQuickItem::geometryChange(newGeometry, oldGeometry);
+    if (newGeometry.size() != oldGeometry.size() && isComponentComplete())
+        initDrops();
+}
+
+void MatrixRainItem::componentComplete()
+{
+    QQuickItem::componentComplete();
+    initDrops();
+}
+
+// ================================================================
+// One animation tick: fade, rain drop loop, inline-chars pass.
+// Mirrors the step order of the former Canvas onPaint handler.
+// ================================================================
+void MatrixRainItem::advanceFrame()
+{
+    if (m_idle || m_drops.empty() || !bindRenderer()) return;
+    m_stamps = 0;
+    int fadedLive = 0;
+
+    // Always timed: the governor needs the cost of every tick
+    QElapsedTimer clock;
+    qint64 lapStart = 0;
+    clock.start();
+    auto lap = [&](FrameTimings::Step step) {
+        if (!m_profiling) return;
+        const qint64 now = clock.nsecsElapsed();
+        m_timings.add(step, now - lapStart);
+        lapStart = now;
+    };
+
+    // ── Step 1: global fade ───────────────────────────────────────────
+    // GpuFade: the shader decays the trail texture; only this tick's
+    // glyphs are emitted, and last tick's extra fades are consumed.
+    if (m_fadeMode == GpuFade) {
+        m_cells.fill(Cell{});
+        m_fadeMask->reset();
+    } else {
+        // Per column tile; each counts what it leaves lit
+        const float keep = float(1.0 - m_fadeStrength);
+        Cell *cells = m_cells.data();
+        const int cols = m_gridCols;
+        const int rows = m_gridRows;
+        forEachTile([&](int tile, int first, int end) {
+            int live = 0;
+            for (int row = 0; row < rows; ++row) {
+                Cell *line = cells + row * cols;
+                for (int col = first; col < end; ++col) {
+                    Cell &c = line[col];
+                    if (c.intensity <= 0) continue;
+                    c.intensity *= keep;
+                    if (c.intensity < kMinIntensity) c.intensity = 0;
+                    else                             ++live;
+                }
+            }
+            m_tileLive[size_t(tile)] = live;
+        });
+        for (int live : m_tileLive)
+            fadedLive += live;
+    }
+    lap(FrameTimings::Fade);
+
+    // ── Step 2: rain drop loop ────────────────────────────────────────
+    // Renderers only read drops[columnIndex] before that column advances,
+    // so a single snapshot per frame is equivalent to the JS array. It,
+    // the tick's random batch and the character indices cross as one
+    // typed array each; everything else per column is a ColumnKernels
+    // pass over the struct-of-arrays state after the JS calls.
+    const int n = columns();
+    const QJSValue drops = typedArray(m_float32Ctor, columnBytes(m_drops));
+
+    // Reduced quality: no random draws at all, a constant batch of 1.0
+    // fails every glitch roll and the drops fall without jitter
+    const bool glitches = m_governor.glitches();
+    QJSValue rand;
+    if (glitches) {
+        QByteArray randomBytes(n * qsizetype(sizeof(float)), Qt::Uninitialized);
+        float *randoms = reinterpret_cast<float *>(randomBytes.data());
+        for (int i = 0; i < n; ++i)
+            randoms[i] = m_rng.uniformf();
+        rand = typedArray(m_float32Ctor, randomBytes);
+    } else {
+        if (m_noGlitchRand.property(QStringLiteral("length")).toInt() != n) {
+            QByteArray ones(n * qsizetype(sizeof(float)), Qt::Uninitialized);
+            std::fill_n(reinterpret_cast<float *>(ones.data()), n, 1.0f);
+            m_noGlitchRand = typedArray(m_float32Ctor, ones);
+        }
+        rand = m_noGlitchRand;
+    }
+
+    // (floor(drop) + column) % chars length, from the columnState's lengths
+    const int assigned = m_columnState ? qMin(n, m_columnState->columns()) : 0;
+    if (assigned > 0)
+        ColumnKernels::charIndex(m_drops.data(), m_columnState->lengths(), m_charIndex.data(), assigned);
+    std::fill(m_charIndex.begin() + assigned, m_charIndex.end(), 0);
+    const QJSValue charIndex = typedArray(m_int32Ctor, columnBytes(m_charIndex));
+
+    const qreal fs = m_fontSize;
+    // Half the columns per tick, alternating; each moves two rows on its turn
+    const bool halfColumns = m_governor.halfColumns();
+    const int parity = int(m_tick & 1);
+
+    for (int i = 0; i < n && m_renderer; ++i) {
+        if (halfColumns && (i & 1) != parity) continue;
+
+        // Free columns of a sparse renderer draw nothing and have no
+        // passes to count: only their drop keeps moving
+        const bool skip = m_skipInactive && m_columnState && !m_columnState->isActive(i);
+        if (!skip)
+            callRenderer(m_fnRenderColumn, { m_ctxJs, i, i * fs, m_drops[size_t(i)] * fs, drops, rand, charIndex });
+    }
+
+    // Steps: 1 + jitter (one draw per column, in column order, so seeded
+    // runs repeat), or a flat 1 / 2 rows when the governor dropped jitter
+    if (glitches) {
+        for (int i = 0; i < n; ++i)
+            m_steps[size_t(i)] = m_rng.uniformf();
+        const qreal jitter = m_renderer ? m_renderer->property("jitter").toReal() : 0;
+        ColumnKernels::steps(m_steps.data(), m_steps.data(), n, 1.0f, float(jitter / 100));
+    } else {
+        const float rows = halfColumns ? 2.0f : 1.0f;
+        for (int i = 0; i < n; ++i)
+            m_steps[size_t(i)] = (halfColumns && (i & 1) != parity) ? 0.0f : rows;
+    }
+    ColumnKernels::advance(m_drops.data(), m_steps.data(), n);
+
+    // Past the bottom edge (y > height + one row) a drop restarts at the top
+    const int wrapped = ColumnKernels::wrap(m_drops.data(), n, float((height() + fs) / fs), m_wrapped.data());
+    for (int w = 0; w < wrapped && m_renderer; ++w) {
+        const int i = m_wrapped[size_t(w)];
+        const bool skip = m_skipInactive && m_columnState && !m_columnState->isActive(i);
+        if (!skip) callRenderer(m_fnColumnWrap, { i });
+    }
+    lap(FrameTimings::Columns);
+
+    // ── Step 3: inline-chars pass (optional) ──────────────────────────
+    if (m_renderer && (m_governor.inlineEveryTick() || parity == 0))
+        callRenderer(m_fnInlineChars, { m_ctxJs });
+    lap(FrameTimings::InlineChars);
+    const qint64 tickNs = clock.nsecsElapsed();
+    if (m_profiling) m_timings.add(FrameTimings::Tick, tickNs);
+    ++m_tick;
+
+    const int level = m_governor.level();
+    if (m_governor.addFrame(tickNs + m_uploadNs)) {
+        qDebug() << "[MQTTRain] quality" << (m_governor.level() > level ? "down" : "up") << "to"
+                 << FrameGovernor::name(m_governor.level()) << "- mean" << m_governor.meanNs() / 1e6
+                 << "ms, budget" << m_governor.budgetNs() / 1e6 << "ms";
+        applyFrameInterval();
+        emit qualityLevelChanged();
+    }
+    m_uploadNs = 0;
+
+    // ── Dirty tracking / idle ─────────────────────────────────────────
+    // GpuFade uploads only this tick's glyphs; CellFade the decayed grid.
+    const bool hasGlyphs = m_stamps > 0 || (m_fadeMode == CellFade && fadedLive > 0);
+    if (hasGlyphs || m_hadGlyphs) update();
+    m_hadGlyphs = hasGlyphs;
+
+    m_quietTicks = m_stamps > 0 ? 0 : m_quietTicks + 1;
+    const bool converged = (m_fadeMode == GpuFade) ? m_quietTicks >= ticksToBlack()
+                                                   : !hasGlyphs;
+    emit frameAdvanced();
+    if (converged) enterIdle();
+}
+
+QSGNode *MatrixRainItem::updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *)
+{
+    QElapsedTimer clock;
+    clock.start();
+
+    auto *node = static_cast<RainNode *>(oldNode);
+    if (!node) node = new RainNode;
+
+    if (!node->material.texture() || node->atlasGeneration != m_atlas.generation()) {
+        node->material.setTexture(window()->createTextureFromImage(m_atlas.image()));
+        node->atlasGeneration = m_atlas.generation();
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
+
+    // Quads are counted and then written per column tile on the TilePool.
+    // A tile's share of the buffers starts at the sum of the counts before
+    // it, so the tiles fill one geometry side by side without locking.
+    const Cell *cells = m_cells.constData();
+    const int cols = m_gridCols;
+    const int rows = m_gridRows;
+    forEachTile([&](int tile, int first, int end) {
+        quint32 live = 0;
+        for (int row = 0; row < rows; ++row) {
+            const Cell *line = cells + row * cols;
+            for (int col = first; col < end; ++col)
+                if (line[col].intensity > 0) ++live;
+        }
+        m_tileQuads[size_t(tile)] = live;
+    });
+    quint32 live = 0;
+    for (quint32 &quads : m_tileQuads) {
+        const quint32 count = quads;
+        quads = live;
+        live += count;
+    }
+
+    QSGGeometry *g = &node->geometry;
+    g->allocate(int(live) * 4, int(live) * 6);
+
+    auto *vertices = static_cast<GlyphVertex *>(g->vertexData());
+    quint32 *indices = g->indexDataAsUInt();
+
+    const float pad = m_atlas.padding();
+    const float asc = m_atlas.ascent();
+    const float cw  = m_atlas.cellWidth();
+    const float chh = m_atlas.cellHeight();
+
+    forEachTile([&](int tile, int first, int end) {
+        quint32 base = m_tileQuads[size_t(tile)] * 4;
+        GlyphVertex *v = vertices + base;
+        quint32 *idx = indices + m_tileQuads[size_t(tile)] * 6;
+
+        for (int row = 0; row < rows; ++row) {
+            const Cell *line = cells + row * cols;
+            for (int col = first; col < end; ++col) {
+                const Cell &c = line[col];
+                if (c.intensity <= 0) continue;
+
+                const QRectF &uv = m_atlas.uvRect(c.glyph);
+                const float u0 = float(uv.left()), v0 = float(uv.top());
+                const float u1 = float(uv.right()), v1 = float(uv.bottom());
+
+                const float a = qAlpha(c.color) / 255.0f * c.intensity;
+                const uchar r  = uchar(qRed(c.color)   * a + 0.5f);
+                const uchar gr = uchar(qGreen(c.color) * a + 0.5f);
+                const uchar b  = uchar(qBlue(c.color)  * a + 0.5f);
+                const uchar al = uchar(255.0f * a + 0.5f);
+
+                const float x0 = c.x - pad;
+                const float y0 = c.y - asc - pad;
+                const float x1 = x0 + cw;
+                const float y1 = y0 + chh;
+
+                v[0] = { x0, y0, u0, v0, r, gr, b, al };
+                v[1] = { x1, y0, u1, v0, r, gr, b, al };
+                v[2] = { x1, y1, u1, v1, r, gr, b, al };
+                v[3] = { x0, y1, u0, v1, r, gr, b, al };
+
+                idx[0] = base;     idx[1] = base + 1; idx[2] = base + 2;
+                idx[3] = base;     idx[4] = base + 2; idx[5] = base + 3;
+
+                v += 4;
+                idx += 6;
+                base += 4;
+            }
+        }
+    });
+
+    node->markDirty(QSGNode::DirtyGeometry);
+    m_uploadNs = clock.nsecsElapsed();
+    if (m_profiling) m_timings.add(FrameTimings::Upload, m_uploadNs);
+    return node;
+}
+
+void MatrixRainItem::resizeGrid()
+{
+    m_gridCols = columns() + 1;
+    m_gridRows = int(std::ceil(height() / m_fontSize)) + 2;
+    m_cells.fill(Cell{}, m_gridCols * m_gridRows);
+    const size_t tiles = size_t((m_gridCols + kTileColumns - 1) / kTileColumns);
+    m_tileLive.assign(tiles, 0);
+    m_tileQuads.assign(tiles, 0);
+    m_fadeMask->resizeGrid(m_gridCols, m_gridRows, m_fontSize);
+}
+
+bool MatrixRainItem::bindRenderer()
+{
+    if (m_rendererBound) return true;
+    if (!m_renderer) return false;
+
+    QJSEngine *engine = qmlEngine(this);
+    if (!engine) return false;
+
+    if (m_ctxJs.isUndefined()) {
+        m_ctxJs = engine->newQObject(m_painter);
+        m_float32Ctor = engine->globalObject().property(QStringLiteral("Float32Array"));
+        m_int32Ctor   = engine->globalObject().property(QStringLiteral("Int32Array"));
+    }
+
+    m_rendererJs     = engine->newQObject(m_renderer);
+    m_fnRenderColumn = m_rendererJs.property(QStringLiteral("renderColumnContent"));
+    m_fnColumnWrap   = m_rendererJs.property(QStringLiteral("onColumnWrap"));
+    m_fnInlineChars  = m_rendererJs.property(QStringLiteral("renderInlineChars"));
+
+    m_rendererBound = m_fnRenderColumn.isCallable();
+    if (!m_rendererBound) {
+        qWarning() << "[MQTTRain] activeRenderer has no renderColumnContent()";
+        return false;
+    }
+
+    // Optional: column slots, and whether free columns are drawn at all
+    m_columnState = qobject_cast<ColumnState *>(m_renderer->property("columnState").value<QObject *>());
+    const QVariant draws = m_renderer->property("drawsInactiveColumns");
+    m_skipInactive = m_columnState && draws.isValid() && !draws.toBool();
+    if (m_columnState) {
+        connect(m_columnState, &ColumnState::columnChanged, this, &MatrixRainItem::wake);
+        if (m_seed != 0) m_columnState->reseed(quint64(quint32(m_seed)), 2);
+    }
+    return true;
+}
+
+// ArrayBuffer over a copy of bytes, viewed through ctor (Float32Array, ...)
+QJSValue MatrixRainItem::typedArray(const QJSValue &ctor, const QByteArray &bytes) const
+{
+    QJSEngine *engine = qmlEngine(this);
+    return ctor.callAsConstructor({ engine->toScriptValue(bytes) });
+}
+
+void MatrixRainItem::initializeRenderer()
+{
+    if (!m_renderer || width() <= 0 || height() <= 0) return;
+
+    if (m_renderer->property("canvasWidth").isValid())  m_renderer->setProperty("canvasWidth",  width());
+    if (m_renderer->property("canvasHeight").isValid()) m_renderer->setProperty("canvasHeight", height());
+    if (m_renderer->property("fadeStrength").isValid()) m_renderer->setProperty("fadeStrength", m_fadeStrength);
+
+    QMetaObject::invokeMethod(m_renderer, "initializeColumns",
+                              Q_ARG(QVariant, QVariant(int(width() / m_fontSize))));
+}
+
+void MatrixRainItem::callRenderer(const QJSValue &fn, const QJSValueList &args)
+{
+    if (!fn.isCallable()) return;
+    const QJSValue result = fn.callWithInstance(m_rendererJs, args);
+    if (result.isError() && !m_loggedJsError) {
+        m_loggedJsError = true;
+        qWarning() << "[MQTTRain] renderer error:" << result.toString();
+    }
+}
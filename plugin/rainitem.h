@@ -0,0 +1,255 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QJSValue>
+#include <QPointer>
+#include <QQuickItem>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+#include <functional>
+#include <vector>
+#include "framegovernor.h"
+#include "frametimings.h"
+#include "glyphatlas.h"
+#include "xoshiro.h"
+
+class ColumnState;
+class RainFadeMask;
+class RainPainter;
+
+// Native replacement for the Canvas-based MatrixCanvas paint loop.
+//
+// Keeps the per-column drop state in C++, drives the frame timer and
+// walks the columns itself, calling into the active QML renderer through
+// the existing contract (initializeColumns, renderColumnContent,
+// onColumnWrap, renderInlineChars). Renderers draw into a RainPainter
+// passed as `ctx`, which records glyphs into a cell grid; the grid is
+// uploaded as one batch of textured quads through the scene graph.
+//
+// The trail is modelled per cell: every tick each cell's intensity is
+// scaled by (1 - fadeStrength), and a glyph stamped into a cell resets it
+// to full brightness — the same result the Canvas got from a full-screen
+// translucent fillRect, without touching every pixel.
+//
+// In GpuFade mode the item only emits the glyphs stamped during the
+// current tick; MatrixCanvas feeds them into a persistent trail texture
+// whose decay runs in a fragment shader, and darkenRect() writes into the
+// per-cell fadeMask texture instead of touching cells.
+//
+// Idle throttling: renderers that leave free columns blank (MQTT Driven)
+// set `drawsInactiveColumns: false`, so the loop skips their JS calls for
+// columns their columnState reports as free. Once a tick stamps nothing
+// and the trail has decayed to black, the frame timer stops and the item
+// goes idle; a change in the renderer's columnState, requestPaint() or
+// any reconfiguration wakes it on the next event loop pass. Ticks that
+// leave the cell grid unchanged skip the scene-graph update.
+//
+// `colors` is the column palette (one colour per column, cycled). It is
+// resolved into base / value / glitch shades only when it changes, so the
+// per-glyph ctx.glyph()/randomGlyph() calls carry no colour at all.
+//
+// Randomness comes from xoshiro256++ generators (drops and jitter here,
+// random glyphs in the painter, column picks in the renderer's
+// columnState). Each tick draws one uniform value per column up front and
+// hands the batch to renderColumnContent as a Float32Array, so renderers
+// roll glitches without Math.random(). A non-zero seed makes every
+// initDrops() start the same sequence: reproducible frames.
+//
+// Column state is a struct of arrays: drop positions, steps and character
+// indices here, chars lengths, passes and active flags in the renderer's
+// columnState. A tick makes its JS calls first (renderColumnContent per
+// column, reading the pre-advance snapshot), then advances and wraps
+// every drop in ColumnKernels passes and calls onColumnWrap for the
+// wrapped columns. renderColumnContent also gets charIndex, an Int32Array
+// of (floor(drops[i]) + i) % chars length, so renderers pick a message
+// character without the floor and modulo in JS.
+//
+// With profiling on (RainStats turns it on while the debug overlay is
+// shown) every pipeline step is timed into frameTimings().
+//
+// With adaptiveQuality (default) a FrameGovernor watches what each tick
+// and upload cost and trades detail for time when the machine is busy:
+// glitches and jitter first, then half the inline-chars passes, a longer
+// frame interval and finally every other column per tick. qualityLevel
+// (0 = full) and qualityName report where it stands.
+//
+// The native per-cell passes, the CPU fade and the quads of the upload,
+// run per column tile on the shared TilePool: renderThreads threads at
+// most (0 = one per core, 1 = serial), serial anyway for small grids.
+// The JS calls of a tick stay on the GUI thread.
+class MatrixRainItem : public QQuickItem
+{
+    Q_OBJECT
+    Q_PROPERTY(int      fontSize       READ fontSize       WRITE setFontSize       NOTIFY fontSizeChanged)
+    Q_PROPERTY(int      speed          READ speed          WRITE setSpeed          NOTIFY speedChanged)
+    Q_PROPERTY(qreal    fadeStrength   READ fadeStrength   WRITE setFadeStrength   NOTIFY fadeStrengthChanged)
+    Q_PROPERTY(bool     running        READ running        WRITE setRunning        NOTIFY runningChanged)
+    Q_PROPERTY(QObject *activeRenderer READ activeRenderer WRITE setActiveRenderer NOTIFY activeRendererChanged)
+    Q_PROPERTY(int      columns        READ columns                                NOTIFY columnsChanged)
+    Q_PROPERTY(FadeMode fadeMode       READ fadeMode       WRITE setFadeMode       NOTIFY fadeModeChanged)
+    Q_PROPERTY(QQuickItem *fadeMask    READ fadeMask       CONSTANT)
+    Q_PROPERTY(bool     idle           READ idle                                   NOTIFY idleChanged)
+    Q_PROPERTY(QVariantList colors     READ colors         WRITE setColors         NOTIFY colorsChanged)
+    Q_PROPERTY(int      seed           READ seed           WRITE setSeed           NOTIFY seedChanged)
+    Q_PROPERTY(bool     adaptiveQuality READ adaptiveQuality WRITE setAdaptiveQuality NOTIFY adaptiveQualityChanged)
+    Q_PROPERTY(int      qualityLevel   READ qualityLevel                           NOTIFY qualityLevelChanged)
+    Q_PROPERTY(QString  qualityName    READ qualityName                            NOTIFY qualityLevelChanged)
+    Q_PROPERTY(int      renderThreads  READ renderThreads  WRITE setRenderThreads  NOTIFY renderThreadsChanged)
+
+public:
+    enum FadeMode {
+        CellFade,   // trail decayed per cell on the CPU, full grid re-emitted
+        GpuFade     // only this tick's glyphs emitted, decay done by the trail shader
+    };
+    Q_ENUM(FadeMode)
+
+    explicit MatrixRainItem(QQuickItem *parent = nullptr);
+    ~MatrixRainItem() override;
+
+    int      fontSize()       const { return m_fontSize; }
+    int      speed()          const { return m_speed; }
+    qreal    fadeStrength()   const { return m_fadeStrength; }
+    bool     running()        const { return m_running; }
+    bool     idle()           const { return m_idle; }
+    QObject *activeRenderer() const { return m_renderer; }
+    int      columns()        const { return int(m_drops.size()); }
+    FadeMode fadeMode()       const { return m_fadeMode; }
+    QVariantList colors()     const { return m_colors; }
+    int      seed()           const { return m_seed; }
+    bool     adaptiveQuality() const { return m_governor.enabled(); }
+    int      qualityLevel()   const { return m_governor.level(); }
+    QString  qualityName()    const { return QString::fromLatin1(FrameGovernor::name(m_governor.level())); }
+    int      renderThreads()  const { return m_renderThreads; }
+    QQuickItem *fadeMask() const;
+
+    void setFontSize(int size);
+    void setSpeed(int speed);
+    void setFadeStrength(qreal strength);
+    void setRunning(bool running);
+    void setActiveRenderer(QObject *renderer);
+    void setFadeMode(FadeMode mode);
+    void setColors(const QVariantList &colors);
+    // 0 = non-deterministic
+    void setSeed(int seed);
+    void setAdaptiveQuality(bool enabled);
+    // 0 = one per core
+    void setRenderThreads(int threads);
+
+    // Re-seed every drop and re-initialise the active renderer.
+    Q_INVOKABLE void initDrops();
+    // Kept for MatrixCanvas compatibility: schedules a scene-graph sync
+    // and leaves idle; frames otherwise advance on the timer only.
+    Q_INVOKABLE void requestPaint();
+
+    // Per-step frame timings; only recorded while profiling
+    void setProfiling(bool enabled);
+    bool profiling() const { return m_profiling; }
+    const FrameTimings &frameTimings() const { return m_timings; }
+
+    // Called by RainPainter.
+    void stampGlyph(QChar ch, QRgb color, qreal x, qreal y);
+    void darkenRect(const QRectF &rect, qreal alpha);
+
+signals:
+    void fontSizeChanged();
+    void speedChanged();
+    void fadeStrengthChanged();
+    void runningChanged();
+    void activeRendererChanged();
+    void columnsChanged();
+    void fadeModeChanged();
+    void idleChanged();
+    void colorsChanged();
+    void seedChanged();
+    void adaptiveQualityChanged();
+    void qualityLevelChanged();
+    void renderThreadsChanged();
+    // Emitted after every animation tick; GpuFade consumers capture the
+    // trail texture in response.
+    void frameAdvanced();
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override;
+    void     geometryChange(const QRectF &newGeometry, const QRectF &oldGeometry) override;
+    void     componentComplete() override;
+
+private slots:
+    void advanceFrame();
+    void wake();
+
+private:
+    struct Cell
+    {
+        float   x;
+        float   y;
+        QRgb    color;
+        float   intensity;   // 0 = empty
+        quint16 glyph;
+    };
+
+    void reseed();
+    QJSValue typedArray(const QJSValue &ctor, const QByteArray &bytes) const;
+    void resizeGrid();
+    void enterIdle();
+    int  ticksToBlack() const;
+    bool bindRenderer();
+    void initializeRenderer();
+    void callRenderer(const QJSValue &fn, const QJSValueList &args);
+    // Frame interval for the speed and the governor's level
+    void applyFrameInterval();
+    // fn(tile, first column, end column) for every column tile of the
+    // grid, on the TilePool; returns when all are done
+    void forEachTile(const std::function<void(int, int, int)> &fn) const;
+
+    QTimer            *m_frameTimer;
+    RainPainter       *m_painter;
+    RainFadeMask      *m_fadeMask;
+    QPointer<QObject>  m_renderer;
+    QJSValue           m_rendererJs;
+    QJSValue           m_fnRenderColumn;
+    QJSValue           m_fnColumnWrap;
+    QJSValue           m_fnInlineChars;
+    QJSValue           m_ctxJs;
+    QJSValue           m_float32Ctor;
+    QJSValue           m_int32Ctor;
+    QJSValue           m_noGlitchRand;   // all 1.0: no glitch roll succeeds
+    QPointer<ColumnState> m_columnState;
+    bool               m_rendererBound;
+    bool               m_loggedJsError;
+    bool               m_skipInactive;   // renderer draws nothing in free columns
+
+    GlyphAtlas         m_atlas;
+    QVector<Cell>      m_cells;
+    int                m_gridCols;
+    int                m_gridRows;
+    int                m_renderThreads;
+    std::vector<int>     m_tileLive;      // fade: live cells left per tile
+    std::vector<quint32> m_tileQuads;     // upload: first quad of each tile
+    // Struct of arrays, one entry per column (ColumnKernels)
+    std::vector<float>  m_drops;          // drop head, in rows
+    std::vector<float>  m_steps;          // this tick's advance
+    std::vector<qint32> m_charIndex;      // chars index for renderColumnContent
+    std::vector<int>    m_wrapped;        // columns that wrapped this tick
+    Xoshiro256         m_rng;
+    int                m_seed;
+
+    int                m_fontSize;
+    int                m_speed;
+    qreal              m_fadeStrength;
+    FadeMode           m_fadeMode;
+    QVariantList       m_colors;
+    bool               m_running;
+    bool               m_idle;
+    int                m_stamps;        // glyphs stamped during the current tick
+    int                m_quietTicks;    // consecutive ticks without a stamp
+    bool               m_hadGlyphs;     // last uploaded grid was not empty
+    quint64            m_tick;
+
+    FrameGovernor      m_governor;
+    qint64             m_uploadNs;      // last updatePaintNode, for the governor
+
+    // Upload samples are written during the scene-graph sync, while the
+    // GUI thread is blocked, so no locking is needed
+    bool               m_profiling;
+    FrameTimings       m_timings;
+};
@@ -0,0 +1,129 @@
+#include "rainpainter.h"
+#include "rainitem.h"
+#include <QColor>
+#include <QDebug>
+#include <QStringList>
+
+namespace {
+// Blend towards white used for JSON values (formerly ColorUtils.lightenColor)
+constexpr qreal kValueLighten = 0.55;
+
+QRgb lighten(QRgb c, qreal factor)
+{
+    auto up = [factor](int v) { return qMin(255, qRound(v + (255 - v) * factor)); };
+    return qRgba(up(qRed(c)), up(qGreen(c)), up(qBlue(c)), qAlpha(c));
+}
+}
+
+RainPainter::RainPainter(MatrixRainItem *item)
+    : QObject(item)
+    , m_item(item)
+    , m_fillRgb(qRgb(0, 0, 0))
+    , m_rng()
+{
+    setPalette({});
+}
+
+void RainPainter::setPalette(const QVariantList &colors)
+{
+    m_palette.clear();
+    m_palette.reserve(qMax<qsizetype>(1, colors.size()));
+    for (const QVariant &c : colors) {
+        const QRgb base = toRgb(c);
+        m_palette.append({ base, lighten(base, kValueLighten), qRgb(255, 255, 255) });
+    }
+    if (m_palette.isEmpty()) {
+        const QRgb green = qRgb(0, 255, 0);
+        m_palette.append({ green, lighten(green, kValueLighten), qRgb(255, 255, 255) });
+    }
+}
+
+void RainPainter::setFillStyle(const QVariant &style)
+{
+    m_fillStyle = style;
+    m_fillRgb = resolve(style);
+}
+
+void RainPainter::fillText(const QString &text, qreal x, qreal y)
+{
+    const qreal pitch = m_item->fontSize();
+    for (int k = 0; k < text.size(); ++k)
+        m_item->stampGlyph(text.at(k), m_fillRgb, x + k * pitch, y);
+}
+
+void RainPainter::glyph(int code, int column, int shade, qreal x, qreal y)
+{
+    m_item->stampGlyph(QChar(char16_t(code)), shadeColor(column, shade), x, y);
+}
+
+void RainPainter::randomGlyph(int column, int shade, qreal x, qreal y)
+{
+    const char16_t code = char16_t(0x30A0 + m_rng.bounded(96));
+    m_item->stampGlyph(QChar(code), shadeColor(column, shade), x, y);
+}
+
+void RainPainter::stampGlyph(QChar ch, QRgb color, qreal x, qreal y)
+{
+    m_item->stampGlyph(ch, color, x, y);
+}
+
+void RainPainter::fillRect(qreal x, qreal y, qreal w, qreal h)
+{
+    m_item->darkenRect(QRectF(x, y, w, h), qAlpha(m_fillRgb) / 255.0);
+}
+
+QRgb RainPainter::toRgb(const QVariant &color)
+{
+    if (color.metaType().id() == QMetaType::QColor)
+        return color.value<QColor>().rgba();
+    return parseColor(color.toString());
+}
+
+QRgb RainPainter::resolve(const QVariant &style)
+{
+    if (style.metaType().id() == QMetaType::QColor)
+        return style.value<QColor>().rgba();
+
+    const QString css = style.toString();
+    auto it = m_colorCache.constFind(css);
+    if (it != m_colorCache.constEnd()) return it.value();
+
+    bool ok = false;
+    QRgb rgb = parseColor(css, &ok);
+    if (!ok) qWarning() << "[MQTTRain] unsupported fillStyle:" << css;
+    m_colorCache.insert(css, rgb);
+    return rgb;
+}
+
+// Parses the colour forms the renderers produce: "#rgb", "#rrggbb",
+// "#aarrggbb" (QML color.toString()), "rgb(r,g,b)", "rgba(r,g,b,a)" and
+// named colours. Unknown strings come back as opaque white.
+QRgb RainPainter::parseColor(const QString &css, bool *ok)
+{
+    if (ok) *ok = true;
+    const QString s = css.trimmed();
+
+    const bool isRgba = s.startsWith(QLatin1String("rgba("));
+    if (isRgba || s.startsWith(QLatin1String("rgb("))) {
+        const int open = s.indexOf(u'(');
+        const int close = s.lastIndexOf(u')');
+        const QStringList parts = s.mid(open + 1, close - open - 1).split(u',');
+        if (parts.size() == (isRgba ? 4 : 3)) {
+            bool okR, okG, okB, okA = true;
+            int r = parts[0].trimmed().toInt(&okR);
+            int g = parts[1].trimmed().toInt(&okG);
+            int b = parts[2].trimmed().toInt(&okB);
+            double a = isRgba ? parts[3].trimmed().toDouble(&okA) : 1.0;
+            if (okR && okG && okB && okA) {
+                return qRgba(qBound(0, r, 255), qBound(0, g, 255), qBound(0, b, 255),
+                             qBound(0, qRound(a * 255), 255));
+            }
+        }
+    } else {
+        QColor c(s);
+        if (c.isValid()) return c.rgba();
+    }
+
+    if (ok) *ok = false;
+    return qRgb(255, 255, 255);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <QHash>
+#include <QObject>
+#include <QRgb>
+#include <QVariant>
+#include <QVector>
+#include <array>
+#include "xoshiro.h"
+
+class MatrixRainItem;
+
+// Stand-in for the Canvas 2D context handed to renderers as `ctx`.
+//
+// Implements exactly the subset the renderers use (fillStyle, fillText,
+// fillRect) and records glyphs into the owning MatrixRainItem instead of
+// rasterising them. Colour strings are parsed once and cached, since
+// renderers assign the same handful of styles every frame.
+//
+// The hot path skips strings altogether: glyph() takes a UTF-16 code and
+// randomGlyph() picks a Katakana code itself, and both take a column and
+// a Shade instead of a colour. The palette (one entry per column colour,
+// each with its base, lightened value and glitch shade) is resolved once
+// in setPalette(), which MatrixRainItem only calls when its colors change.
+class RainPainter : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QVariant fillStyle READ fillStyle WRITE setFillStyle)
+    Q_PROPERTY(QString  font      READ font      WRITE setFont)
+
+public:
+    enum Shade {
+        Base,     // column colour
+        Value,    // column colour lightened for JSON values
+        Glitch    // white flash
+    };
+    Q_ENUM(Shade)
+
+    explicit RainPainter(MatrixRainItem *item);
+
+    QVariant fillStyle() const { return m_fillStyle; }
+    void     setFillStyle(const QVariant &style);
+
+    // Accepted for Canvas compatibility; the item owns the font.
+    QString font() const { return m_font; }
+    void    setFont(const QString &font) { m_font = font; }
+
+    // Draws text with its baseline at y, one glyph per column pitch.
+    Q_INVOKABLE void fillText(const QString &text, qreal x, qreal y);
+
+    // The trail has no background layer, so fills can only darken what is
+    // already there: the rectangle is faded by the fill style's alpha.
+    Q_INVOKABLE void fillRect(qreal x, qreal y, qreal w, qreal h);
+
+    // One glyph of code `code` in shade of column's palette colour.
+    Q_INVOKABLE void glyph(int code, int column, int shade, qreal x, qreal y);
+    // Same with a random Katakana glyph (U+30A0–U+30FF).
+    Q_INVOKABLE void randomGlyph(int column, int shade, qreal x, qreal y);
+
+    // One glyph with an already resolved colour, for native callers that
+    // would otherwise go through fillStyle/fillText per cell.
+    void stampGlyph(QChar ch, QRgb color, qreal x, qreal y);
+
+    // Column c uses colors[c % colors.size()]; empty means green.
+    void setPalette(const QVariantList &colors);
+    QRgb shadeColor(int column, int shade) const
+    {
+        const auto &entry = m_palette[size_t(column) % m_palette.size()];
+        return entry[size_t(qBound(0, shade, int(Glitch)))];
+    }
+
+    void reseed(quint64 seed, quint64 stream) { m_rng.reseed(seed, stream); }
+
+    static QRgb parseColor(const QString &css, bool *ok = nullptr);
+    // CSS/QML colour or QColor variant to QRgb, without the cache.
+    static QRgb toRgb(const QVariant &color);
+
+private:
+    QRgb resolve(const QVariant &style);
+
+    MatrixRainItem      *m_item;
+    QVariant             m_fillStyle;
+    QRgb                 m_fillRgb;
+    QString              m_font;
+    QHash<QString, QRgb> m_colorCache;
+    QVector<std::array<QRgb, 3>> m_palette;   // indexed by Shade, never empty
+    Xoshiro256           m_rng;   // randomGlyph() codes
+};
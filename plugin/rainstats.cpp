@@ -0,0 +1,108 @@
+#include "rainstats.h"
+
+RainStats::RainStats(QObject *parent)
+    : QObject(parent)
+    , m_timer(new QTimer(this))
+    , m_active(false)
+    , m_receivedPerSecond(0)
+    , m_filteredPerSecond(0)
+    , m_droppedPerSecond(0)
+    , m_bytesPerSecond(0)
+    , m_tokenizeMicros(0)
+    , m_reconnects(0)
+    , m_connackLatency(-1)
+    , m_memoryBytes(0)
+    , m_memoryPeak(0)
+    , m_memoryCap(0)
+{
+    m_timer->setInterval(1000);
+    connect(m_timer, &QTimer::timeout, this, &RainStats::sample);
+}
+
+RainStats::~RainStats()
+{
+    if (m_item) m_item->setProfiling(false);
+}
+
+void RainStats::setRainItem(MatrixRainItem *item)
+{
+    if (m_item == item) return;
+    if (m_item) m_item->setProfiling(false);
+    m_item = item;
+    emit sourcesChanged();
+    apply();
+}
+
+void RainStats::setClient(MQTTClient *client)
+{
+    if (m_client == client) return;
+    m_client = client;
+    m_lastCounters.clear();
+    emit sourcesChanged();
+}
+
+void RainStats::setActive(bool active)
+{
+    if (m_active == active) return;
+    m_active = active;
+    emit activeChanged();
+    apply();
+}
+
+void RainStats::setInterval(int ms)
+{
+    ms = qMax(100, ms);
+    if (m_timer->interval() == ms) return;
+    m_timer->setInterval(ms);
+    emit intervalChanged();
+}
+
+void RainStats::apply()
+{
+    if (m_item) m_item->setProfiling(m_active);
+
+    if (m_active) {
+        // Rates start from the first full interval
+        m_lastCounters.clear();
+        m_sinceSample.invalidate();
+        m_timer->start();
+        sample();
+    } else {
+        m_timer->stop();
+    }
+}
+
+void RainStats::sample()
+{
+    m_frameSteps = m_item ? m_item->frameTimings().percentiles() : QVariantList();
+
+    if (m_client) {
+        const QVariantMap now = m_client->ingestStats();
+        const qreal seconds = m_sinceSample.isValid() ? m_sinceSample.elapsed() / 1000.0 : 0;
+        m_sinceSample.start();
+
+        // A counter going backwards means a new client: wait one interval
+        auto delta = [&](const char *key) {
+            const QString k = QString::fromLatin1(key);
+            return qMax<qint64>(0, now.value(k).toLongLong() - m_lastCounters.value(k, now.value(k)).toLongLong());
+        };
+        if (!m_lastCounters.isEmpty() && seconds > 0) {
+            m_receivedPerSecond = delta("received") / seconds;
+            m_filteredPerSecond = delta("filtered") / seconds;
+            m_droppedPerSecond  = (delta("dropped") + delta("coalesced")) / seconds;
+            m_bytesPerSecond    = delta("bytes") / seconds;
+
+            const qint64 tokenized = delta("tokenized");
+            if (tokenized > 0)
+                m_tokenizeMicros = delta("tokenizeNs") / 1000.0 / tokenized;
+        }
+        m_reconnects     = now.value(QStringLiteral("reconnects")).toInt();
+        m_connackLatency = now.value(QStringLiteral("connackMs")).toInt();
+        m_memoryBytes    = now.value(QStringLiteral("memoryBytes")).toDouble();
+        m_memoryPeak     = now.value(QStringLiteral("memoryPeak")).toDouble();
+        m_memoryCap      = now.value(QStringLiteral("memoryCap")).toDouble();
+        m_lastCounters = now;
+    }
+
+    emit updated();
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <QElapsedTimer>
+#include <QObject>
+#include <QPointer>
+#include <QTimer>
+#include <QVariantList>
+#include <QVariantMap>
+#include "mqttclient.h"
+#include "rainitem.h"
+
+// Pipeline instrumentation for MQTTDebugOverlay.
+//
+// While active, polls the rain item's frame timings and the client's
+// cumulative ingest counters once per interval and turns them into what
+// the overlay shows: p50/p95/p99 per frame step (ms), message and byte
+// rates over the last interval, the average tokenise time, the
+// connection's reconnect count and CONNACK latency, and the MemoryLedger
+// bytes with their high-water mark and cap. Inactive, it turns
+// the item's profiling off and costs nothing.
+//
+// Everything is refreshed at once; updated() is the single notifier.
+class RainStats : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(MatrixRainItem *rainItem READ rainItem WRITE setRainItem NOTIFY sourcesChanged)
+    Q_PROPERTY(MQTTClient     *client   READ client   WRITE setClient   NOTIFY sourcesChanged)
+    Q_PROPERTY(bool   active   READ active   WRITE setActive   NOTIFY activeChanged)
+    Q_PROPERTY(int    interval READ interval WRITE setInterval NOTIFY intervalChanged)
+
+    Q_PROPERTY(QVariantList frameSteps        READ frameSteps        NOTIFY updated)
+    Q_PROPERTY(qreal        receivedPerSecond READ receivedPerSecond NOTIFY updated)
+    Q_PROPERTY(qreal        filteredPerSecond READ filteredPerSecond NOTIFY updated)
+    Q_PROPERTY(qreal        droppedPerSecond  READ droppedPerSecond  NOTIFY updated)
+    Q_PROPERTY(qreal        bytesPerSecond    READ bytesPerSecond    NOTIFY updated)
+    Q_PROPERTY(qreal        tokenizeMicros    READ tokenizeMicros    NOTIFY updated)
+    Q_PROPERTY(int          reconnects        READ reconnects        NOTIFY updated)
+    Q_PROPERTY(int          connackLatency    READ connackLatency    NOTIFY updated)
+    Q_PROPERTY(qreal        memoryBytes       READ memoryBytes       NOTIFY updated)
+    Q_PROPERTY(qreal        memoryPeak        READ memoryPeak        NOTIFY updated)
+    Q_PROPERTY(qreal        memoryCap         READ memoryCap         NOTIFY updated)
+
+public:
+    explicit RainStats(QObject *parent = nullptr);
+    ~RainStats() override;
+
+    MatrixRainItem *rainItem() const { return m_item; }
+    MQTTClient     *client()   const { return m_client; }
+    bool active()   const { return m_active; }
+    int  interval() const { return m_timer->interval(); }
+
+    QVariantList frameSteps() const { return m_frameSteps; }
+    qreal receivedPerSecond() const { return m_receivedPerSecond; }
+    qreal filteredPerSecond() const { return m_filteredPerSecond; }
+    qreal droppedPerSecond()  const { return m_droppedPerSecond; }
+    qreal bytesPerSecond()    const { return m_bytesPerSecond; }
+    // Mean over the last interval; the previous value when nothing was tokenised
+    qreal tokenizeMicros()    const { return m_tokenizeMicros; }
+    int   reconnects()        const { return m_reconnects; }
+    // ms, -1 before the first CONNACK
+    int   connackLatency()    const { return m_connackLatency; }
+    // Bytes (qreal for QML); memoryCap 0 = no cap
+    qreal memoryBytes()       const { return m_memoryBytes; }
+    qreal memoryPeak()        const { return m_memoryPeak; }
+    qreal memoryCap()         const { return m_memoryCap; }
+
+    void setRainItem(MatrixRainItem *item);
+    void setClient(MQTTClient *client);
+    void setActive(bool active);
+    void setInterval(int ms);
+
+signals:
+    void sourcesChanged();
+    void activeChanged();
+    void intervalChanged();
+    void updated();
+
+private slots:
+    void sample();
+
+private:
+    void apply();
+
+    QPointer<MatrixRainItem> m_item;
+    QPointer<MQTTClient>     m_client;
+    QTimer       *m_timer;
+    bool          m_active;
+
+    QElapsedTimer m_sinceSample;
+    QVariantMap   m_lastCounters;
+
+    QVariantList  m_frameSteps;
+    qreal         m_receivedPerSecond;
+    qreal         m_filteredPerSecond;
+    qreal         m_droppedPerSecond;
+    qreal         m_bytesPerSecond;
+    qreal         m_tokenizeMicros;
+    int           m_reconnects;
+    int           m_connackLatency;
+    qreal         m_memoryBytes;
+    qreal         m_memoryPeak;
+    qreal         m_memoryCap;
+};
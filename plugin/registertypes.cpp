@@ -0,0 +1,28 @@
+#include "registertypes.h"
+#include <QQmlEngine>
+#include "cellgrid.h"
+#include "columnstate.h"
+#include "messagering.h"
+#include "mqttclient.h"
+#include "mqttpayload.h"
+#include "mqttreplay.h"
+#include "rainitem.h"
+#include "rainpainter.h"
+#include "rainstats.h"
+#include "visibilitywatch.h"
+
+void registerMqttRainTypes(const char *uri)
+{
+    qmlRegisterType<MQTTClient>(uri, 1, 0, "MQTTClient");
+    // Lets JS string coercion ("" + payload) use the preview
+    QMetaType::registerConverter<MqttPayload, QString>(&MqttPayload::toString);
+    qmlRegisterType<MqttReplay>(uri, 1, 0, "MqttReplay");
+    qmlRegisterType<MatrixRainItem>(uri, 1, 0, "MatrixRainItem");
+    qmlRegisterType<ColumnState>(uri, 1, 0, "ColumnState");
+    qmlRegisterType<CellGrid>(uri, 1, 0, "CellGrid");
+    qmlRegisterType<MessageRing>(uri, 1, 0, "MessageRing");
+    qmlRegisterUncreatableType<RainPainter>(uri, 1, 0, "RainPainter",
+                                            QStringLiteral("ctx is provided by MatrixRainItem"));
+    qmlRegisterType<VisibilityWatch>(uri, 1, 0, "VisibilityWatch");
+    qmlRegisterType<RainStats>(uri, 1, 0, "RainStats");
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Registers every QML type of the ObsidianReq.MQTTRain module under uri.
+// Shared by the QML plugin and mqttrain-bench, which links the sources
+// directly instead of loading the plugin.
+void registerMqttRainTypes(const char *uri);
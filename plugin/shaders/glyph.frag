@@ -0,0 +1,19 @@
+#version 440
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 1) in vec4 color;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+};
+
+layout(binding = 1) uniform sampler2D glyphs;
+
+void main()
+{
+    // Atlas glyphs are white; alpha carries coverage, colour is premultiplied.
+    fragColor = color * texture(glyphs, texCoord).a;
+}
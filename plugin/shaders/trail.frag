@@ -0,0 +1,28 @@
+#version 440
+
+// GPU trail pass for MatrixCanvas (GpuFade mode).
+// previous: last captured trail (feedback ShaderEffectSource)
+// glyphs:   glyphs stamped by MatrixRainItem during the current tick
+// fadeMask: per-cell extra fade multipliers (RainFadeMask, 1.0 = none)
+
+layout(location = 0) in vec2 qt_TexCoord0;
+layout(location = 0) out vec4 fragColor;
+
+layout(std140, binding = 0) uniform buf {
+    mat4 qt_Matrix;
+    float qt_Opacity;
+    float keep;
+    vec2 maskScale;
+};
+
+layout(binding = 1) uniform sampler2D previous;
+layout(binding = 2) uniform sampler2D glyphs;
+layout(binding = 3) uniform sampler2D fadeMask;
+
+void main()
+{
+    float cellKeep = texture(fadeMask, qt_TexCoord0 * maskScale).r;
+    vec4 trail = texture(previous, qt_TexCoord0) * keep * cellKeep;
+    vec4 glyph = texture(glyphs, qt_TexCoord0);
+    fragColor = (glyph + trail * (1.0 - glyph.a)) * qt_Opacity;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded single-producer / single-consumer ring buffer.
+//
+// One thread calls push(), one other thread calls pop(); neither blocks
+// nor takes a lock. Capacity is rounded up to a power of two. Slots are
+// default-constructed up front and reused, so T should be cheap to
+// default-construct and move (implicitly shared Qt types are ideal).
+template <typename T>
+class SpscQueue
+{
+public:
+    explicit SpscQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator=(const SpscQueue &) = delete;
+
+    size_t capacity() const { return m_slots.size(); }
+
+    // Producer side. Returns false (and leaves item untouched) when full.
+    bool push(T &&item)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+            return false;
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool pop(T &item)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(m_slots[head & m_mask]);
+        m_slots[head & m_mask] = T();   // release payload memory held by the slot
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called from a thread that is neither end.
+    size_t size() const
+    {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+private:
+    // Keep the two indices on separate cache lines so producer and
+    // consumer do not invalidate each other's line on every operation.
+    static constexpr size_t kCacheLine = 64;
+
+    std::vector<T>                          m_slots;
+    size_t                                  m_mask = 0;
+    alignas(kCacheLine) std::atomic<size_t> m_head { 0 };   // next slot to read
+    alignas(kCacheLine) std::atomic<size_t> m_tail { 0 };   // next slot to write
+};
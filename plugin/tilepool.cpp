@@ -0,0 +1,54 @@
+#include "tilepool.h"
+#include <QSemaphore>
+#include <QThread>
+#include <atomic>
+
+namespace {
+
+struct TileRun
+{
+    std::atomic<int> next { 0 };
+    int              tiles = 0;
+    const std::function<void(int)> *fn = nullptr;
+    QSemaphore       finished;
+
+    void drain()
+    {
+        for (int tile; (tile = next.fetch_add(1, std::memory_order_relaxed)) < tiles;)
+            (*fn)(tile);
+    }
+};
+
+} // namespace
+
+TilePool &TilePool::instance()
+{
+    static TilePool pool;
+    return pool;
+}
+
+TilePool::TilePool()
+{
+    // The calling thread is the last core
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_pool.setObjectName(QStringLiteral("MQTTRain tiles"));
+}
+
+void TilePool::run(int tiles, int threads, const std::function<void(int)> &fn)
+{
+    if (tiles <= 0) return;
+    if (threads <= 0) threads = maxThreads();
+
+    TileRun job;
+    job.tiles = tiles;
+    job.fn = &fn;
+
+    int helpers = 0;
+    const int wanted = qMin(threads, tiles) - 1;
+    while (helpers < wanted && m_pool.tryStart([&job] { job.drain(); job.finished.release(); }))
+        ++helpers;
+
+    job.drain();
+    // job lives on this stack: wait for the helpers even if they found nothing left
+    job.finished.acquire(helpers);
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <QThreadPool>
+#include <functional>
+
+// Process-wide workers for the per-tile passes of MatrixRainItem (the
+// CPU fade and the quad generation of the scene-graph upload).
+//
+// run() splits nothing itself: the caller cuts its grid into tiles and
+// gets fn(tile) called once for each. The calling thread works through
+// tiles too, and so do as many idle pool threads as are free right now
+// (tryStart, never queued behind another instance's frame); every thread
+// claims the next unclaimed tile from a shared counter until none is
+// left, so a thread that finishes early takes over the rest instead of
+// waiting on a fixed share. run() returns once every tile is done.
+//
+// One pool for every wallpaper instance: with a screen per render thread
+// the frames overlap and share the cores instead of oversubscribing them.
+// fn must only touch its own tile's data.
+class TilePool
+{
+public:
+    static TilePool &instance();
+
+    // Threads a run may use, the caller included (one per core)
+    int maxThreads() const { return m_pool.maxThreadCount() + 1; }
+
+    // threads: 0 = maxThreads(), 1 = all on the calling thread
+    void run(int tiles, int threads, const std::function<void(int)> &fn);
+
+private:
+    TilePool();
+
+    QThreadPool m_pool;
+};
@@ -0,0 +1,107 @@
+#include "topicfilter.h"
+#include <QDebug>
+#include <QVariantMap>
+
+TopicFilter::TopicFilter(const QStringList &whitelist, const QStringList &blacklist)
+    : m_notWhitelisted(0)
+{
+    addRules(whitelist, White);
+    addRules(blacklist, Black);
+
+    m_hits.reset(new std::atomic<quint64>[size_t(m_rules.size())]);
+    for (qsizetype i = 0; i < m_rules.size(); ++i)
+        m_hits[size_t(i)].store(0, std::memory_order_relaxed);
+}
+
+QStringList TopicFilter::parseList(const QString &text)
+{
+    QStringList out;
+    for (const QString &item : text.split(u',', Qt::SkipEmptyParts)) {
+        const QString t = item.trimmed();
+        if (!t.isEmpty() && !out.contains(t)) out.append(t);
+    }
+    return out;
+}
+
+void TopicFilter::addRules(const QStringList &entries, List list)
+{
+    for (const QString &entry : entries) {
+        const int index = int(m_rules.size());
+
+        if (TopicTrie::hasWildcards(entry)) {
+            if (!m_tries[list].insert(entry, index)) {
+                qWarning() << "⚠️ Ignoring malformed topic filter:" << entry;
+                continue;
+            }
+        } else {
+            m_substrings[list].append({ QStringMatcher(entry), index });
+        }
+        m_rules.append({ entry, list });
+    }
+}
+
+int TopicFilter::matchList(List list, QStringView topic) const
+{
+    const int r = m_tries[list].match(topic);
+    if (r >= 0) return r;
+
+    for (const auto &s : m_substrings[list]) {
+        if (s.first.indexIn(topic) >= 0) return s.second;
+    }
+    return -1;
+}
+
+bool TopicFilter::accepts(QStringView topic) const
+{
+    if (m_rules.isEmpty()) return true;
+
+    const bool whitelistActive = !m_tries[White].isEmpty() || !m_substrings[White].isEmpty();
+    if (whitelistActive) {
+        const int w = matchList(White, topic);
+        if (w < 0) {
+            m_notWhitelisted.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_hits[size_t(w)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    const int b = matchList(Black, topic);
+    if (b >= 0) {
+        m_hits[size_t(b)].fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+quint64 TopicFilter::totalHits() const
+{
+    quint64 total = m_notWhitelisted.load(std::memory_order_relaxed);
+    for (qsizetype i = 0; i < m_rules.size(); ++i)
+        total += m_hits[size_t(i)].load(std::memory_order_relaxed);
+    return total;
+}
+
+QVariantList TopicFilter::hitsSnapshot() const
+{
+    QVariantList out;
+    out.reserve(m_rules.size() + 1);
+    bool whitelistActive = false;
+
+    for (qsizetype i = 0; i < m_rules.size(); ++i) {
+        const Rule &r = m_rules[i];
+        whitelistActive |= (r.list == White);
+        out.append(QVariantMap {
+            { QStringLiteral("rule"), r.pattern },
+            { QStringLiteral("list"), r.list == White ? QStringLiteral("white") : QStringLiteral("black") },
+            { QStringLiteral("hits"), qint64(m_hits[size_t(i)].load(std::memory_order_relaxed)) },
+        });
+    }
+    if (whitelistActive) {
+        out.append(QVariantMap {
+            { QStringLiteral("rule"), QStringLiteral("(not whitelisted)") },
+            { QStringLiteral("list"), QStringLiteral("white") },
+            { QStringLiteral("hits"), qint64(m_notWhitelisted.load(std::memory_order_relaxed)) },
+        });
+    }
+    return out;
+}
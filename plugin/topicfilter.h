@@ -0,0 +1,61 @@
+#pragma once
+#include <QList>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QStringMatcher>
+#include <QStringView>
+#include <QVariantList>
+#include <atomic>
+#include <memory>
+#include "topictrie.h"
+
+// Compiled whitelist + blacklist for incoming topics.
+//
+// Entries with '+' or '#' are MQTT topic filters matched through a
+// TopicTrie; plain entries keep the original substring semantics
+// ("availability" drops every topic containing it) through precompiled
+// QStringMatchers. When the whitelist is non-empty only topics matching
+// one of its entries pass; the blacklist is applied afterwards.
+//
+// Immutable once built: MQTTClient builds a new one on every change and
+// hands it to the connection thread. accepts() may run on one thread
+// while hit counters are read on another; counters are relaxed atomics.
+class TopicFilter
+{
+public:
+    TopicFilter(const QStringList &whitelist, const QStringList &blacklist);
+
+    bool isEmpty() const { return m_rules.isEmpty(); }
+
+    // Classifies topic and bumps the hit counter of the deciding rule.
+    bool accepts(QStringView topic) const;
+
+    // [{rule, list: "white"|"black", hits}, ...] plus a synthetic
+    // "(not whitelisted)" entry when a whitelist is active.
+    QVariantList hitsSnapshot() const;
+    quint64      totalHits() const;
+
+    // Splits a comma-separated config string into trimmed, non-empty entries.
+    static QStringList parseList(const QString &text);
+
+private:
+    enum List { White = 0, Black = 1 };
+
+    struct Rule
+    {
+        QString pattern;
+        List    list;
+    };
+
+    void addRules(const QStringList &entries, List list);
+    int  matchList(List list, QStringView topic) const;
+
+    QList<Rule>                             m_rules;
+    TopicTrie                               m_tries[2];
+    QList<QPair<QStringMatcher, int>>       m_substrings[2];   // matcher → rule index
+    std::unique_ptr<std::atomic<quint64>[]> m_hits;            // per rule
+    mutable std::atomic<quint64>            m_notWhitelisted;
+};
+
+using TopicFilterPtr = QSharedPointer<const TopicFilter>;
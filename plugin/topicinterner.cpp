@@ -0,0 +1,22 @@
+#include "topicinterner.h"
+#include "memoryledger.h"
+
+QString TopicInterner::intern(const QString &topic)
+{
+    auto it = m_topics.constFind(topic);
+    if (it != m_topics.cend()) return *it;
+
+    if (m_topics.size() >= kMaxTopics || MemoryLedger::instance().overCap())
+        clear();
+    const qint64 bytes = qint64(topic.size()) * 2;
+    MemoryLedger::instance().charge(bytes);
+    m_bytes += bytes;
+    return *m_topics.insert(topic);
+}
+
+void TopicInterner::clear()
+{
+    MemoryLedger::instance().credit(m_bytes);
+    m_bytes = 0;
+    m_topics.clear();
+}
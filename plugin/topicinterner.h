@@ -0,0 +1,31 @@
+#pragma once
+#include <QSet>
+#include <QString>
+
+// One shared QString per distinct topic.
+//
+// QtMqtt builds a fresh topic string for every PUBLISH; interning it
+// right after receipt makes every later copy (inbound queue, batch,
+// latest payloads, held messages, history, snapshot, QML) an implicitly
+// shared reference to the same buffer, so a topic costs its bytes once
+// however many messages carry it.
+//
+// Bounded: past kMaxTopics distinct topics, or when the MemoryLedger is
+// over its cap, the table is dropped and refilled from live traffic.
+// Strings already handed out stay valid, they just stop being shared
+// with new arrivals. Not thread-safe; each MqttConnection owns one.
+class TopicInterner
+{
+public:
+    static constexpr qsizetype kMaxTopics = 8192;
+
+    ~TopicInterner() { clear(); }
+
+    QString intern(const QString &topic);
+    void    clear();
+    qsizetype size() const { return m_topics.size(); }
+
+private:
+    QSet<QString> m_topics;
+    qint64        m_bytes = 0;   // charged to the MemoryLedger
+};
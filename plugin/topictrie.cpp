@@ -0,0 +1,117 @@
+#include "topictrie.h"
+
+TopicTrie::TopicTrie()
+{
+    clear();
+}
+
+void TopicTrie::clear()
+{
+    m_nodes.clear();
+    m_nodes.emplace_back();
+}
+
+bool TopicTrie::hasWildcards(QStringView filter)
+{
+    return filter.contains(u'+') || filter.contains(u'#');
+}
+
+bool TopicTrie::isValidFilter(QStringView filter)
+{
+    if (filter.isEmpty()) return false;
+
+    qsizetype start = 0;
+    for (;;) {
+        const qsizetype slash = filter.indexOf(u'/', start);
+        const bool last = (slash < 0);
+        const QStringView level = filter.mid(start, last ? -1 : slash - start);
+
+        if (level.contains(u'#') && (level != u"#" || !last)) return false;
+        if (level.contains(u'+') && level != u"+") return false;
+
+        if (last) return true;
+        start = slash + 1;
+    }
+}
+
+int TopicTrie::child(int node, QStringView level) const
+{
+    for (const auto &c : m_nodes[size_t(node)].children) {
+        if (c.first == level) return c.second;
+    }
+    return -1;
+}
+
+bool TopicTrie::insert(QStringView filter, int ruleId)
+{
+    if (!isValidFilter(filter)) return false;
+
+    int node = 0;
+    qsizetype start = 0;
+    for (;;) {
+        const qsizetype slash = filter.indexOf(u'/', start);
+        const bool last = (slash < 0);
+        const QStringView level = filter.mid(start, last ? -1 : slash - start);
+
+        if (level == u"#") {
+            if (m_nodes[size_t(node)].hashRule < 0) m_nodes[size_t(node)].hashRule = ruleId;
+            return true;
+        }
+
+        int next;
+        if (level == u"+") {
+            next = m_nodes[size_t(node)].plusChild;
+            if (next < 0) {
+                next = int(m_nodes.size());
+                m_nodes.emplace_back();
+                m_nodes[size_t(node)].plusChild = next;
+            }
+        } else {
+            next = child(node, level);
+            if (next < 0) {
+                next = int(m_nodes.size());
+                m_nodes.emplace_back();
+                m_nodes[size_t(node)].children.emplace_back(level.toString(), next);
+            }
+        }
+        node = next;
+
+        if (last) {
+            if (m_nodes[size_t(node)].endRule < 0) m_nodes[size_t(node)].endRule = ruleId;
+            return true;
+        }
+        start = slash + 1;
+    }
+}
+
+int TopicTrie::match(QStringView topic) const
+{
+    if (topic.isEmpty() || isEmpty()) return -1;
+    return matchFrom(0, topic, false, true);
+}
+
+// rest: the unconsumed part of the topic; atEnd: every level already consumed
+int TopicTrie::matchFrom(int node, QStringView rest, bool atEnd, bool firstLevel) const
+{
+    const Node &n = m_nodes[size_t(node)];
+    // Wildcards at the first level must not leak into $SYS and friends
+    const bool system = firstLevel && rest.startsWith(u'$');
+
+    // '#' also matches the parent level itself ("a/#" matches "a")
+    if (n.hashRule >= 0 && !system) return n.hashRule;
+    if (atEnd) return n.endRule;
+
+    const qsizetype slash = rest.indexOf(u'/');
+    const bool nextAtEnd = (slash < 0);
+    const QStringView level = nextAtEnd ? rest : rest.left(slash);
+    const QStringView next  = nextAtEnd ? QStringView() : rest.mid(slash + 1);
+
+    const int c = child(node, level);
+    if (c >= 0) {
+        const int r = matchFrom(c, next, nextAtEnd, false);
+        if (r >= 0) return r;
+    }
+    if (n.plusChild >= 0 && !system)
+        return matchFrom(n.plusChild, next, nextAtEnd, false);
+    return -1;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <QString>
+#include <QStringView>
+#include <utility>
+#include <vector>
+
+// Precompiled set of MQTT topic filters with standard wildcard semantics:
+//
+//   +   matches exactly one level          (a/+/c  ↔  a/b/c)
+//   #   matches any remaining levels, last (a/#    ↔  a, a/b, a/b/c)
+//
+// Filters whose first level is a wildcard do not match topics starting
+// with '$' (MQTT 3.1.1 §4.7.2). Matching walks the levels of the topic
+// once per live branch and never allocates; children are kept in small
+// flat vectors since real filter lists fan out very little.
+class TopicTrie
+{
+public:
+    TopicTrie();
+
+    void clear();
+    bool isEmpty() const { return m_nodes.size() == 1; }
+
+    // Returns false (and leaves the trie untouched) for malformed filters,
+    // e.g. "a/#/b" or "a/b+". The first rule inserted for a filter wins.
+    bool insert(QStringView filter, int ruleId);
+
+    // ruleId of a matching filter, or -1.
+    int match(QStringView topic) const;
+
+    static bool isValidFilter(QStringView filter);
+    static bool hasWildcards(QStringView filter);
+
+private:
+    struct Node
+    {
+        std::vector<std::pair<QString, int>> children;   // literal level → node
+        int plusChild = -1;   // node for '+'
+        int hashRule  = -1;   // rule of a '#' at this level
+        int endRule   = -1;   // rule of a filter ending exactly here
+    };
+
+    int  child(int node, QStringView level) const;
+    int  matchFrom(int node, QStringView rest, bool atEnd, bool firstLevel) const;
+
+    std::vector<Node> m_nodes;   // [0] is the root
+};
@@ -0,0 +1,144 @@
+#include "visibilitywatch.h"
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusPendingReply>
+#include <QDebug>
+
+namespace {
+const QString kScreenSaverService   = QStringLiteral("org.freedesktop.ScreenSaver");
+const QString kScreenSaverPath      = QStringLiteral("/ScreenSaver");
+const QString kScreenSaverInterface = QStringLiteral("org.freedesktop.ScreenSaver");
+}
+
+VisibilityWatch::VisibilityWatch(QObject *parent)
+    : QObject(parent)
+    , m_hideTimer(new QTimer(this))
+    , m_enabled(true)
+    , m_occluded(false)
+    , m_locked(false)
+    , m_exposed(true)
+    , m_shown(true)
+{
+    m_hideTimer->setSingleShot(true);
+    m_hideTimer->setInterval(1000);
+    connect(m_hideTimer, &QTimer::timeout, this, [this]() { setShown(false); });
+
+    // Lock state: signal plus one initial query; no bus simply means unlocked
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) return;
+
+    bus.connect(kScreenSaverService, kScreenSaverPath, kScreenSaverInterface,
+                QStringLiteral("ActiveChanged"), this, SLOT(onScreenSaverActiveChanged(bool)));
+
+    const QDBusMessage query = QDBusMessage::createMethodCall(
+        kScreenSaverService, kScreenSaverPath, kScreenSaverInterface, QStringLiteral("GetActive"));
+    auto *watcher = new QDBusPendingCallWatcher(bus.asyncCall(query), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, [this](QDBusPendingCallWatcher *w) {
+        const QDBusPendingReply<bool> reply = *w;
+        if (!reply.isError()) onScreenSaverActiveChanged(reply.value());
+        w->deleteLater();
+    });
+}
+
+void VisibilityWatch::setItem(QQuickItem *item)
+{
+    if (m_item == item) return;
+    if (m_item) disconnect(m_item, nullptr, this, nullptr);
+
+    m_item = item;
+    if (m_item)
+        connect(m_item, &QQuickItem::windowChanged, this, &VisibilityWatch::onWindowChanged);
+    emit itemChanged();
+    onWindowChanged(m_item ? m_item->window() : nullptr);
+}
+
+void VisibilityWatch::setEnabled(bool enabled)
+{
+    if (m_enabled == enabled) return;
+    m_enabled = enabled;
+    emit enabledChanged();
+    evaluate();
+}
+
+void VisibilityWatch::setOccluded(bool occluded)
+{
+    if (m_occluded == occluded) return;
+    m_occluded = occluded;
+    emit occludedChanged();
+    evaluate();
+}
+
+void VisibilityWatch::setHideDelay(int ms)
+{
+    ms = qMax(0, ms);
+    if (m_hideTimer->interval() == ms) return;
+    m_hideTimer->setInterval(ms);
+    emit hideDelayChanged();
+}
+
+void VisibilityWatch::onWindowChanged(QQuickWindow *window)
+{
+    if (m_window == window) return;
+    if (m_window) {
+        m_window->removeEventFilter(this);
+        disconnect(m_window, nullptr, this, nullptr);
+    }
+
+    m_window = window;
+    if (m_window) {
+        m_window->installEventFilter(this);
+        connect(m_window, &QWindow::visibilityChanged, this, &VisibilityWatch::refreshExposed);
+    }
+    refreshExposed();
+}
+
+bool VisibilityWatch::eventFilter(QObject *watched, QEvent *event)
+{
+    // isExposed() is only updated once the window has handled the event
+    if (watched == m_window && event->type() == QEvent::Expose)
+        QMetaObject::invokeMethod(this, &VisibilityWatch::refreshExposed, Qt::QueuedConnection);
+    return QObject::eventFilter(watched, event);
+}
+
+void VisibilityWatch::refreshExposed()
+{
+    // No window yet: assume visible rather than never starting
+    const bool exposed = !m_window
+        || (m_window->isExposed()
+            && m_window->visibility() != QWindow::Hidden
+            && m_window->visibility() != QWindow::Minimized);
+    if (m_exposed == exposed) return;
+
+    m_exposed = exposed;
+    emit exposedChanged();
+    evaluate();
+}
+
+void VisibilityWatch::onScreenSaverActiveChanged(bool active)
+{
+    if (m_locked == active) return;
+    qDebug() << (active ? "🔒 Session locked" : "🔓 Session unlocked");
+    m_locked = active;
+    emit lockedChanged();
+    evaluate();
+}
+
+void VisibilityWatch::evaluate()
+{
+    const bool visible = !m_enabled || (m_exposed && !m_occluded && !m_locked);
+    if (visible) {
+        m_hideTimer->stop();
+        setShown(true);
+    } else if (m_shown && !m_hideTimer->isActive()) {
+        m_hideTimer->start();
+    }
+}
+
+void VisibilityWatch::setShown(bool shown)
+{
+    if (m_shown == shown) return;
+    m_shown = shown;
+    qDebug() << "[MQTTRain] wallpaper" << (shown ? "visible" : "hidden");
+    emit shownChanged();
+}
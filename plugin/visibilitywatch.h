@@ -0,0 +1,74 @@
+#pragma once
+#include <QObject>
+#include <QPointer>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QTimer>
+
+// Tells whether the wallpaper can currently be seen.
+//
+// shown is false while the window of `item` is unexposed or minimised,
+// while the freedesktop screen saver reports the session as locked, or
+// while `occluded` is set (main.qml derives it from the task manager: a
+// maximised or full-screen window on the same screen). Going hidden is
+// debounced by hideDelay so alt-tabbing past a maximised window does not
+// stop and restart the animation; becoming visible is reported at once.
+//
+// Disabled, the watch always reports shown.
+class VisibilityWatch : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QQuickItem *item     READ item      WRITE setItem      NOTIFY itemChanged)
+    Q_PROPERTY(bool        enabled  READ enabled   WRITE setEnabled   NOTIFY enabledChanged)
+    Q_PROPERTY(bool        occluded READ occluded  WRITE setOccluded  NOTIFY occludedChanged)
+    Q_PROPERTY(int         hideDelay READ hideDelay WRITE setHideDelay NOTIFY hideDelayChanged)
+    Q_PROPERTY(bool        locked   READ locked                       NOTIFY lockedChanged)
+    Q_PROPERTY(bool        exposed  READ exposed                      NOTIFY exposedChanged)
+    Q_PROPERTY(bool        shown    READ shown                        NOTIFY shownChanged)
+
+public:
+    explicit VisibilityWatch(QObject *parent = nullptr);
+
+    QQuickItem *item()  const { return m_item; }
+    bool enabled()      const { return m_enabled; }
+    bool occluded()     const { return m_occluded; }
+    int  hideDelay()    const { return m_hideTimer->interval(); }
+    bool locked()       const { return m_locked; }
+    bool exposed()      const { return m_exposed; }
+    bool shown()        const { return m_shown; }
+
+    void setItem(QQuickItem *item);
+    void setEnabled(bool enabled);
+    void setOccluded(bool occluded);
+    void setHideDelay(int ms);
+
+signals:
+    void itemChanged();
+    void enabledChanged();
+    void occludedChanged();
+    void hideDelayChanged();
+    void lockedChanged();
+    void exposedChanged();
+    void shownChanged();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void onWindowChanged(QQuickWindow *window);
+    void onScreenSaverActiveChanged(bool active);
+    void refreshExposed();
+    void evaluate();
+
+private:
+    void setShown(bool shown);
+
+    QPointer<QQuickItem>   m_item;
+    QPointer<QQuickWindow> m_window;
+    QTimer *m_hideTimer;
+    bool    m_enabled;
+    bool    m_occluded;
+    bool    m_locked;
+    bool    m_exposed;
+    bool    m_shown;
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <QRandomGenerator>
+#include <QtGlobal>
+
+// xoshiro256++ (Blackman & Vigna): the generator behind every random
+// choice of the rain surface — drop seeding and jitter, glitch rolls,
+// random glyphs and free-column picks.
+//
+// Several times faster than QRandomGenerator's default engine and, more
+// to the point, seedable: the same seed and stream give the same
+// sequence, so frames can be reproduced for benchmarks and screenshots.
+// Consumers seed with a common base and their own stream number so their
+// sequences do not overlap. Seed 0 asks for a non-deterministic seed.
+class Xoshiro256
+{
+public:
+    using result_type = quint64;
+
+    explicit Xoshiro256(quint64 seed = 0, quint64 stream = 0) { reseed(seed, stream); }
+
+    void reseed(quint64 seed, quint64 stream = 0)
+    {
+        if (seed == 0) seed = QRandomGenerator::system()->generate64();
+        // splitmix64 expands the seed; the state must not be all zero
+        quint64 x = seed ^ (stream * 0x9E3779B97F4A7C15ull);
+        for (quint64 &w : m_s) {
+            x += 0x9E3779B97F4A7C15ull;
+            quint64 z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            w = z ^ (z >> 31);
+        }
+    }
+
+    quint64 next()
+    {
+        const quint64 result = rotl(m_s[0] + m_s[3], 23) + m_s[0];
+        const quint64 t = m_s[1] << 17;
+        m_s[2] ^= m_s[0];
+        m_s[3] ^= m_s[1];
+        m_s[1] ^= m_s[2];
+        m_s[0] ^= m_s[3];
+        m_s[2] ^= t;
+        m_s[3] = rotl(m_s[3], 45);
+        return result;
+    }
+
+    // [0, 1) from the top 53 / 24 bits
+    double uniform()  { return double(next() >> 11) * 0x1.0p-53; }
+    float  uniformf() { return float(next() >> 40) * 0x1.0p-24f; }
+
+    // [0, n), multiply-shift (bias below 2^-32, irrelevant here)
+    quint32 bounded(quint32 n) { return quint32(((next() >> 32) * quint64(n)) >> 32); }
+
+    // UniformRandomBitGenerator, for <random>/<algorithm>
+    static constexpr quint64 min() { return 0; }
+    static constexpr quint64 max() { return ~quint64(0); }
+    quint64 operator()() { return next(); }
+
+private:
+    static quint64 rotl(quint64 x, int k) { return (x << k) | (x >> (64 - k)); }
+
+    quint64 m_s[4];
+};